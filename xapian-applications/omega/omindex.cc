@@ -85,6 +85,7 @@ static bool ignore_exclusions = false;
 static bool spelling = false;
 static off_t  max_size = 0;
 static bool verbose = false;
+static unsigned jobs = 1;
 static enum {
     EMPTY_BODY_WARN, EMPTY_BODY_INDEX, EMPTY_BODY_SKIP
 } empty_body = EMPTY_BODY_WARN;
@@ -145,14 +146,31 @@ parse_pdfinfo_field(const char * p, const char * end, string & out, const char *
 #define PARSE_PDFINFO_FIELD(P, END, OUT, FIELD) \
     parse_pdfinfo_field((P), (END), (OUT), FIELD":", CONST_STRLEN(FIELD) + 1)
 
+/// Return the command to extract the text from PDF file @a file.
+static string
+pdftotext_command(const string & file)
+{
+    string cmd = "pdftotext -enc UTF-8";
+    append_filename_argument(cmd, file);
+    cmd += " -";
+    return cmd;
+}
+
+/// Return the command to extract the metadata from PDF file @a file.
+static string
+pdfinfo_command(const string & file)
+{
+    string cmd = "pdfinfo -enc UTF-8";
+    append_filename_argument(cmd, file);
+    return cmd;
+}
+
 static void
 get_pdf_metainfo(const string & file, string &author, string &title,
 		 string &keywords, string &topic)
 {
     try {
-	string cmd = "pdfinfo -enc UTF-8";
-	append_filename_argument(cmd, file);
-	string pdfinfo = stdout_to_string(cmd);
+	string pdfinfo = stdout_to_string(pdfinfo_command(file));
 
 	const char * p = pdfinfo.data();
 	const char * end = p + pdfinfo.size();
@@ -284,16 +302,21 @@ void
 index_mimetype(const string & file, const string & url, const string & ext,
 	       const string &mimetype, DirectoryIterator &d, size_t sample_size);
 
-static void
-index_file(const string &file, const string &url, DirectoryIterator & d,
-	   map<string, string>& mime_map, size_t sample_size)
+/** Look up the MIME type for the current entry of @a d by its extension.
+ *
+ *  @param ext	Set to the extension of the file (lower-cased if that's how
+ *		it was found in @a mime_map).
+ */
+static map<string, string>::const_iterator
+find_mimetype(DirectoryIterator & d, const map<string, string>& mime_map,
+	      string & ext)
 {
-    string ext;
+    ext.resize(0);
     const char * dot_ptr = strrchr(d.leafname(), '.');
     if (dot_ptr)
 	ext.assign(dot_ptr + 1);
 
-    map<string,string>::iterator mt = mime_map.find(ext);
+    map<string,string>::const_iterator mt = mime_map.find(ext);
     if (mt == mime_map.end()) {
 	// If the extension isn't found, see if the lower-cased version (if
 	// different) is found.
@@ -307,6 +330,97 @@ index_file(const string &file, const string &url, DirectoryIterator & d,
 	}
 	if (changed) mt = mime_map.find(ext);
     }
+    return mt;
+}
+
+/// Return the "U" term for @a url.
+static string
+get_urlterm(const string & url)
+{
+    string urlterm("U");
+    urlterm += url;
+
+    if (urlterm.length() > MAX_SAFE_TERM_LENGTH)
+	urlterm = hash_long_term(urlterm, MAX_SAFE_TERM_LENGTH);
+    return urlterm;
+}
+
+/** Start the external filter for the current entry of @a d in the background.
+ *
+ *  This is used with --jobs to run the filters for files we'll reach shortly
+ *  while we process the current file.  It only looks at the file's extension
+ *  and the database, and quietly does nothing for anything index_file()
+ *  might skip or handle without a filter.  Any filters which index_file()
+ *  doesn't end up collecting get discarded by index_directory().
+ *
+ *  @return false if we need to start a filter but too many are already
+ *	    running; true otherwise.
+ */
+static bool
+prefetch_file(const string &file, const string &url, DirectoryIterator & d,
+	      const map<string, string>& mime_map, vector<string> & started)
+{
+    try {
+	if (d.get_type() != DirectoryIterator::REGULAR_FILE)
+	    return true;
+
+	string ext;
+	map<string, string>::const_iterator mt = find_mimetype(d, mime_map, ext);
+	if (mt == mime_map.end())
+	    return true;
+	const string & mimetype = mt->second;
+
+	string cmd, cmd2;
+	map<string, Filter>::const_iterator cmd_it = commands.find(mimetype);
+	if (cmd_it != commands.end()) {
+	    cmd = cmd_it->second.cmd;
+	    if (cmd.empty())
+		return true;
+	    append_filename_argument(cmd, file);
+	} else if (mimetype == "application/pdf") {
+	    cmd = pdftotext_command(file);
+	    cmd2 = pdfinfo_command(file);
+	} else {
+	    return true;
+	}
+
+	if (d.get_size() == 0 || (max_size > 0 && d.get_size() > max_size))
+	    return true;
+
+	// Check if index_mimetype() will decide the file is up to date.
+	time_t last_mod = d.get_mtime();
+	if (skip_duplicates || last_mod <= last_mod_max) {
+	    string urlterm = get_urlterm(url);
+	    Xapian::PostingIterator p = db.postlist_begin(urlterm);
+	    if (p != db.postlist_end(urlterm)) {
+		if (skip_duplicates)
+		    return true;
+		Xapian::Document doc = db.get_document(*p);
+		string value = doc.get_value(VALUE_LASTMOD);
+		if (last_mod <= binary_string_to_int(value))
+		    return true;
+	    }
+	}
+
+	if (!prefetch_filter(cmd))
+	    return false;
+	started.push_back(cmd);
+	if (!cmd2.empty() && prefetch_filter(cmd2))
+	    started.push_back(cmd2);
+    } catch (FileNotFound) {
+	// We'll report this when we reach the file.
+    } catch (const std::string &) {
+	// Likewise.
+    }
+    return true;
+}
+
+static void
+index_file(const string &file, const string &url, DirectoryIterator & d,
+	   map<string, string>& mime_map, size_t sample_size)
+{
+    string ext;
+    map<string, string>::const_iterator mt = find_mimetype(d, mime_map, ext);
     if (mt != mime_map.end()) {
 	if (mt->second == "ignore")
 	    return;
@@ -350,11 +464,7 @@ void
 index_mimetype(const string & file, const string & url, const string & ext,
 	       const string &mimetype, DirectoryIterator &d, size_t sample_size)
 {
-    string urlterm("U");
-    urlterm += url;
-
-    if (urlterm.length() > MAX_SAFE_TERM_LENGTH)
-	urlterm = hash_long_term(urlterm, MAX_SAFE_TERM_LENGTH);
+    string urlterm = get_urlterm(url);
 
     time_t last_mod = d.get_mtime();
     time_t created = time_t(-1);
@@ -478,9 +588,7 @@ index_mimetype(const string & file, const string & url, const string & ext,
 		// FIXME: What charset is the file?  Look at contents?
 	    }
 	} else if (mimetype == "application/pdf") {
-	    string cmd = "pdftotext -enc UTF-8";
-	    append_filename_argument(cmd, file);
-	    cmd += " -";
+	    string cmd = pdftotext_command(file);
 	    try {
 		dump = stdout_to_string(cmd);
 	    } catch (ReadError) {
@@ -511,9 +619,7 @@ index_mimetype(const string & file, const string & url, const string & ext,
 	    append_filename_argument(cmd, tmpfile);
 	    try {
 		(void)stdout_to_string(cmd);
-		cmd = "pdftotext -enc UTF-8";
-		append_filename_argument(cmd, tmpfile);
-		cmd += " -";
+		cmd = pdftotext_command(tmpfile);
 		dump = stdout_to_string(cmd);
 	    } catch (ReadError) {
 		skip_cmd_failed(file, cmd);
@@ -994,6 +1100,30 @@ index_mimetype(const string & file, const string & url, const string & ext,
     }
 }
 
+/// Is the current entry of @a d a directory?
+static bool
+is_directory(DirectoryIterator & d)
+{
+    try {
+	return d.get_type() == DirectoryIterator::DIRECTORY;
+    } catch (FileNotFound) {
+    } catch (const std::string &) {
+    }
+    // We'll report any problem when we process the entry.
+    return false;
+}
+
+/// Kill any filters in @a started which index_file() didn't end up using.
+static void
+discard_prefetched(vector<string> & started)
+{
+    vector<string>::const_iterator i;
+    for (i = started.begin(); i != started.end(); ++i) {
+	discard_prefetched_filter(*i);
+    }
+    started.clear();
+}
+
 static void
 index_directory(const string &path, const string &url_, size_t depth_limit,
 		map<string, string>& mime_map, size_t sample_size)
@@ -1003,10 +1133,58 @@ index_directory(const string &path, const string &url_, size_t depth_limit,
 	     << endl;
 
     DirectoryIterator d(follow_symlinks);
+    // With --jobs, we use a second iterator which runs ahead of d, starting
+    // external filters for the files it finds so they run in parallel.
+    DirectoryIterator ahead(follow_symlinks);
+    bool ahead_ok = (jobs > 1);
+    // The number of entries each iterator has returned so far.
+    size_t d_pos = 0, ahead_pos = 0;
+    // Have we dealt with the current entry of ahead?
+    bool ahead_done = true;
+    // The filter commands we've started for files in this directory.
+    vector<string> prefetched;
     try {
 	d.start(path);
+	if (ahead_ok) {
+	    try {
+		ahead.start(path);
+	    } catch (...) {
+		ahead_ok = false;
+	    }
+	}
 
 	while (d.next()) {
+	    ++d_pos;
+	    // Don't run ahead past a subdirectory until we've indexed it, so
+	    // it gets all the filter slots while we're in there.
+	    bool d_is_dir = ahead_ok && is_directory(d);
+	    while (ahead_ok && !d_is_dir) {
+		if (!ahead_done && ahead_pos > d_pos) {
+		    // Wait here for d to reach the subdirectory.
+		    if (is_directory(ahead))
+			break;
+		    string file = path;
+		    file += ahead.leafname();
+		    string url = url_;
+		    url_encode(url, ahead.leafname());
+		    // Stop if there's no free slot - we'll try this entry
+		    // again after we've processed the next file.
+		    if (!prefetch_file(file, url, ahead, mime_map, prefetched))
+			break;
+		}
+		ahead_done = true;
+		// Don't read too far ahead of d.
+		if (ahead_pos >= d_pos + 4 * jobs)
+		    break;
+		try {
+		    ahead_ok = ahead.next();
+		} catch (...) {
+		    ahead_ok = false;
+		}
+		++ahead_pos;
+		ahead_done = false;
+	    }
+
 	    string url = url_;
 	    url_encode(url, d.leafname());
 	    string file = path;
@@ -1021,6 +1199,9 @@ index_directory(const string &path, const string &url_, size_t depth_limit,
 			}
 			url += '/';
 			file += '/';
+			// Free the slots of any filters started for files we
+			// didn't end up indexing.
+			discard_prefetched(prefetched);
 			index_directory(file, url, new_limit, mime_map, sample_size);
 			break;
 		    }
@@ -1046,6 +1227,8 @@ index_directory(const string &path, const string &url_, size_t depth_limit,
 	cout << error << " - skipping directory "
 		"\"" << path.substr(root.size()) << "\"" << endl;
     }
+
+    discard_prefetched(prefetched);
 }
 
 static off_t
@@ -1109,6 +1292,7 @@ main(int argc, char **argv)
 	{ "empty-docs",	required_argument,	NULL, 'e' },
 	{ "max-size",	required_argument,	NULL, 'm' },
 	{ "sample-size",required_argument,	NULL, 'E' },
+	{ "jobs",	required_argument,	NULL, 'j' },
 	{ 0, 0, NULL, 0 }
     };
 
@@ -1298,7 +1482,7 @@ main(int argc, char **argv)
 
     string dbpath;
     int getopt_ret;
-    while ((getopt_ret = gnu_getopt_long(argc, argv, "hvd:D:U:M:F:l:s:pfSVe:im:E:",
+    while ((getopt_ret = gnu_getopt_long(argc, argv, "hvd:D:U:M:F:l:s:pfSVe:im:E:j:",
 					 longopts, NULL)) != -1) {
 	switch (getopt_ret) {
 	case 'h': {
@@ -1337,6 +1521,8 @@ main(int argc, char **argv)
 "  -E, --sample-size=SIZE    maximum size for the document text sample\n"
 "                            (supports the same formats as --max-size).\n"
 "                            (default: 512)\n"
+"  -j, --jobs=N              run up to N external filter programs at once\n"
+"                            (default: 1)\n"
 "  -v, --verbose             show more information about what is happening\n"
 "      --overwrite           create the database anew (the default is to update\n"
 "                            if the database already exists)" << endl;
@@ -1470,6 +1656,16 @@ main(int argc, char **argv)
 	    cerr << PROG_NAME": bad sample size '" << optarg << "'" << endl;
 	    return 1;
 	}
+	case 'j': {
+	    int arg = atoi(optarg);
+	    if (arg <= 0) {
+		cerr << PROG_NAME": bad number of jobs '" << optarg << "'"
+		     << endl;
+		return 1;
+	    }
+	    jobs = unsigned(arg);
+	    break;
+	}
 	case 'm': {
 	    off_t size = parse_size(optarg);
 	    if (size >= 0) {
@@ -1586,6 +1782,7 @@ main(int argc, char **argv)
 	indexer.set_stemmer(stemmer);
 
 	runfilter_init();
+	runfilter_set_jobs(jobs);
 
 	index_directory(root + start_url, baseurl + start_url, depth_limit, mime_map, sample_size);
 	if (delete_removed_documents && old_docs_not_seen) {
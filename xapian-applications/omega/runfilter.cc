@@ -22,7 +22,9 @@
 
 #include "runfilter.h"
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <string>
 
 #include <sys/types.h>
@@ -47,6 +49,8 @@
 #endif
 
 #include "freemem.h"
+#include "noreturn.h"
+#include "realtime.h"
 
 #ifdef _MSC_VER
 # define popen _popen
@@ -58,6 +62,31 @@ using namespace std;
 #if defined HAVE_FORK && defined HAVE_SOCKETPAIR
 static pid_t pid_to_kill_on_signal;
 
+/** Process ids of filters started by prefetch_filter().
+ *
+ *  Has max_prefetched entries, with unused slots set to 0.  We keep these in
+ *  a plain array so that the signal handler can safely walk it.
+ */
+static pid_t * prefetched_pids = NULL;
+
+/// The maximum number of filters which prefetch_filter() will run at once.
+static size_t max_prefetched = 0;
+
+static void
+kill_prefetched_filters()
+{
+    for (size_t i = 0; i != max_prefetched; ++i) {
+	if (prefetched_pids[i]) {
+#ifdef HAVE_SETPGID
+	    kill(-prefetched_pids[i], SIGKILL);
+#else
+	    kill(prefetched_pids[i], SIGKILL);
+#endif
+	    prefetched_pids[i] = 0;
+	}
+    }
+}
+
 #ifdef HAVE_SIGACTION
 static struct sigaction old_hup_handler;
 static struct sigaction old_int_handler;
@@ -73,6 +102,7 @@ handle_signal(int signum)
 	kill(pid_to_kill_on_signal, SIGKILL);
 	pid_to_kill_on_signal = 0;
     }
+    kill_prefetched_filters();
     switch (signum) {
 	case SIGHUP:
 	    sigaction(signum, &old_hup_handler, NULL);
@@ -122,6 +152,7 @@ handle_signal(int signum)
 	kill(pid_to_kill_on_signal, SIGKILL);
 	pid_to_kill_on_signal = 0;
     }
+    kill_prefetched_filters();
     switch (signum) {
 	case SIGHUP:
 	    signal(signum, old_hup_handler);
@@ -159,11 +190,86 @@ runfilter_init()
 }
 #endif
 
-string
-stdout_to_string(const string &cmd)
-{
-    string out;
 #if defined HAVE_FORK && defined HAVE_SOCKETPAIR
+/** How long to wait without getting any output from a filter before giving
+ *  up, in seconds.
+ */
+static double filter_timeout = 300;
+
+/// A running filter process.
+struct FilterChild {
+    /// The process id of the filter.
+    pid_t pid;
+
+    /// Our side of the socket pair, or -1 once we've read to EOF.
+    int fd;
+
+    /// Set if reading from the filter failed.
+    bool read_failed;
+
+    /** When to give up on the filter if it hasn't produced any more output.
+     *
+     *  This is set when we start collecting the filter's output, so time a
+     *  prefetched filter spends blocked because nobody was reading its
+     *  output doesn't count.  It's per filter so that output from other
+     *  filters running in the background doesn't keep a hung filter alive.
+     */
+    double deadline;
+
+    /// The output read from the filter so far.
+    string out;
+
+    FilterChild() : pid(0), fd(-1), read_failed(false), deadline(0) { }
+};
+
+/// Filters started by prefetch_filter() whose output hasn't been collected.
+static map<string, FilterChild> prefetched;
+
+/// Set the prefetched_pids entry for @a old_pid to @a new_pid.
+static void
+set_prefetched_pid(pid_t old_pid, pid_t new_pid)
+{
+    for (size_t i = 0; i != max_prefetched; ++i) {
+	if (prefetched_pids[i] == old_pid) {
+	    prefetched_pids[i] = new_pid;
+	    return;
+	}
+    }
+}
+
+/// Kill filter @a child and any children it in turn forked.
+static void
+kill_filter(const FilterChild & child)
+{
+#ifdef HAVE_SETPGID
+    kill(-child.pid, SIGKILL);
+#else
+    kill(child.pid, SIGKILL);
+#endif
+}
+
+/// Wait for filter @a child to exit, and return its exit status.
+static int
+reap_filter(FilterChild & child)
+{
+    if (child.fd >= 0) {
+	close(child.fd);
+	child.fd = -1;
+    }
+    int status = 0;
+    while (waitpid(child.pid, &status, 0) < 0) {
+	if (errno != EINTR) {
+	    status = -1;
+	    break;
+	}
+    }
+    return status;
+}
+
+/// Start running filter command @a cmd.
+static void
+start_filter(const string &cmd, FilterChild & child)
+{
     // We want to be able to get the exit status of the child process.
     signal(SIGCHLD, SIG_DFL);
 
@@ -171,17 +277,17 @@ stdout_to_string(const string &cmd)
     if (socketpair(AF_UNIX, SOCK_STREAM, PF_UNSPEC, fds) < 0)
 	throw ReadError();
 
-    pid_t child = fork();
-    if (child == 0) {
+    child.pid = fork();
+    if (child.pid == 0) {
 	// We're the child process.
 
 #ifdef HAVE_SETPGID
 	// Put the child process into its own process group, so that we can
 	// easily kill it and any children it in turn forks if we need to.
 	setpgid(0, 0);
-	pid_to_kill_on_signal = -child;
+	pid_to_kill_on_signal = -child.pid;
 #else
-	pid_to_kill_on_signal = child;
+	pid_to_kill_on_signal = child.pid;
 #endif
 
 	// Close the parent's side of the socket pair.
@@ -227,78 +333,199 @@ stdout_to_string(const string &cmd)
 
     // Close the child's side of the socket pair.
     close(fds[1]);
-    if (child == -1) {
+    if (child.pid == -1) {
 	// fork() failed.
 	close(fds[0]);
 	throw ReadError();
     }
 
-    int fd = fds[0];
+    child.fd = fds[0];
+}
 
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    while (true) {
-	// If we wait 300 seconds (5 minutes) without getting data from the
-	// filter, then give up to avoid waiting forever for a filter which
-	// has ended up blocked waiting for something which will never happen.
-	struct timeval tv;
-	tv.tv_sec = 300;
-	tv.tv_usec = 0;
-	FD_SET(fd, &readfds);
-	int r = select(fd + 1, &readfds, NULL, NULL, &tv);
-	if (r <= 0) {
-	    if (r < 0) {
-		if (errno == EINTR) {
-		    // select() interrupted by a signal, so retry.
-		    continue;
-		}
-		cerr << "Reading from filter failed (" << strerror(errno) << ")"
-		     << endl;
-	    } else {
-		cerr << "Filter inactive for too long" << endl;
-	    }
-#ifdef HAVE_SETPGID
-	    kill(-child, SIGKILL);
-#else
-	    kill(child, SIGKILL);
-#endif
-	    close(fd);
-	    int status = 0;
-	    while (waitpid(child, &status, 0) < 0 && errno == EINTR) { }
-	    pid_to_kill_on_signal = 0;
-	    throw ReadError();
+/** Read whatever output is available from filter @a child.
+ *
+ *  Sets child.fd to -1 at EOF, and child.read_failed if there's an error.
+ */
+static void
+read_filter(FilterChild & child)
+{
+    char buf[4096];
+    ssize_t res = read(child.fd, buf, sizeof(buf));
+    if (res > 0) {
+	child.out.append(buf, res);
+	child.deadline = RealTime::now() + filter_timeout;
+	return;
+    }
+    if (res == -1 && errno == EINTR) {
+	// read() interrupted by a signal, so just retry next time.
+	return;
+    }
+    if (res == -1) child.read_failed = true;
+    close(child.fd);
+    child.fd = -1;
+}
+
+/// Kill filter @a child which we've given up on, and throw ReadError.
+XAPIAN_NORETURN(static void abandon_filter(FilterChild & child));
+static void
+abandon_filter(FilterChild & child)
+{
+    kill_filter(child);
+    (void)reap_filter(child);
+    pid_to_kill_on_signal = 0;
+    throw ReadError();
+}
+
+/** Read the output of filter @a child until EOF, and wait for it to exit.
+ *
+ *  While waiting, we also read the output of any prefetched filters, so that
+ *  they don't stall because their output isn't being consumed.
+ *
+ *  @return The exit status of the filter.
+ */
+static int
+collect_filter(FilterChild & child)
+{
+    child.deadline = RealTime::now() + filter_timeout;
+    while (child.fd >= 0) {
+	fd_set readfds;
+	FD_ZERO(&readfds);
+	FD_SET(child.fd, &readfds);
+	int maxfd = child.fd;
+	map<string, FilterChild>::iterator i;
+	for (i = prefetched.begin(); i != prefetched.end(); ++i) {
+	    int fd = i->second.fd;
+	    if (fd < 0) continue;
+	    FD_SET(fd, &readfds);
+	    if (fd > maxfd) maxfd = fd;
 	}
 
-	char buf[4096];
-	ssize_t res = read(fd, buf, sizeof(buf));
-	if (res == 0) break;
-	if (res == -1) {
+	// If we wait filter_timeout seconds (5 minutes by default) without
+	// getting data from the filter, then give up to avoid waiting forever
+	// for a filter which has ended up blocked waiting for something which
+	// will never happen.
+	double remaining = child.deadline - RealTime::now();
+	if (remaining <= 0) {
+	    cerr << "Filter inactive for too long" << endl;
+	    abandon_filter(child);
+	}
+	struct timeval tv;
+	tv.tv_sec = long(remaining);
+	tv.tv_usec = long((remaining - tv.tv_sec) * 1e6);
+	int r = select(maxfd + 1, &readfds, NULL, NULL, &tv);
+	if (r < 0) {
 	    if (errno == EINTR) {
-		// read() interrupted by a signal, so retry.
+		// select() interrupted by a signal, so retry.
 		continue;
 	    }
-	    close(fd);
-#ifdef HAVE_SETPGID
-	    kill(-child, SIGKILL);
-#endif
-	    int status = 0;
-	    while (waitpid(child, &status, 0) < 0 && errno == EINTR) { }
-	    pid_to_kill_on_signal = 0;
-	    throw ReadError();
+	    cerr << "Reading from filter failed (" << strerror(errno) << ")"
+		 << endl;
+	    abandon_filter(child);
+	}
+	// If select() timed out, we'll notice at the top of the loop.
+
+	for (i = prefetched.begin(); i != prefetched.end(); ++i) {
+	    int fd = i->second.fd;
+	    if (fd >= 0 && FD_ISSET(fd, &readfds))
+		read_filter(i->second);
 	}
-	out.append(buf, res);
+	if (FD_ISSET(child.fd, &readfds))
+	    read_filter(child);
     }
 
-    close(fd);
 #ifdef HAVE_SETPGID
-    kill(-child, SIGKILL);
+    kill(-child.pid, SIGKILL);
 #endif
-    int status = 0;
-    while (waitpid(child, &status, 0) < 0) {
-	if (errno != EINTR)
-	    throw ReadError();
-    }
+    int status = reap_filter(child);
     pid_to_kill_on_signal = 0;
+    if (child.read_failed || status == -1)
+	throw ReadError();
+    return status;
+}
+
+void
+runfilter_set_timeout(double secs)
+{
+    filter_timeout = secs;
+}
+
+void
+runfilter_set_jobs(unsigned n)
+{
+    // Only expected to be called once, before any filters are run.
+    size_t new_max = (n > 1) ? n - 1 : 0;
+    pid_t * new_pids = new pid_t[new_max];
+    fill(new_pids, new_pids + new_max, pid_t(0));
+    delete [] prefetched_pids;
+    prefetched_pids = new_pids;
+    max_prefetched = new_max;
+}
+
+bool
+prefetch_filter(const string &cmd)
+{
+    if (prefetched.find(cmd) != prefetched.end()) return true;
+    if (prefetched.size() >= max_prefetched) return false;
+    FilterChild child;
+    try {
+	start_filter(cmd, child);
+    } catch (ReadError) {
+	return false;
+    }
+    prefetched.insert(make_pair(cmd, child));
+    set_prefetched_pid(0, child.pid);
+    return true;
+}
+
+void
+discard_prefetched_filter(const string &cmd)
+{
+    map<string, FilterChild>::iterator i = prefetched.find(cmd);
+    if (i == prefetched.end()) return;
+    set_prefetched_pid(i->second.pid, 0);
+    kill_filter(i->second);
+    (void)reap_filter(i->second);
+    prefetched.erase(i);
+}
+#else
+void
+runfilter_set_timeout(double)
+{
+}
+
+void
+runfilter_set_jobs(unsigned)
+{
+}
+
+bool
+prefetch_filter(const string &)
+{
+    return false;
+}
+
+void
+discard_prefetched_filter(const string &)
+{
+}
+#endif
+
+string
+stdout_to_string(const string &cmd)
+{
+    string out;
+#if defined HAVE_FORK && defined HAVE_SOCKETPAIR
+    FilterChild child;
+    map<string, FilterChild>::iterator i = prefetched.find(cmd);
+    if (i != prefetched.end()) {
+	child = i->second;
+	prefetched.erase(i);
+	set_prefetched_pid(child.pid, 0);
+    } else {
+	start_filter(cmd, child);
+    }
+    int status = collect_filter(child);
+    swap(out, child.out);
 #else
     FILE * fh = popen(cmd.c_str(), "r");
     if (fh == NULL) throw ReadError();
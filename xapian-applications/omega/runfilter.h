@@ -31,6 +31,34 @@ struct NoSuchFilter { };
 /// Initialise the runfilter module.
 void runfilter_init();
 
+/** Set how long to wait for output from a filter before giving up.
+ *
+ *  The default is 300 seconds.  The time is measured separately for each
+ *  filter, from when it was started or last produced output.
+ */
+void runfilter_set_timeout(double secs);
+
+/** Set the number of filters which may run at once.
+ *
+ *  If @a n is more than 1, up to @a n - 1 filters can be started in the
+ *  background by prefetch_filter() while stdout_to_string() is running
+ *  another.
+ */
+void runfilter_set_jobs(unsigned n);
+
+/** Start running command @a cmd in the background.
+ *
+ *  A later call to stdout_to_string() with the same @a cmd collects the
+ *  output rather than running the command again.
+ *
+ *  @return true if @a cmd is now running in the background, false if the
+ *	    limit set by runfilter_set_jobs() has been reached.
+ */
+bool prefetch_filter(const std::string &cmd);
+
+/// Kill @a cmd if it was prefetched and its output hasn't been collected.
+void discard_prefetched_filter(const std::string &cmd);
+
 /// Run command @a cmd, capture its stdout, and return it as a std::string.
 std::string stdout_to_string(const std::string &cmd);
 
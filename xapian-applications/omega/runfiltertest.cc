@@ -0,0 +1,109 @@
+/** @file runfiltertest.cc
+ * @brief Test running external filters
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+#include "runfilter.h"
+#include "safeunistd.h"
+
+using namespace std;
+
+static void
+check_output(const string & cmd, const string & expected)
+{
+    string out;
+    try {
+	out = stdout_to_string(cmd);
+    } catch (ReadError) {
+	cerr << "Running \"" << cmd << "\" failed" << endl;
+	exit(1);
+    }
+    if (out != expected) {
+	cerr << "Output of \"" << cmd << "\" should be \"" << expected
+	     << "\", got \"" << out << "\"" << endl;
+	exit(1);
+    }
+}
+
+int main() {
+#if !(defined HAVE_FORK && defined HAVE_SOCKETPAIR)
+    // The timeout is only implemented when filters are run with fork().
+    return 77;
+#else
+    runfilter_init();
+    runfilter_set_jobs(2);
+    runfilter_set_timeout(3);
+
+    check_output("echo hello", "hello\n");
+
+    // A filter which pauses for less than the timeout between output
+    // shouldn't be killed.
+    check_output("echo a; sleep 1; echo b", "a\nb\n");
+
+    // Output from a prefetched filter should be collected.
+    const char * prefetched = "echo prefetched";
+    if (!prefetch_filter(prefetched)) {
+	cerr << "prefetch_filter() failed" << endl;
+	exit(1);
+    }
+    check_output(prefetched, "prefetched\n");
+
+    // A filter which hangs should time out, even if a prefetched filter is
+    // producing output all the while.
+    const char * chatty = "i=0; while [ $i -lt 15 ]; do "
+			  "echo x; sleep 1; i=`expr $i + 1`; done";
+    if (!prefetch_filter(chatty)) {
+	cerr << "prefetch_filter() failed" << endl;
+	exit(1);
+    }
+    time_t start = time(NULL);
+    try {
+	(void)stdout_to_string("sleep 60");
+	cerr << "Hung filter didn't time out" << endl;
+	exit(1);
+    } catch (ReadError) {
+    }
+    time_t elapsed = time(NULL) - start;
+    if (elapsed > 8) {
+	cerr << "Hung filter took " << elapsed << " seconds to time out"
+	     << endl;
+	exit(1);
+    }
+    discard_prefetched_filter(chatty);
+
+    // A prefetched filter whose output isn't collected for longer than the
+    // timeout shouldn't be treated as hung - it has just been waiting for us.
+    runfilter_set_timeout(1);
+    const char * waiting = "echo waiting";
+    if (!prefetch_filter(waiting)) {
+	cerr << "prefetch_filter() failed" << endl;
+	exit(1);
+    }
+    sleep(3);
+    check_output(waiting, "waiting\n");
+
+    return 0;
+#endif
+}
@@ -120,8 +120,10 @@ Database::reopen()
     bool maybe_changed = false;
     vector<intrusive_ptr<Database::Internal> >::iterator i;
     for (i = internal.begin(); i != internal.end(); ++i) {
-	if ((*i)->reopen())
+	if ((*i)->reopen()) {
+	    ++(*i)->change_count;
 	    maybe_changed = true;
+	}
     }
     return maybe_changed;
 }
@@ -829,8 +831,10 @@ WritableDatabase::cancel_transaction()
     size_t n_dbs = internal.size();
     if (rare(n_dbs == 0))
 	no_subdatabases();
-    for (size_t i = 0; i != n_dbs; ++i)
+    for (size_t i = 0; i != n_dbs; ++i) {
+	++internal[i]->change_count;
 	internal[i]->cancel_transaction();
+    }
 }
 
 
@@ -846,6 +850,7 @@ WritableDatabase::add_document(const Document & document)
 	// Which database will the next never used docid be in?
 	i = sub_db(get_lastdocid() + 1, n_dbs);
     }
+    ++internal[i]->change_count;
     RETURN(internal[i]->add_document(document));
 }
 
@@ -860,6 +865,7 @@ WritableDatabase::delete_document(Xapian::docid did)
     if (rare(n_dbs == 0))
 	no_subdatabases();
     size_t i = sub_db(did, n_dbs);
+    ++internal[i]->change_count;
     internal[i]->delete_document(sub_docid(did, n_dbs));
 }
 
@@ -872,8 +878,10 @@ WritableDatabase::delete_document(const std::string & unique_term)
     size_t n_dbs = internal.size();
     if (rare(n_dbs == 0))
 	no_subdatabases();
-    for (size_t i = 0; i != n_dbs; ++i)
+    for (size_t i = 0; i != n_dbs; ++i) {
+	++internal[i]->change_count;
 	internal[i]->delete_document(unique_term);
+    }
 }
 
 void
@@ -886,6 +894,7 @@ WritableDatabase::replace_document(Xapian::docid did, const Document & document)
     if (rare(n_dbs == 0))
 	no_subdatabases();
     size_t i = sub_db(did, n_dbs);
+    ++internal[i]->change_count;
     internal[i]->replace_document(sub_docid(did, n_dbs), document);
 }
 
@@ -899,6 +908,8 @@ WritableDatabase::replace_document(const std::string & unique_term,
     size_t n_dbs = internal.size();
     if (rare(n_dbs == 0))
 	no_subdatabases();
+    for (size_t i = 0; i != n_dbs; ++i)
+	++internal[i]->change_count;
     if (n_dbs == 1)
 	RETURN(internal[0]->replace_document(unique_term, document));
 
@@ -30,6 +30,7 @@
 #include "xapian/errorhandler.h"
 #include "xapian/expanddecider.h"
 #include "xapian/termiterator.h"
+#include "xapian/version.h" // For XAPIAN_HAS_REMOTE_BACKEND
 #include "xapian/weight.h"
 
 #include "vectortermlist.h"
@@ -41,6 +42,8 @@
 #include "matcher/multimatch.h"
 #include "omassert.h"
 #include "api/omenquireinternal.h"
+#include "pack.h"
+#include "serialise-double.h"
 #include "str.h"
 #include "weight/weightinternal.h"
 
@@ -148,6 +151,35 @@ MSetItem::get_description() const
     return description;
 }
 
+string
+serialise_continuation(const MSetItem & item)
+{
+    string token = serialise_double(item.wt);
+    pack_uint(token, item.did);
+    token += item.sort_key;
+    return token;
+}
+
+MSetItem
+unserialise_continuation(const string & token)
+{
+    const char * p = token.data();
+    const char * end = p + token.size();
+    double wt;
+    Xapian::docid did;
+    try {
+	wt = unserialise_double(&p, end);
+    } catch (const Xapian::SerialisationError &) {
+	wt = -1.0;
+    }
+    if (wt < 0.0 || !unpack_uint(&p, end, &did)) {
+	throw InvalidArgumentError("Invalid continuation token");
+    }
+    MSetItem item(wt, did);
+    item.sort_key.assign(p, end - p);
+    return item;
+}
+
 }
 
 // Methods for Xapian::MSet
@@ -309,6 +341,14 @@ MSet::get_max_attained() const
     return internal->max_attained;
 }
 
+string
+MSet::get_continuation() const
+{
+    Assert(internal.get() != 0);
+    if (internal->items.empty()) return string();
+    return Xapian::Internal::serialise_continuation(internal->items.back());
+}
+
 Xapian::doccount
 MSet::size() const
 {
@@ -630,7 +670,8 @@ MSetIterator::get_description() const
 // Methods for Xapian::Enquire::Internal
 
 Enquire::Internal::Internal(const Database &db_, ErrorHandler * errorhandler_)
-  : db(db_), query(), collapse_key(Xapian::BAD_VALUENO), collapse_max(0),
+  : db(db_), query(), prepared_stats(0),
+    collapse_key(Xapian::BAD_VALUENO), collapse_max(0),
     order(Enquire::ASCENDING), percent_cutoff(0), weight_cutoff(0),
     sort_key(Xapian::BAD_VALUENO), sort_by(REL), sort_value_forward(true),
     sorter(0), time_limit(0.0), errorhandler(errorhandler_), weight(0)
@@ -644,6 +685,33 @@ Enquire::Internal::~Internal()
 {
     delete weight;
     weight = 0;
+    clear_prepared_stats();
+}
+
+/// Does @a db have any remote sub-databases?
+static bool
+has_remote_subdb(const Xapian::Database & db)
+{
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    for (size_t i = 0; i != db.internal.size(); ++i) {
+	if (db.internal[i]->as_remotedatabase())
+	    return true;
+    }
+#else
+    (void)db;
+#endif
+    return false;
+}
+
+/// Sum the change counts of the sub-databases of @a db.
+static unsigned long
+total_change_count(const Xapian::Database & db)
+{
+    unsigned long count = 0;
+    for (size_t i = 0; i != db.internal.size(); ++i) {
+	count += db.internal[i]->change_count;
+    }
+    return count;
 }
 
 void
@@ -651,6 +719,64 @@ Enquire::Internal::set_query(const Query &query_, termcount qlen_)
 {
     query = query_;
     qlen = qlen_ ? qlen_ : query.get_length();
+    clear_prepared_stats();
+}
+
+void
+Enquire::Internal::clear_prepared_stats() const
+{
+    delete prepared_stats;
+    prepared_stats = 0;
+    prepared_rset.clear();
+}
+
+Xapian::Weight::Internal *
+Enquire::Internal::get_prepared_stats(const RSet *omrset) const
+{
+    if (!prepared_stats) return NULL;
+
+    static const set<Xapian::docid> empty_rset;
+    const set<Xapian::docid> & items =
+	omrset ? omrset->internal->get_items() : empty_rset;
+    if (items != prepared_rset) return NULL;
+
+    // Check the database hasn't been modified or reopened since.
+    if (total_change_count(db) != prepared_change_count) {
+	clear_prepared_stats();
+	return NULL;
+    }
+
+    return prepared_stats;
+}
+
+void
+Enquire::Internal::prepare_mset(const RSet *rset) const
+{
+    LOGCALL_VOID(MATCH, "Enquire::Internal::prepare_mset", rset);
+
+    clear_prepared_stats();
+
+    // Statistics for a remote database arrive in response to the query being
+    // sent, so they can't be collated ahead of the match.
+    if (query.empty() || has_remote_subdb(db)) return;
+
+    if (weight == 0) {
+	weight = new BM25Weight;
+    }
+
+    // Creating a MultiMatch collates the statistics for the query's terms
+    // from each sub-database.
+    AutoPtr<Xapian::Weight::Internal> stats(new Xapian::Weight::Internal);
+    ::MultiMatch match(db, query, qlen, rset,
+		       collapse_max, collapse_key,
+		       percent_cutoff, weight_cutoff,
+		       order, sort_key, sort_by, sort_value_forward,
+		       time_limit, continuation, errorhandler, *stats, weight,
+		       spies, (sorter != NULL), false);
+
+    if (rset) prepared_rset = rset->internal->get_items();
+    prepared_change_count = total_change_count(db);
+    prepared_stats = stats.release();
 }
 
 const Query &
@@ -659,38 +785,40 @@ Enquire::Internal::get_query()
     return query;
 }
 
-MSet
-Enquire::Internal::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
-			    Xapian::doccount check_at_least, const RSet *rset,
-			    const MatchDecider *mdecider) const
+void
+Enquire::Internal::init_match(Xapian::doccount & first,
+			      Xapian::doccount & maxitems,
+			      Xapian::doccount & check_at_least) const
 {
-    LOGCALL(MATCH, MSet, "Enquire::Internal::get_mset", first | maxitems | check_at_least | rset | mdecider);
-
     if (percent_cutoff && (sort_by == VAL || sort_by == VAL_REL)) {
 	throw Xapian::UnimplementedError("Use of a percentage cutoff while sorting primary by value isn't currently supported");
     }
 
+    if (!continuation.empty() && collapse_max) {
+	// Items before the continuation point would need to be collapsed too,
+	// and one of them can displace an item after it from the proto-MSet.
+	throw Xapian::InvalidArgumentError("A continuation token can't be used with collapsing");
+    }
+
     if (weight == 0) {
 	weight = new BM25Weight;
     }
 
-    Xapian::doccount first_orig = first;
-    {
-	Xapian::doccount docs = db.get_doccount();
-	first = min(first, docs);
-	maxitems = min(maxitems, docs);
-	check_at_least = min(check_at_least, docs);
-	check_at_least = max(check_at_least, maxitems);
-    }
+    Xapian::doccount docs = db.get_doccount();
+    first = min(first, docs);
+    maxitems = min(maxitems, docs);
+    check_at_least = min(check_at_least, docs);
+    check_at_least = max(check_at_least, maxitems);
+}
 
-    Xapian::Weight::Internal stats;
-    ::MultiMatch match(db, query, qlen, rset,
-		       collapse_max, collapse_key,
-		       percent_cutoff, weight_cutoff,
-		       order, sort_key, sort_by, sort_value_forward,
-		       time_limit, errorhandler, stats, weight, spies,
-		       (sorter != NULL),
-		       (mdecider != NULL));
+MSet
+Enquire::Internal::run_match(::MultiMatch & match,
+			     Xapian::doccount first_orig,
+			     Xapian::doccount first, Xapian::doccount maxitems,
+			     Xapian::doccount check_at_least,
+			     Xapian::Weight::Internal & stats,
+			     const MatchDecider *mdecider) const
+{
     // Run query and put results into supplied Xapian::MSet object.
     MSet retval;
     match.get_mset(first, maxitems, check_at_least, retval,
@@ -710,6 +838,89 @@ Enquire::Internal::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     return retval;
 }
 
+MSet
+Enquire::Internal::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
+			    Xapian::doccount check_at_least, const RSet *rset,
+			    const MatchDecider *mdecider) const
+{
+    LOGCALL(MATCH, MSet, "Enquire::Internal::get_mset", first | maxitems | check_at_least | rset | mdecider);
+
+    Xapian::doccount first_orig = first;
+    init_match(first, maxitems, check_at_least);
+
+    Xapian::Weight::Internal local_stats;
+    Xapian::Weight::Internal * prepared = get_prepared_stats(rset);
+    Xapian::Weight::Internal & stats = prepared ? *prepared : local_stats;
+    ::MultiMatch match(db, query, qlen, rset,
+		       collapse_max, collapse_key,
+		       percent_cutoff, weight_cutoff,
+		       order, sort_key, sort_by, sort_value_forward,
+		       time_limit, continuation, errorhandler, stats, weight,
+		       spies, (sorter != NULL),
+		       (mdecider != NULL),
+		       (prepared != NULL));
+    RETURN(run_match(match, first_orig, first, maxitems, check_at_least,
+		     stats, mdecider));
+}
+
+void
+Enquire::Internal::get_msets(const vector<Query> & queries,
+			     Xapian::doccount first, Xapian::doccount maxitems,
+			     Xapian::doccount check_at_least,
+			     const RSet *rset, const MatchDecider *mdecider,
+			     vector<MSet> & msets) const
+{
+    LOGCALL_VOID(MATCH, "Enquire::Internal::get_msets", queries | first | maxitems | check_at_least | rset | mdecider | Literal("msets"));
+
+    // A continuation token marks a position in the results of one
+    // particular query, so it doesn't make sense for the others.
+    if (!continuation.empty()) {
+	throw Xapian::InvalidArgumentError("A continuation token can't be used with get_msets()");
+    }
+
+    Xapian::doccount first_orig = first;
+    init_match(first, maxitems, check_at_least);
+
+    msets.clear();
+    msets.reserve(queries.size());
+
+    // Statistics for a remote database arrive in response to the query being
+    // sent, so we can only collate them up front if all the sub-databases
+    // are local.
+    bool batch = !has_remote_subdb(db);
+
+    // Mark the terms from every query as wanted, so that the first
+    // MultiMatch which actually looks up statistics does so for the union
+    // of the terms in a single pass over each sub-database.  Terms shared
+    // between queries are then only looked up once.
+    Xapian::Weight::Internal shared_stats;
+    vector<Query>::const_iterator q;
+    if (batch) {
+	for (q = queries.begin(); q != queries.end(); ++q) {
+	    shared_stats.mark_wanted_terms(*q);
+	}
+    }
+
+    bool stats_prepared = false;
+    for (q = queries.begin(); q != queries.end(); ++q) {
+	Xapian::Weight::Internal local_stats;
+	Xapian::Weight::Internal & stats = batch ? shared_stats : local_stats;
+	::MultiMatch match(db, *q, q->get_length(), rset,
+			   collapse_max, collapse_key,
+			   percent_cutoff, weight_cutoff,
+			   order, sort_key, sort_by, sort_value_forward,
+			   time_limit, string(), errorhandler, stats,
+			   weight, spies, (sorter != NULL),
+			   (mdecider != NULL),
+			   stats_prepared);
+	// MultiMatch doesn't look up any statistics for an empty query.
+	if (batch && !q->empty()) stats_prepared = true;
+
+	msets.push_back(run_match(match, first_orig, first, maxitems,
+				  check_at_least, stats, mdecider));
+    }
+}
+
 ESet
 Enquire::Internal::get_eset(Xapian::termcount maxitems,
                     const RSet & rset, int flags, double k,
@@ -1030,6 +1241,28 @@ Enquire::set_time_limit(double time_limit)
     internal->time_limit = time_limit;
 }
 
+void
+Enquire::set_continuation(const string & token)
+{
+    LOGCALL_VOID(API, "Xapian::Enquire::set_continuation", token);
+    // Check the token is valid now, rather than failing in get_mset().
+    if (!token.empty()) (void)Xapian::Internal::unserialise_continuation(token);
+    internal->continuation = token;
+}
+
+void
+Enquire::prepare_mset(const RSet *rset) const
+{
+    LOGCALL_VOID(API, "Xapian::Enquire::prepare_mset", rset);
+
+    try {
+	internal->prepare_mset(rset);
+    } catch (Error & e) {
+	if (internal->errorhandler) (*internal->errorhandler)(e);
+	throw;
+    }
+}
+
 MSet
 Enquire::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 		  Xapian::doccount check_at_least, const RSet *rset,
@@ -1046,6 +1279,25 @@ Enquire::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     }
 }
 
+vector<MSet>
+Enquire::get_msets(const vector<Query> & queries,
+		   Xapian::doccount first, Xapian::doccount maxitems,
+		   Xapian::doccount check_at_least, const RSet *rset,
+		   const MatchDecider *mdecider) const
+{
+    LOGCALL(API, vector<Xapian::MSet>, "Xapian::Enquire::get_msets", queries | first | maxitems | check_at_least | rset | mdecider);
+
+    try {
+	vector<MSet> msets;
+	internal->get_msets(queries, first, maxitems, check_at_least, rset,
+			    mdecider, msets);
+	RETURN(msets);
+    } catch (Error & e) {
+	if (internal->errorhandler) (*internal->errorhandler)(e);
+	throw;
+    }
+}
+
 ESet
 Enquire::get_eset(Xapian::termcount maxitems, const RSet & rset, int flags,
 		  double k, const ExpandDecider * edecider, double min_wt) const
@@ -31,6 +31,7 @@
 #include "xapian/enquire.h"
 #include "xapian/query.h"
 #include "xapian/keymaker.h"
+#include "xapian/weight.h"
 
 #include <algorithm>
 #include <cmath>
@@ -108,6 +109,19 @@ class MSetItem {
 	string get_description() const;
 };
 
+/** Serialise @a item as a continuation token.
+ *
+ *  The token records the weight, docid and sort key of @a item, which is
+ *  all the matcher needs to compare other items against it.
+ */
+string serialise_continuation(const MSetItem & item);
+
+/** Unserialise a continuation token.
+ *
+ *  @exception Xapian::InvalidArgumentError if @a token isn't valid.
+ */
+MSetItem unserialise_continuation(const string & token);
+
 }
 
 /** Internals of enquire system.
@@ -125,6 +139,49 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 	/// The query length.
 	termcount qlen;
 
+	/** Statistics collated by prepare_mset() for the current query.
+	 *
+	 *  NULL if prepare_mset() hasn't been called since the query was
+	 *  last set.
+	 */
+	mutable Xapian::Weight::Internal * prepared_stats;
+
+	/// The relevance set @a prepared_stats was collated for.
+	mutable std::set<Xapian::docid> prepared_rset;
+
+	/** The total change_count of the sub-databases when @a prepared_stats
+	 *  was collated.
+	 */
+	mutable unsigned long prepared_change_count;
+
+	/// Discard any statistics collated by prepare_mset().
+	void clear_prepared_stats() const;
+
+	/** Return the statistics collated by prepare_mset() if they can be
+	 *  used for a match with relevance set @a omrset, or NULL if not.
+	 */
+	Xapian::Weight::Internal * get_prepared_stats(const RSet *omrset) const;
+
+	/** Check the match settings are usable and prepare to run a match.
+	 *
+	 *  This creates the default weighting scheme if none has been set,
+	 *  and clamps @a first, @a maxitems and @a check_at_least to the
+	 *  number of documents.
+	 */
+	void init_match(Xapian::doccount & first, Xapian::doccount & maxitems,
+			Xapian::doccount & check_at_least) const;
+
+	/** Run @a match and return the MSet.
+	 *
+	 *  @param first_orig	The value of first before init_match() clamped
+	 *			it.
+	 */
+	MSet run_match(::MultiMatch & match, Xapian::doccount first_orig,
+		       Xapian::doccount first, Xapian::doccount maxitems,
+		       Xapian::doccount check_at_least,
+		       Xapian::Weight::Internal & stats,
+		       const MatchDecider *mdecider) const;
+
 	/// Copy not allowed
 	Internal(const Internal &);
 	/// Assignment not allowed
@@ -151,6 +208,12 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 
 	double time_limit;
 
+	/** Continuation token from MSet::get_continuation() (or empty).
+	 *
+	 *  If set, only items ranking after it are returned.
+	 */
+	string continuation;
+
 	/** The error handler, if set.  (0 if not set).
 	 */
 	ErrorHandler * errorhandler;
@@ -177,11 +240,19 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 
 	void set_query(const Query & query_, termcount qlen_);
 	const Query & get_query();
+	void prepare_mset(const RSet *omrset) const;
 	MSet get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 		      Xapian::doccount check_at_least,
 		      const RSet *omrset,
 		      const MatchDecider *mdecider) const;
 
+	void get_msets(const vector<Query> & queries,
+		       Xapian::doccount first, Xapian::doccount maxitems,
+		       Xapian::doccount check_at_least,
+		       const RSet *omrset,
+		       const MatchDecider *mdecider,
+		       vector<MSet> & msets) const;
+
 	ESet get_eset(Xapian::termcount maxitems, const RSet & omrset, int flags,
 		      double k, const ExpandDecider *edecider, double min_wt) const;
 
@@ -210,6 +281,26 @@ class MSet::Internal : public Xapian::Internal::intrusive_base {
 	/// Read and cache the documents so far requested.
 	void read_docs() const;
 
+	/** Check the match settings are usable and prepare to run a match.
+	 *
+	 *  This creates the default weighting scheme if none has been set,
+	 *  and clamps @a first, @a maxitems and @a check_at_least to the
+	 *  number of documents.
+	 */
+	void init_match(Xapian::doccount & first, Xapian::doccount & maxitems,
+			Xapian::doccount & check_at_least) const;
+
+	/** Run @a match and return the MSet.
+	 *
+	 *  @param first_orig	The value of first before init_match() clamped
+	 *			it.
+	 */
+	MSet run_match(::MultiMatch & match, Xapian::doccount first_orig,
+		       Xapian::doccount first, Xapian::doccount maxitems,
+		       Xapian::doccount check_at_least,
+		       Xapian::Weight::Internal & stats,
+		       const MatchDecider *mdecider) const;
+
 	/// Copy not allowed
 	Internal(const Internal &);
 	/// Assignment not allowed
@@ -10,6 +10,7 @@ noinst_HEADERS +=\
 	backends/positionlist.h\
 	backends/prefix_compressed_strings.h\
 	backends/slowvaluelist.h\
+	backends/termstatscache.h\
 	backends/valuelist.h\
 	backends/valuestats.h
 
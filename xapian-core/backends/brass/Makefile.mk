@@ -22,6 +22,7 @@ noinst_HEADERS +=\
 	backends/brass/brass_postlist.h\
 	backends/brass/brass_record.h\
 	backends/brass/brass_replicate_internal.h\
+	backends/brass/brass_snapshots.h\
 	backends/brass/brass_spelling.h\
 	backends/brass/brass_spellingwordslist.h\
 	backends/brass/brass_synonym.h\
@@ -50,6 +51,7 @@ lib_src +=\
 	backends/brass/brass_positionlist.cc\
 	backends/brass/brass_postlist.cc\
 	backends/brass/brass_record.cc\
+	backends/brass/brass_snapshots.cc\
 	backends/brass/brass_spelling.cc\
 	backends/brass/brass_spellingwordslist.cc\
 	backends/brass/brass_synonym.cc\
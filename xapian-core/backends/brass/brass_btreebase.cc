@@ -26,6 +26,7 @@
 #include <xapian/error.h>
 
 #include "brass_btreebase.h"
+#include "common/compression_stream.h"
 #include "fd.h"
 #include "io_utils.h"
 #include "omassert.h"
@@ -55,7 +56,9 @@ using namespace std;
  * 		higher then it is a different format which we
  * 		doesn't yet understand, so we bomb out.  If it's lower,
  * 		then it depends if we have backwards-compatibility code
- * 		implemented (we don't for format versions < 5).
+ * 		implemented (we don't for format versions < 5).  Format 5
+ * 		is written for tables which use zlib compression (or none),
+ * 		so that older versions can still read them.
  * BLOCK_SIZE
  * ROOT
  * LEVEL
@@ -63,11 +66,17 @@ using namespace std;
  * ITEM_COUNT
  * LAST_BLOCK
  * HAVE_FAKEROOT
+ * SEQUENTIAL
+ * CODEC	The codec used to compress tags (see compression_stream.h).
+ * 		Only present for format 6 - for format 5 it's zlib.
  * REVISION2	A second copy of the revision number, for consistency checks.
  * BITMAP	The bitmap.  This will be BIT_MAP_SIZE raw bytes.
  * REVISION3	A third copy of the revision number, for consistency checks.
  */
-#define CURR_FORMAT 5U
+#define CURR_FORMAT 6U
+
+/// The format used when CODEC would be zlib.
+#define ZLIB_FORMAT 5U
 
 BrassTable_base::BrassTable_base()
 	: revision(0),
@@ -79,9 +88,13 @@ BrassTable_base::BrassTable_base()
 	  last_block(0),
 	  have_fakeroot(false),
 	  sequential(false),
+	  codec(CODEC_ZLIB),
 	  bit_map_low(0),
 	  bit_map0(0),
-	  bit_map(0)
+	  bit_map(0),
+	  changed_low(uint4(-1)),
+	  changed_high(0),
+	  freed_low(uint4(-1))
 {
 }
 
@@ -97,9 +110,15 @@ BrassTable_base::swap(BrassTable_base &other)
     std::swap(last_block, other.last_block);
     std::swap(have_fakeroot, other.have_fakeroot);
     std::swap(sequential, other.sequential);
+    std::swap(codec, other.codec);
     std::swap(bit_map_low, other.bit_map_low);
     std::swap(bit_map0, other.bit_map0);
     std::swap(bit_map, other.bit_map);
+    std::swap(changed_low, other.changed_low);
+    std::swap(changed_high, other.changed_high);
+    std::swap(freed_low, other.freed_low);
+    // bit_map_pinned, block_revision and pinned_blocks belong to the table rather than to
+    // a particular revision, so they aren't swapped.
 }
 
 BrassTable_base::~BrassTable_base()
@@ -179,7 +198,7 @@ BrassTable_base::read(const string & name, char ch, bool read_bitmap,
     DO_UNPACK_UINT_ERRCHECK(&start, end, revision);
     uint4 format;
     DO_UNPACK_UINT_ERRCHECK(&start, end, format);
-    if (format != CURR_FORMAT) {
+    if (format != CURR_FORMAT && format != ZLIB_FORMAT) {
 	err_msg += "Bad base file format " + str(format) + " in " +
 		    basename + "\n";
 	return false;
@@ -198,6 +217,16 @@ BrassTable_base::read(const string & name, char ch, bool read_bitmap,
     DO_UNPACK_UINT_ERRCHECK(&start, end, sequential_);
     sequential = sequential_;
 
+    codec = CODEC_ZLIB;
+    if (format == CURR_FORMAT) {
+	DO_UNPACK_UINT_ERRCHECK(&start, end, codec);
+	if (codec == CODEC_ZLIB) {
+	    err_msg += "Format " + str(format) + " with zlib codec in " +
+		       basename + "\n";
+	    return false;
+	}
+    }
+
     if (have_fakeroot && !sequential) {
 	sequential = true; // FIXME : work out why we need this...
 	/*
@@ -223,6 +252,8 @@ BrassTable_base::read(const string & name, char ch, bool read_bitmap,
     bit_map0 = 0;
     delete [] bit_map;
     bit_map = 0;
+    bit_map_low = 0;
+    reset_changed();
 
     if (!read_bitmap)
 	return true;
@@ -274,13 +305,14 @@ BrassTable_base::write_to_file(const string &filename,
 			       char base_letter,
 			       const string &tablename,
 			       int changes_fd,
-			       const string * changes_tail)
+			       const string * changes_tail,
+			       bool sync)
 {
     calculate_last_block();
 
     string buf;
     pack_uint(buf, revision);
-    pack_uint(buf, CURR_FORMAT);
+    pack_uint(buf, codec == CODEC_ZLIB ? ZLIB_FORMAT : CURR_FORMAT);
     pack_uint(buf, block_size);
     pack_uint(buf, static_cast<uint4>(root));
     pack_uint(buf, static_cast<uint4>(level));
@@ -289,6 +321,7 @@ BrassTable_base::write_to_file(const string &filename,
     pack_uint(buf, static_cast<uint4>(last_block));
     pack_uint(buf, have_fakeroot);
     pack_uint(buf, sequential);
+    if (codec != CODEC_ZLIB) pack_uint(buf, codec);
     pack_uint(buf, revision);  // REVISION2
     if (bit_map_size > 0) {
 	buf.append(reinterpret_cast<const char *>(bit_map), bit_map_size);
@@ -318,7 +351,11 @@ BrassTable_base::write_to_file(const string &filename,
     }
 
     io_write(h, buf.data(), buf.size());
-    io_sync(h);
+    if (sync) {
+	io_sync(h);
+    } else {
+	io_start_sync(h);
+    }
 }
 
 /*
@@ -345,6 +382,8 @@ BrassTable_base::free_block(uint4 n)
     uint4 i = n / CHAR_BIT;
     int bit = 0x1 << n % CHAR_BIT;
     bit_map[i] &= ~ bit;
+    mark_changed(i);
+    if (i < freed_low) freed_low = i;
 
     if (bit_map_low > i)
 	if ((bit_map0[i] & bit) == 0) /* free at start */
@@ -408,12 +447,14 @@ BrassTable_base::next_free_block()
 	    extend_bit_map();
 	}
         x = bit_map0[i] | bit_map[i];
+	if (i < bit_map_pinned.size()) x |= bit_map_pinned[i];
         if (x != UCHAR_MAX) break;
     }
     uint4 n = i * CHAR_BIT;
     int d = 0x1;
     while ((x & d) != 0) { d <<= 1; n++; }
     bit_map[i] |= d;   /* set as 'in use' */
+    mark_changed(i);
     bit_map_low = i;
     if (n > last_block) {
 	last_block = n;
@@ -425,17 +466,27 @@ bool
 BrassTable_base::find_changed_block(uint4 * n)
 {
     // Search for a block which was free at the start of the transaction, but
-    // isn't now.
+    // isn't now.  Only bytes in the changed range can differ, so we only
+    // need to look there.
+    if (*n < changed_low * CHAR_BIT) {
+	if (changed_low >= changed_high) return false;
+	*n = changed_low * CHAR_BIT;
+    }
     while ((*n) <= last_block) {
 	size_t offset = (*n) / CHAR_BIT;
-	int bit = 0x1 << (*n) % CHAR_BIT;
-
-	if (((bit_map0[offset] & bit) == 0) && ((bit_map[offset] & bit) != 0)) {
-	    return true;
+	if (offset >= changed_high) break;
+	int changed = bit_map[offset] & ~bit_map0[offset];
+	// Ignore blocks in this byte before *n.
+	changed &= ~((0x1 << (*n) % CHAR_BIT) - 1);
+	if (changed == 0) {
+	    // Skip to the start of the next byte.
+	    *n = (offset + 1) * CHAR_BIT;
+	    continue;
 	}
-	++(*n);
+	while ((changed & (0x1 << (*n) % CHAR_BIT)) == 0) ++(*n);
+	return (*n) <= last_block;
     }
-    
+
     return false;
 }
 
@@ -475,12 +526,143 @@ void
 BrassTable_base::clear_bit_map()
 {
     memset(bit_map, 0, bit_map_size);
+    if (bit_map_size) {
+	mark_changed(0);
+	mark_changed(bit_map_size - 1);
+    }
+    freed_low = 0;
 }
 
 // We've commited, so "bitmap at start" needs to be reset to the current bitmap.
 void
 BrassTable_base::commit()
 {
-    memcpy(bit_map0, bit_map, bit_map_size);
-    bit_map_low = 0;
+    // Only the changed range can differ.  The bitmap may have been truncated
+    // by calculate_last_block(), in which case the bytes beyond the new end
+    // are zero in bit_map, and will be zero-filled by extend_bit_map() if
+    // they're needed again.
+    uint4 high = min(changed_high, bit_map_size);
+    if (changed_low < high) {
+	memcpy(bit_map0 + changed_low, bit_map + changed_low,
+	       high - changed_low);
+    }
+    // Blocks freed in this transaction can now be reused, so we may need to
+    // start looking for free blocks lower down.  Below both bit_map_low and
+    // freed_low, there were no free blocks in this transaction and none have
+    // been freed, so there are still none.
+    if (freed_low < bit_map_low) bit_map_low = freed_low;
+    reset_changed();
+}
+
+void
+BrassTable_base::release_pinned(uint4 n)
+{
+    uint4 i = n / CHAR_BIT;
+    bit_map_pinned[i] &= ~(0x1 << n % CHAR_BIT);
+    // The block was free when it was pinned, so it may be free now.
+    if (i < bit_map_low) bit_map_low = i;
+}
+
+void
+BrassTable_base::pin_blocks(brass_revision_number_t old_revision,
+			    const vector<brass_revision_number_t> & pinned)
+{
+    Assert(!pinned.empty());
+    bool opening = (pinned.front() == 0);
+
+    typedef map<brass_revision_number_t, vector<pinned_block> > pinned_map;
+    pinned_map::iterator i;
+    if (!opening) {
+	// Release blocks which no reader can need now.  Readers only move to
+	// newer revisions, so a block which isn't needed never will be again.
+	i = pinned_blocks.begin();
+	while (i != pinned_blocks.end()) {
+	    vector<pinned_block> & blocks = i->second;
+	    // Find the newest revision in use which isn't newer than i->first.
+	    vector<brass_revision_number_t>::const_iterator r;
+	    r = upper_bound(pinned.begin(), pinned.end(), i->first);
+	    if (r == pinned.begin()) {
+		// No reader is using a revision any of these blocks were in
+		// use at.
+		while (!blocks.empty()) {
+		    release_pinned(blocks.back().second);
+		    blocks.pop_back();
+		}
+	    } else {
+		brass_revision_number_t newest = *--r;
+		while (!blocks.empty() && blocks.back().first > newest) {
+		    release_pinned(blocks.back().second);
+		    blocks.pop_back();
+		}
+	    }
+	    if (blocks.empty()) {
+		pinned_blocks.erase(i++);
+	    } else {
+		++i;
+	    }
+	}
+    }
+
+    // If we're retrying a commit which failed, forget the previous attempt.
+    i = pinned_blocks.find(old_revision);
+    if (i != pinned_blocks.end()) {
+	for (size_t j = 0; j != i->second.size(); ++j) {
+	    release_pinned(i->second[j].second);
+	}
+	pinned_blocks.erase(i);
+    }
+
+    // Only the changed range of the bit map can contain blocks which this
+    // transaction has allocated or freed.
+    vector<pinned_block> freed;
+    uint4 high = min(changed_high, bit_map_size);
+    for (uint4 j = changed_low; j < high; ++j) {
+	int changed = bit_map0[j] ^ bit_map[j];
+	for (int k = 0; changed; ++k) {
+	    int bit = 0x1 << k;
+	    if ((changed & bit) == 0) continue;
+	    changed &= ~bit;
+	    uint4 n = j * CHAR_BIT + k;
+	    if (bit_map[j] & bit) {
+		// Allocated by this transaction.
+		if (n >= block_revision.size()) block_revision.resize(n + 1);
+		block_revision[n] = old_revision + 1;
+		continue;
+	    }
+	    // Freed by this transaction, so pin it if a reader may be using a
+	    // revision it was in use at.
+	    brass_revision_number_t from = 0;
+	    if (n < block_revision.size()) from = block_revision[n];
+	    if (!opening) {
+		vector<brass_revision_number_t>::const_iterator r;
+		r = lower_bound(pinned.begin(), pinned.end(), from);
+		if (r == pinned.end() || *r > old_revision) continue;
+	    }
+	    if (j >= bit_map_pinned.size()) bit_map_pinned.resize(j + 1);
+	    bit_map_pinned[j] |= bit;
+	    freed.push_back(pinned_block(from, n));
+	}
+    }
+    if (!freed.empty()) {
+	sort(freed.begin(), freed.end());
+	pinned_blocks[old_revision].swap(freed);
+    }
+}
+
+void
+BrassTable_base::unpin_blocks()
+{
+    // Any pinned block might now be free, so make sure next_free_block()
+    // looks at them.
+    map<brass_revision_number_t, vector<pinned_block> >::const_iterator i;
+    for (i = pinned_blocks.begin(); i != pinned_blocks.end(); ++i) {
+	const vector<pinned_block> & blocks = i->second;
+	for (size_t j = 0; j != blocks.size(); ++j) {
+	    uint4 n = blocks[j].second / CHAR_BIT;
+	    if (n < bit_map_low) bit_map_low = n;
+	}
+    }
+    pinned_blocks.clear();
+    bit_map_pinned.clear();
+    vector<brass_revision_number_t>().swap(block_revision);
 }
@@ -23,7 +23,9 @@
 #ifndef OM_HGUARD_BRASS_BTREEBASE_H
 #define OM_HGUARD_BRASS_BTREEBASE_H
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "brass_types.h"
 
@@ -58,6 +60,7 @@ class BrassTable_base {
 	uint4 get_last_block() const { return last_block; }
 	bool get_have_fakeroot() const { return have_fakeroot; }
 	bool get_sequential() const { return sequential; }
+	uint4 get_codec() const { return codec; }
 
 	void set_revision(uint4 revision_) {
 	    revision = revision_;
@@ -80,13 +83,23 @@ class BrassTable_base {
 	void set_sequential(bool sequential_) {
 	    sequential = sequential_;
 	}
+	void set_codec(uint4 codec_) {
+	    codec = codec_;
+	}
 
-	/** Write the btree base file to disk. */
+	/** Write the btree base file to disk.
+	 *
+	 *  @param sync	If true, wait for the base file to reach the disk
+	 *		before returning.  If false, just start writing it to
+	 *		disk - the caller must ensure it is synced before
+	 *		relying on it.
+	 */
 	void write_to_file(const std::string &filename,
 			   char base_letter,
 			   const std::string &tablename,
 			   int changes_fd,
-			   const std::string * changes_tail);
+			   const std::string * changes_tail,
+			   bool sync = true);
 
 	/* Methods dealing with the bitmap */
 	/** true iff block n was free at the start of the transaction on
@@ -113,6 +126,29 @@ class BrassTable_base {
 
 	void commit();
 
+	/** Don't reuse blocks which readers may still be using.
+	 *
+	 *  This must be called before commit().  The blocks which this
+	 *  transaction has freed are kept if a reader may be using a revision
+	 *  they were in use at, and blocks kept earlier which no reader can
+	 *  be using any more are released.
+	 *
+	 *  The work done is proportional to the part of the table which this
+	 *  transaction changed and the number of blocks released, rather than
+	 *  to the size of the table.
+	 *
+	 *  @param old_revision	The revision this transaction started from.
+	 *  @param pinned	The revisions readers are using, in ascending
+	 *			order (mustn't be empty).  Revision 0 means a
+	 *			reader is opening and could be using any
+	 *			revision, so nothing is released.
+	 */
+	void pin_blocks(brass_revision_number_t old_revision,
+			const std::vector<brass_revision_number_t> & pinned);
+
+	/// Allow blocks pinned by pin_blocks() to be reused.
+	void unpin_blocks();
+
 	void swap(BrassTable_base &other);
 
     private:
@@ -124,6 +160,21 @@ class BrassTable_base {
 
 	void extend_bit_map();
 
+	/// Remove block @a n from bit_map_pinned.
+	void release_pinned(uint4 n);
+
+	/// Note that byte @a i of bit_map has been changed.
+	void mark_changed(uint4 i) {
+	    if (i < changed_low) changed_low = i;
+	    if (i >= changed_high) changed_high = i + 1;
+	}
+
+	/// Forget which parts of bit_map have changed.
+	void reset_changed() {
+	    changed_low = freed_low = uint4(-1);
+	    changed_high = 0;
+	}
+
 	/* Decoded values from the base file follow */
 	uint4 revision;
 	uint4 block_size;
@@ -134,6 +185,8 @@ class BrassTable_base {
 	uint4 last_block;
 	bool have_fakeroot;
 	bool sequential;
+	/// The codec used to compress tags (CODEC_ZLIB, etc).
+	uint4 codec;
 
 	/* Data related to the bitmap */
 	/** byte offset into the bit map below which there
@@ -146,6 +199,51 @@ class BrassTable_base {
 
 	/** the current state of the bit map of blocks */
 	byte *bit_map;
+
+	/** Bytes of bit_map which may differ from bit_map0 are in the range
+	 *  [changed_low, changed_high).
+	 *
+	 *  Tracking this means that the work done on commit is proportional
+	 *  to the part of the table which has changed, rather than to the
+	 *  size of the table.
+	 */
+	uint4 changed_low, changed_high;
+
+	/** Lowest byte of bit_map in which a block has been freed since the
+	 *  last commit, or uint4(-1) if none have been.
+	 */
+	uint4 freed_low;
+
+	/** Bit map of blocks which mustn't be reused, even if free in both
+	 *  bit_map0 and bit_map (because a reader may still be using them).
+	 *
+	 *  These are the blocks listed in pinned_blocks.  Usually empty.
+	 *  May be shorter than the other bit maps, in which case the missing
+	 *  bytes are treated as zero.
+	 */
+	std::vector<byte> bit_map_pinned;
+
+	/** The revision at which each block allocated since blocks were first
+	 *  pinned came into use.
+	 *
+	 *  0 means the block was already in use then.  May be shorter than
+	 *  the bit maps, in which case the missing entries are treated as 0.
+	 */
+	std::vector<brass_revision_number_t> block_revision;
+
+	/// A pinned block, and the revision it came into use at.
+	typedef std::pair<brass_revision_number_t, uint4> pinned_block;
+
+	/** The pinned blocks, keyed by the revision which the transaction
+	 *  which freed them started from.
+	 *
+	 *  A block in the list for revision K was in use from the revision
+	 *  stored with it up to K, so only a reader using a revision in that
+	 *  range can need it.  Each list is sorted by the revision stored.
+	 *  A block can't be freed again while it's pinned, so the lists don't
+	 *  overlap.
+	 */
+	std::map<brass_revision_number_t, std::vector<pinned_block> > pinned_blocks;
 };
 
 #endif /* OM_HGUARD_BRASS_BTREEBASE_H */
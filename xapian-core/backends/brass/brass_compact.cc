@@ -498,8 +498,10 @@ merge_spellings(BrassTable * out,
 	string key = cur->current_key;
 	if (pq.empty() || pq.top()->current_key > key) {
 	    // No need to merge the tags, just copy the (possibly compressed)
-	    // tag value.
-	    bool compressed = cur->read_tag(true);
+	    // tag value.  If the tables use different codecs, we have to
+	    // decompress it and let out->add() recompress it.
+	    bool keep = (cur->get_table()->get_codec() == out->get_codec());
+	    bool compressed = cur->read_tag(keep);
 	    out->add(key, cur->current_tag, compressed);
 	    if (cur->next()) {
 		pq.push(cur);
@@ -612,8 +614,10 @@ merge_synonyms(BrassTable * out,
 	string key = cur->current_key;
 	if (pq.empty() || pq.top()->current_key > key) {
 	    // No need to merge the tags, just copy the (possibly compressed)
-	    // tag value.
-	    bool compressed = cur->read_tag(true);
+	    // tag value.  If the tables use different codecs, we have to
+	    // decompress it and let out->add() recompress it.
+	    bool keep = (cur->get_table()->get_codec() == out->get_codec());
+	    bool compressed = cur->read_tag(keep);
 	    out->add(key, cur->current_tag, compressed);
 	    if (cur->next()) {
 		pq.push(cur);
@@ -765,7 +769,8 @@ merge_docid_keyed(const char * tablename,
 	    } else {
 		key = cur.current_key;
 	    }
-	    bool compressed = cur.read_tag(true);
+	    bool keep = (cur.get_table()->get_codec() == out->get_codec());
+	    bool compressed = cur.read_tag(keep);
 	    out->add(key, cur.current_tag, compressed);
 	}
     }
@@ -64,6 +64,7 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include "autoptr.h"
 #include <string>
 
@@ -110,11 +111,15 @@ BrassDatabase::BrassDatabase(const string &brass_dir, int action,
 	  spelling_table(db_dir, readonly),
 	  record_table(db_dir, readonly),
 	  lock(db_dir),
+	  snapshots(db_dir),
 	  max_changesets(0)
 {
     LOGCALL_CTOR(DB, "BrassDatabase", brass_dir | action | block_size);
 
     if (action == XAPIAN_DB_READONLY) {
+	// Ask a writer in this process not to reuse any blocks while we're
+	// opening the tables.
+	snapshots.pin(0);
 	open_tables_consistent();
 	return;
     }
@@ -280,6 +285,7 @@ BrassDatabase::open_tables_consistent()
     }
 
     stats.read(postlist_table);
+    if (readonly) snapshots.pin(revision);
     return true;
 }
 
@@ -385,6 +391,28 @@ BrassDatabase::set_revision_number(brass_revision_number_t new_revision)
     spelling_table.flush_db();
     record_table.flush_db();
 
+    // Don't reuse blocks which readers in this process may still be using.
+    // Only the blocks of revisions which are pinned now are protected, so a
+    // reader which reopens releases the blocks of the revision it had open.
+    vector<brass_revision_number_t> pinned;
+    snapshots.get_pinned(pinned);
+    if (!pinned.empty()) {
+	brass_revision_number_t old_revision = get_revision_number();
+	postlist_table.pin_blocks(old_revision, pinned);
+	position_table.pin_blocks(old_revision, pinned);
+	termlist_table.pin_blocks(old_revision, pinned);
+	synonym_table.pin_blocks(old_revision, pinned);
+	spelling_table.pin_blocks(old_revision, pinned);
+	record_table.pin_blocks(old_revision, pinned);
+    } else {
+	postlist_table.unpin_blocks();
+	position_table.unpin_blocks();
+	termlist_table.unpin_blocks();
+	synonym_table.unpin_blocks();
+	spelling_table.unpin_blocks();
+	record_table.unpin_blocks();
+    }
+
     int changes_fd = -1;
     string changes_name;
     
@@ -443,20 +471,48 @@ BrassDatabase::set_revision_number(brass_revision_number_t new_revision)
 	    postlist_table.write_changed_blocks(changes_fd, compressed);
 	}
 
-	postlist_table.commit(new_revision, changes_fd);
-	position_table.commit(new_revision, changes_fd);
-	termlist_table.commit(new_revision, changes_fd);
-	synonym_table.commit(new_revision, changes_fd);
-	spelling_table.commit(new_revision, changes_fd);
+	// Start all the tables writing to disk before we wait for any of
+	// them.  Where sync_file_range() is available, the writes for all the
+	// tables then proceed in parallel, so the fdatasync() calls which
+	// complete_commit() makes (still one table at a time) mostly find
+	// little left to wait for.  Elsewhere, io_start_sync() does nothing
+	// and the tables are synced one after another as before.
+	postlist_table.start_commit(new_revision, changes_fd);
+	position_table.start_commit(new_revision, changes_fd);
+	termlist_table.start_commit(new_revision, changes_fd);
+	synonym_table.start_commit(new_revision, changes_fd);
+	spelling_table.start_commit(new_revision, changes_fd);
 
 	string changes_tail; // Data to be appended to the changes file
 	if (changes_fd >= 0) {
 	    changes_tail += '\0';
 	    pack_uint(changes_tail, new_revision);
 	}
-	record_table.commit(new_revision, changes_fd, &changes_tail);
-
+	record_table.start_commit(new_revision, changes_fd, &changes_tail);
+
+	// The new revision becomes live when record_table's new base file is
+	// renamed into place, so that must happen last.  We don't issue the
+	// syncs from several threads at once, as nothing else in the library
+	// starts threads.
+	postlist_table.complete_commit();
+	position_table.complete_commit();
+	termlist_table.complete_commit();
+	synonym_table.complete_commit();
+	spelling_table.complete_commit();
+	record_table.complete_commit();
+
+	snapshots.publish(new_revision);
     } catch (...) {
+	// If some of the tables started committing before the failure,
+	// abandon those commits so that the tables are left at the revision
+	// which is still live on disk.
+	postlist_table.abort_commit();
+	position_table.abort_commit();
+	termlist_table.abort_commit();
+	synonym_table.abort_commit();
+	spelling_table.abort_commit();
+	record_table.abort_commit();
+
 	// Remove the changeset, if there was one.
 	if (changes_fd >= 0) {
 	    (void)io_unlink(changes_name);
@@ -490,19 +546,32 @@ BrassDatabase::reopen()
 {
     LOGCALL(DB, bool, "BrassDatabase::reopen", NO_ARGS);
     if (!readonly) return false;
-    return open_tables_consistent();
+    requested_docs.clear();
+    prefetched_docs.clear();
+    // If a writer in this process is publishing its revisions, we can tell
+    // whether there's a new one without going to the disk.
+    brass_revision_number_t latest;
+    if (snapshots.is_pinned() && snapshots.get_published(latest) &&
+	latest == record_table.get_open_revision_number()) {
+	RETURN(false);
+    }
+    RETURN(open_tables_consistent());
 }
 
 void
 BrassDatabase::close()
 {
     LOGCALL_VOID(DB, "BrassDatabase::close", NO_ARGS);
+    requested_docs.clear();
+    prefetched_docs.clear();
     postlist_table.close(true);
     position_table.close(true);
     termlist_table.close(true);
     synonym_table.close(true);
     spelling_table.close(true);
     record_table.close(true);
+    snapshots.unpin();
+    snapshots.withdraw();
     lock.release();
 }
 
@@ -914,6 +983,43 @@ BrassDatabase::open_document(Xapian::docid did, bool lazy) const
     RETURN(new BrassDocument(ptrtothis, did, &value_manager, &record_table));
 }
 
+void
+BrassDatabase::request_document(Xapian::docid did) const
+{
+    LOGCALL_VOID(DB, "BrassDatabase::request_document", did);
+    Assert(did != 0);
+    requested_docs.push_back(did);
+}
+
+Xapian::Document::Internal *
+BrassDatabase::collect_document(Xapian::docid did) const
+{
+    LOGCALL(DB, Xapian::Document::Internal *, "BrassDatabase::collect_document", did);
+    if (!requested_docs.empty()) {
+	// Read the data for all the requested documents in one pass through
+	// the record table.  They're usually requested in rank order, so
+	// sort them into docid order first.  Any documents from an earlier
+	// batch which were never collected are discarded.
+	prefetched_docs.clear();
+	sort(requested_docs.begin(), requested_docs.end());
+	requested_docs.erase(unique(requested_docs.begin(),
+				    requested_docs.end()),
+			     requested_docs.end());
+	record_table.get_records(requested_docs, prefetched_docs);
+	requested_docs.clear();
+    }
+
+    map<Xapian::docid, string>::iterator i = prefetched_docs.find(did);
+    if (i == prefetched_docs.end()) RETURN(open_document(did, true));
+
+    intrusive_ptr<const Database::Internal> ptrtothis(this);
+    Xapian::Document::Internal * doc;
+    doc = new BrassDocument(ptrtothis, did, &value_manager, &record_table,
+			    i->second);
+    prefetched_docs.erase(i);
+    RETURN(doc);
+}
+
 PositionList *
 BrassDatabase::open_position_list(Xapian::docid did, const string & term) const
 {
@@ -1022,20 +1128,59 @@ BrassDatabase::throw_termlist_table_close_exception() const
 
 ///////////////////////////////////////////////////////////////////////////
 
+/** Parse a size in bytes, with an optional K, M or G suffix.
+ *
+ *  Returns 0 if @a p isn't a valid size, or is too large to represent.
+ */
+static size_t
+parse_memory_size(const char * p)
+{
+    // strtoul() would accept leading whitespace and a minus sign.
+    if (!C_isdigit(*p)) return 0;
+    char * end;
+    errno = 0;
+    unsigned long n = strtoul(p, &end, 10);
+    if (errno == ERANGE) return 0;
+    int shift = 0;
+    switch (*end) {
+	case 'G': case 'g':
+	    shift = 30;
+	    break;
+	case 'M': case 'm':
+	    shift = 20;
+	    break;
+	case 'K': case 'k':
+	    shift = 10;
+	    break;
+    }
+    if (shift) ++end;
+    if (*end) return 0;
+    if (n > (size_t(-1) >> shift)) return 0;
+    return size_t(n) << shift;
+}
+
 BrassWritableDatabase::BrassWritableDatabase(const string &dir, int action,
 					       int block_size)
 	: BrassDatabase(dir, action, block_size),
 	  change_count(0),
 	  flush_threshold(0),
+	  flush_memory_threshold(0),
 	  modify_shortcut_document(NULL),
 	  modify_shortcut_docid(0)
 {
     LOGCALL_CTOR(DB, "BrassWritableDatabase", dir | action | block_size);
 
-    const char *p = getenv("XAPIAN_FLUSH_THRESHOLD");
+    snapshots.publish(get_revision_number());
+
+    const char *p = getenv("XAPIAN_FLUSH_MEMORY");
+    if (p) flush_memory_threshold = parse_memory_size(p);
+
+    p = getenv("XAPIAN_FLUSH_THRESHOLD");
     if (p)
 	flush_threshold = atoi(p);
-    if (flush_threshold == 0)
+    // If only a memory limit is specified, don't also flush after a fixed
+    // number of changes.
+    if (flush_threshold == 0 && (p || flush_memory_threshold == 0))
 	flush_threshold = 10000;
 }
 
@@ -1059,6 +1204,9 @@ BrassWritableDatabase::flush_postlist_changes() const
 {
     stats.write(postlist_table);
     inverter.flush(postlist_table);
+    // Merge the value changes too, so that a flush because of memory use
+    // inside a transaction releases the memory they're using.
+    value_manager.merge_changes();
 
     change_count = 0;
 }
@@ -1146,10 +1294,8 @@ BrassWritableDatabase::add_document_(Xapian::docid did,
 	throw;
     }
 
-    // FIXME: this should be done by checking memory usage, not the number of
-    // changes.  We could also look at the amount of data the inverter object
-    // currently holds.
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (need_flush()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1213,7 +1359,8 @@ BrassWritableDatabase::delete_document(Xapian::docid did)
 	throw;
     }
 
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (need_flush()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1385,7 +1532,8 @@ BrassWritableDatabase::replace_document(Xapian::docid did,
 	throw;
     }
 
-    if (++change_count >= flush_threshold) {
+    ++change_count;
+    if (need_flush()) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -31,6 +31,7 @@
 #include "brass_positionlist.h"
 #include "brass_postlist.h"
 #include "brass_record.h"
+#include "brass_snapshots.h"
 #include "brass_spelling.h"
 #include "brass_synonym.h"
 #include "brass_termlisttable.h"
@@ -43,6 +44,7 @@
 #include "noreturn.h"
 
 #include <map>
+#include <vector>
 
 class BrassTermList;
 class BrassAllDocsPostList;
@@ -112,6 +114,9 @@ class BrassDatabase : public Xapian::Database::Internal {
 	/// Lock object.
 	FlintLock lock;
 
+	/// Revision information shared with other databases in this process.
+	BrassSnapshots snapshots;
+
 	/** The maximum number of changesets which should be kept in the
 	 *  database. */
 	unsigned int max_changesets;
@@ -119,6 +124,12 @@ class BrassDatabase : public Xapian::Database::Internal {
 	/// Database statistics.
 	BrassDatabaseStats stats;
 
+	/// Documents passed to request_document() which haven't been read yet.
+	mutable vector<Xapian::docid> requested_docs;
+
+	/// Data for requested documents which haven't been collected yet.
+	mutable map<Xapian::docid, string> prefetched_docs;
+
 	/** Return true if a database exists at the path specified for this
 	 *  database.
 	 */
@@ -274,6 +285,8 @@ class BrassDatabase : public Xapian::Database::Internal {
 	LeafPostList * open_post_list(const string & tname) const;
 	ValueList * open_value_list(Xapian::valueno slot) const;
 	Xapian::Document::Internal * open_document(Xapian::docid did, bool lazy) const;
+	void request_document(Xapian::docid did) const;
+	Xapian::Document::Internal * collect_document(Xapian::docid did) const;
 
 	PositionList * open_position_list(Xapian::docid did, const string & term) const;
 	TermList * open_term_list(Xapian::docid did) const;
@@ -311,9 +324,19 @@ class BrassWritableDatabase : public BrassDatabase {
 	 */
 	mutable Xapian::doccount change_count;
 
-	/// If change_count reaches this threshold we automatically flush.
+	/** If change_count reaches this threshold we automatically flush.
+	 *
+	 *  0 means don't flush based on the number of changes.
+	 */
 	Xapian::doccount flush_threshold;
 
+	/** If the buffered changes use at least this many bytes of memory we
+	 *  automatically flush.
+	 *
+	 *  0 means don't flush based on memory use.
+	 */
+	size_t flush_memory_threshold;
+
 	/** A pointer to the last document which was returned by
 	 *  open_document(), or NULL if there is no such valid document.  This
 	 *  is used purely for comparing with a supplied document to help with
@@ -326,6 +349,15 @@ class BrassWritableDatabase : public BrassDatabase {
 	 */
 	mutable Xapian::docid modify_shortcut_docid;
 
+	/// Should the buffered changes be automatically flushed now?
+	bool need_flush() const {
+	    if (flush_threshold && change_count >= flush_threshold)
+		return true;
+	    return flush_memory_threshold &&
+		   inverter.get_memory_used() +
+		   value_manager.get_memory_used() >= flush_memory_threshold;
+	}
+
 	/// Flush any unflushed postlist changes, but don't commit them.
 	void flush_postlist_changes() const;
 
@@ -361,6 +393,13 @@ class BrassWritableDatabase : public BrassDatabase {
 	Xapian::Document::Internal * open_document(Xapian::docid did,
 						   bool lazy) const;
 
+	/** Don't prefetch documents from a writable database.
+	 *
+	 *  The database could be modified between a document being requested
+	 *  and being collected.
+	 */
+	void request_document(Xapian::docid) const { }
+
 	//@}
 
     public:
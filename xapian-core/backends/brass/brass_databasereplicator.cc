@@ -164,7 +164,7 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
     }
     {
 	FD closer(fd);
-	unsigned char *out = new unsigned char[changeset_blocksize];
+	string out(changeset_blocksize, '\0');
 	CompressionStream comp_stream = CompressionStream(Z_DEFAULT_STRATEGY);
 
 	while (true) {
@@ -189,22 +189,14 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
 
 	    const char * block_ptr;
 	    if (compressed_block_size > 0) {
-
-		conn.get_message_chunk(buf, changeset_blocksize, end_time);
-		comp_stream.lazy_alloc_inflate_zstream();
-		comp_stream.inflate_zstream->next_in = (Bytef*)const_cast<char *>(buf.data());
-		comp_stream.inflate_zstream->avail_in = compressed_block_size;
-		comp_stream.inflate_zstream->next_out = out;
-		comp_stream.inflate_zstream->avail_out = changeset_blocksize;
-		comp_stream.zerr = inflate(comp_stream.inflate_zstream, Z_FINISH);
-		if (comp_stream.zerr != Z_STREAM_END)
-		    throw Xapian::NetworkError("Bad compressed replication changeset");
-
-		unsigned got = comp_stream.inflate_zstream->next_out - out;
-		if (got != changeset_blocksize) {
+		conn.get_message_chunk(buf, compressed_block_size, end_time);
+		if (buf.size() < compressed_block_size)
 		    throw NetworkError("Incomplete block in changeset");
-		}
-		block_ptr = reinterpret_cast<const char *>(out);
+		if (!comp_stream.decompress_block(buf.data(),
+						  compressed_block_size,
+						  &out[0], changeset_blocksize))
+		    throw NetworkError("Bad compressed replication changeset");
+		block_ptr = out.data();
 	    } else {
 		conn.get_message_chunk(buf, changeset_blocksize, end_time);
 		if (buf.size() < changeset_blocksize)
@@ -213,13 +205,8 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
 	    }
 
 	    // Write the block.
-	    // FIXME - should use pwrite if that's available.
-	    if (lseek(fd, off_t(changeset_blocksize) * block_number, SEEK_SET) == -1) {
-		string msg = "Failed to seek to block ";
-		msg += str(block_number);
-		throw DatabaseError(msg, errno);
-	    }
-	    io_write(fd, block_ptr, changeset_blocksize);
+	    io_write_at(fd, block_ptr, changeset_blocksize,
+			off_t(changeset_blocksize) * block_number);
 
 	    if (compressed_block_size > 0) {
 		buf.erase(0, compressed_block_size);
@@ -228,7 +215,6 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
 	    }
 	}
 	io_sync(fd);
-	delete [] out;
     }
 }
 
@@ -32,6 +32,7 @@
 #include "brass_cursor.h"
 #include "brass_table.h"
 #include "brass_types.h"
+#include "filetests.h"
 #include "pack.h"
 #include "backends/valuestats.h"
 
@@ -55,9 +56,65 @@ struct VStats : public ValueStats {
     VStats() : ValueStats(), freq_real(0) {}
 };
 
+/** Read document lengths from a termlist table in ascending docid order.
+ *
+ *  This allows document lengths to be cross-checked against the postlist
+ *  table without having to hold them all in memory.
+ */
+class TermlistDoclens {
+    /// Don't allow assignment.
+    void operator=(const TermlistDoclens &);
+
+    /// Don't allow copying.
+    TermlistDoclens(const TermlistDoclens &);
+
+    BrassTable table;
+
+    AutoPtr<BrassCursor> cursor;
+
+  public:
+    explicit TermlistDoclens(const string & path)
+	: table("termlist", path, true)
+    {
+	table.open();
+	cursor.reset(table.cursor_get());
+	cursor->find_entry(string());
+	cursor->next(); // Skip the empty entry.
+    }
+
+    /** Get the length of document @a did from its termlist.
+     *
+     *  Documents without a termlist are returned as having length 0.  Each
+     *  call must pass a greater @a did than the previous call.
+     */
+    Xapian::termcount get_doclen(Xapian::docid did) {
+	for ( ; !cursor->after_end(); cursor->next()) {
+	    const string & key = cursor->current_key;
+	    const char * pos = key.data();
+	    const char * end = pos + key.size();
+	    Xapian::docid tl_did;
+	    // Skip value slots used entries, and any corrupt keys (which are
+	    // reported when the termlist table is checked).
+	    if (!unpack_uint_preserving_sort(&pos, end, &tl_did) || pos != end)
+		continue;
+	    if (tl_did > did) break;
+	    if (tl_did < did) continue;
+
+	    cursor->read_tag();
+	    pos = cursor->current_tag.data();
+	    end = pos + cursor->current_tag.size();
+	    Xapian::termcount doclen = 0;
+	    if (pos != end) (void)unpack_uint(&pos, end, &doclen);
+	    cursor->next();
+	    return doclen;
+	}
+	return 0;
+    }
+};
+
 size_t
 check_brass_table(const char * tablename, string filename, int opts,
-		  vector<Xapian::termcount> & doclens,
+		  vector<Xapian::termcount> & doclens, bool stream_doclens,
 		  Xapian::docid db_last_docid, ostream & out)
 {
     filename += '.';
@@ -84,6 +141,15 @@ check_brass_table(const char * tablename, string filename, int opts,
 	Xapian::termcount tf = 0, cf = 0;
 	bool have_metainfo_key = false;
 
+	AutoPtr<TermlistDoclens> termlist_doclens;
+	if (stream_doclens) {
+	    // Replace "postlist." with "termlist.".
+	    string termlist_path(filename, 0, filename.size() - 9);
+	    termlist_path += "termlist.";
+	    if (file_exists(termlist_path + "DB"))
+		termlist_doclens.reset(new TermlistDoclens(termlist_path));
+	}
+
 	// The first key/tag pair should be the METAINFO - though this may be
 	// missing if the table only contains user-metadata.
 	if (!cursor->after_end()) {
@@ -211,12 +277,15 @@ check_brass_table(const char * tablename, string filename, int opts,
 			++errors;
 		    }
 
-		    if (!doclens.empty()) {
+		    if (termlist_doclens.get() || !doclens.empty()) {
 			// In brass, a document without terms doesn't get a
 			// termlist entry.
 			Xapian::termcount termlist_doclen = 0;
-			if (did < doclens.size())
+			if (termlist_doclens.get()) {
+			    termlist_doclen = termlist_doclens->get_doclen(did);
+			} else if (did < doclens.size()) {
 			    termlist_doclen = doclens[did];
+			}
 
 			if (doclen != termlist_doclen) {
 			    out << "document id " << did << ": length "
@@ -717,9 +786,11 @@ check_brass_table(const char * tablename, string filename, int opts,
 		++errors;
 	    }
 
-	    // + 1 so that did is a valid subscript.
-	    if (doclens.size() <= did) doclens.resize(did + 1);
-	    doclens[did] = actual_doclen;
+	    if (!stream_doclens) {
+		// + 1 so that did is a valid subscript.
+		if (doclens.size() <= did) doclens.resize(did + 1);
+		doclens[did] = actual_doclen;
+	    }
 	}
     } else if (strcmp(tablename, "position") == 0) {
 	// Now check the contents of the position table.
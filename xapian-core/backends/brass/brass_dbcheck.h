@@ -29,8 +29,18 @@
 #include <string>
 #include <vector>
 
+/** Check a brass table.
+ *
+ *  @param doclens	Document lengths, filled in when checking the termlist
+ *			table and used to cross-check the postlist table.
+ *			Not used if @a stream_doclens is true.
+ *  @param stream_doclens	If true, cross-check document lengths in the
+ *			postlist table by reading the termlist table alongside
+ *			it, which needs a bounded amount of memory.
+ */
 size_t check_brass_table(const char * tablename, std::string table, int opts,
 			 std::vector<Xapian::termcount> & doclens,
+			 bool stream_doclens,
 			 Xapian::docid db_last_docid, std::ostream & out);
 
 #endif // XAPIAN_INCLUDED_BRASS_DBCHECK_H
@@ -55,5 +55,6 @@ string
 BrassDocument::do_get_data() const
 {
     LOGCALL(DB, string, "BrassDocument::do_get_data", NO_ARGS);
+    if (data_prefetched) RETURN(prefetched_data);
     RETURN(record_table->get_record(did));
 }
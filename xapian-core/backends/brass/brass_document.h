@@ -40,6 +40,12 @@ class BrassDocument : public Xapian::Document::Internal {
     /// Used for lazy access to document data.
     const BrassRecordTable *record_table;
 
+    /// True if the document data was read in advance.
+    bool data_prefetched;
+
+    /// The document data, if data_prefetched is true.
+    string prefetched_data;
+
     /// BrassDatabase::open_document() needs to call our private constructor.
     friend class BrassDatabase;
 
@@ -49,7 +55,26 @@ class BrassDocument : public Xapian::Document::Internal {
 		  const BrassValueManager *value_manager_,
 		  const BrassRecordTable *record_table_)
 	: Xapian::Document::Internal(db, did_),
-	  value_manager(value_manager_), record_table(record_table_) { }
+	  value_manager(value_manager_), record_table(record_table_),
+	  data_prefetched(false) { }
+
+    /** Private constructor - only called by BrassDatabase::collect_document().
+     *
+     *  @param data_	The document data, which was read in advance - passed
+     *			by non-const reference, and may be modified by the
+     *			call.
+     */
+    BrassDocument(Xapian::Internal::intrusive_ptr<const Xapian::Database::Internal> db,
+		  Xapian::docid did_,
+		  const BrassValueManager *value_manager_,
+		  const BrassRecordTable *record_table_,
+		  string & data_)
+	: Xapian::Document::Internal(db, did_),
+	  value_manager(value_manager_), record_table(record_table_),
+	  data_prefetched(true)
+    {
+	swap(prefetched_data, data_);
+    }
 
   public:
     /** Implementation of virtual methods @{ */
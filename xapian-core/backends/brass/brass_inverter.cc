@@ -33,6 +33,7 @@ void
 Inverter::flush_doclengths(BrassPostListTable & table)
 {
     table.merge_doclen_changes(doclen_changes);
+    mem_used -= doclen_changes.size() * DOCLEN_MEM;
     doclen_changes.clear();
 }
 
@@ -44,6 +45,8 @@ Inverter::flush_post_list(BrassPostListTable & table, const string & term)
     if (i == postlist_changes.end()) return;
 
     // Flush buffered changes for just this term's postlist.
+    release_mem(i->first, i->second);
+    i->second.sort_changes();
     table.merge_changes(term, i->second);
     postlist_changes.erase(i);
 }
@@ -51,11 +54,15 @@ Inverter::flush_post_list(BrassPostListTable & table, const string & term)
 void
 Inverter::flush_all_post_lists(BrassPostListTable & table)
 {
-    map<string, PostingChanges>::const_iterator i;
+    map<string, PostingChanges>::iterator i;
     for (i = postlist_changes.begin(); i != postlist_changes.end(); ++i) {
+	i->second.sort_changes();
 	table.merge_changes(i->first, i->second);
     }
     postlist_changes.clear();
+    // The doclen changes are flushed separately, so just subtract what
+    // they're using.
+    mem_used = doclen_changes.size() * DOCLEN_MEM;
 }
 
 void
@@ -69,6 +76,8 @@ Inverter::flush_post_lists(BrassPostListTable & table, const string & pfx)
     end = postlist_changes.upper_bound(pfx);
 
     for (i = begin; i != end; ++i) {
+	release_mem(i->first, i->second);
+	i->second.sort_changes();
 	table.merge_changes(i->first, i->second);
     }
 
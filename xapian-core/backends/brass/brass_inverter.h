@@ -23,8 +23,11 @@
 
 #include "xapian/types.h"
 
+#include <algorithm>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "omassert.h"
 #include "str.h"
@@ -43,36 +46,73 @@ class Inverter {
     class PostingChanges {
 	friend class BrassPostListTable;
 
+	/// Type used to store the changes to a postlist.
+	typedef std::vector<std::pair<Xapian::docid, Xapian::termcount> >
+		pl_changes_type;
+
 	/// Change in term frequency,
 	Xapian::termcount_diff tf_delta;
 
 	/// Change in collection frequency.
 	Xapian::termcount_diff cf_delta;
 
-	/// Changes to this term's postlist.
-	std::map<Xapian::docid, Xapian::termcount> pl_changes;
+	/** Changes to this term's postlist.
+	 *
+	 *  We use a vector rather than a std::map as it needs much less memory
+	 *  per entry.  Documents are usually added in docid order, so changes
+	 *  are just appended, and if any arrive out of order the vector is
+	 *  sorted by sort_changes() before being merged into the table.  Until
+	 *  then, there may be several changes for the same document, in which
+	 *  case the last one is the one which counts.
+	 */
+	pl_changes_type pl_changes;
+
+	/// True if pl_changes may not be in ascending docid order.
+	bool unsorted;
+
+	/// Set the change for document @a did to @a wdf.
+	void set_change(Xapian::docid did, Xapian::termcount wdf) {
+	    if (rare(!pl_changes.empty() && did <= pl_changes.back().first)) {
+		if (did == pl_changes.back().first) {
+		    pl_changes.back().second = wdf;
+		    return;
+		}
+		unsorted = true;
+	    }
+	    pl_changes.push_back(std::make_pair(did, wdf));
+	}
+
+	/// Compare the docids of two changes.
+	static bool
+	docid_less(const std::pair<Xapian::docid, Xapian::termcount> & a,
+		   const std::pair<Xapian::docid, Xapian::termcount> & b) {
+	    return a.first < b.first;
+	}
 
       public:
 	/// Constructor for an added posting.
 	PostingChanges(Xapian::docid did, Xapian::termcount wdf)
-	    : tf_delta(1), cf_delta(Xapian::termcount_diff(wdf))
+	    : tf_delta(1), cf_delta(Xapian::termcount_diff(wdf)),
+	      unsorted(false)
 	{
-	    pl_changes.insert(std::make_pair(did, wdf));
+	    pl_changes.push_back(std::make_pair(did, wdf));
 	}
 
 	/// Constructor for a removed posting.
 	PostingChanges(Xapian::docid did, Xapian::termcount wdf, bool)
-	    : tf_delta(-1), cf_delta(-Xapian::termcount_diff(wdf))
+	    : tf_delta(-1), cf_delta(-Xapian::termcount_diff(wdf)),
+	      unsorted(false)
 	{
-	    pl_changes.insert(std::make_pair(did, DELETED_POSTING));
+	    pl_changes.push_back(std::make_pair(did, DELETED_POSTING));
 	}
 
 	/// Constructor for an updated posting.
 	PostingChanges(Xapian::docid did, Xapian::termcount old_wdf,
 		       Xapian::termcount new_wdf)
-	    : tf_delta(0), cf_delta(Xapian::termcount_diff(new_wdf - old_wdf))
+	    : tf_delta(0), cf_delta(Xapian::termcount_diff(new_wdf - old_wdf)),
+	      unsorted(false)
 	{
-	    pl_changes.insert(std::make_pair(did, new_wdf));
+	    pl_changes.push_back(std::make_pair(did, new_wdf));
 	}
 
 	/// Add a posting.
@@ -80,7 +120,7 @@ class Inverter {
 	    ++tf_delta;
 	    cf_delta += wdf;
 	    // Add did to term's postlist
-	    pl_changes[did] = wdf;
+	    set_change(did, wdf);
 	}
 
 	/// Remove a posting.
@@ -88,16 +128,43 @@ class Inverter {
 	    --tf_delta;
 	    cf_delta -= wdf;
 	    // Remove did from term's postlist.
-	    pl_changes[did] = DELETED_POSTING;
+	    set_change(did, DELETED_POSTING);
 	}
 
 	/// Update a posting.
 	void update_posting(Xapian::docid did, Xapian::termcount old_wdf,
 			    Xapian::termcount new_wdf) {
 	    cf_delta += new_wdf - old_wdf;
-	    pl_changes[did] = new_wdf;
+	    set_change(did, new_wdf);
+	}
+
+	/** Put the changes in ascending docid order.
+	 *
+	 *  Where there are several changes for a document, only the last is
+	 *  kept.  This must be called before the changes are merged into the
+	 *  table.
+	 */
+	void sort_changes() {
+	    if (usual(!unsorted)) return;
+	    // A stable sort keeps changes for the same document in the order
+	    // they were made.
+	    std::stable_sort(pl_changes.begin(), pl_changes.end(), docid_less);
+	    pl_changes_type::iterator i = pl_changes.begin();
+	    pl_changes_type::iterator out = i;
+	    while (i != pl_changes.end()) {
+		pl_changes_type::iterator next = i + 1;
+		if (next == pl_changes.end() || next->first != i->first) {
+		    *out++ = *i;
+		}
+		i = next;
+	    }
+	    pl_changes.erase(out, pl_changes.end());
+	    unsorted = false;
 	}
 
+	/// Return the number of entries in the changes to this postlist.
+	size_t size() const { return pl_changes.size(); }
+
 	/// Get the term frequency delta.
 	Xapian::termcount_diff get_tfdelta() const { return tf_delta; }
 
@@ -108,11 +175,43 @@ class Inverter {
     /// Buffered changes to postlists.
     std::map<std::string, PostingChanges> postlist_changes;
 
+    /** Approximate number of bytes of memory used by the buffered changes.
+     *
+     *  This is an estimate based on the number of entries, which is enough
+     *  to decide when to flush - we don't try to account exactly for
+     *  allocator overheads.
+     */
+    size_t mem_used;
+
+    /// Estimated memory used by each entry in a std::map.
+    static const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+
+    /// Estimated memory used by a term's entry in postlist_changes.
+    static size_t term_mem(const std::string & term) {
+	return MAP_NODE_OVERHEAD + sizeof(std::string) +
+	       sizeof(PostingChanges) + term.size();
+    }
+
+    /// Estimated memory used by each entry in a term's postlist changes.
+    static const size_t POSTING_MEM =
+	sizeof(std::pair<Xapian::docid, Xapian::termcount>);
+
+    /// Estimated memory used by each entry in doclen_changes.
+    static const size_t DOCLEN_MEM =
+	MAP_NODE_OVERHEAD + sizeof(std::pair<Xapian::docid, Xapian::termcount>);
+
+    /// Account for the memory used by @a term's changes being released.
+    void release_mem(const std::string & term, const PostingChanges & changes) {
+	mem_used -= term_mem(term) + changes.size() * POSTING_MEM;
+    }
+
   public:
     /// Buffered changes to document lengths.
     std::map<Xapian::docid, Xapian::termcount> doclen_changes;
 
   public:
+    Inverter() : mem_used(0) { }
+
     void add_posting(Xapian::docid did, const std::string & term,
 		     Xapian::doccount wdf) {
 	std::map<std::string, PostingChanges>::iterator i;
@@ -120,8 +219,11 @@ class Inverter {
 	if (i == postlist_changes.end()) {
 	    postlist_changes.insert(
 		std::make_pair(term, PostingChanges(did, wdf)));
+	    mem_used += term_mem(term) + POSTING_MEM;
 	} else {
+	    size_t old_size = i->second.size();
 	    i->second.add_posting(did, wdf);
+	    mem_used += (i->second.size() - old_size) * POSTING_MEM;
 	}
     }
 
@@ -132,8 +234,11 @@ class Inverter {
 	if (i == postlist_changes.end()) {
 	    postlist_changes.insert(
 		std::make_pair(term, PostingChanges(did, wdf, false)));
+	    mem_used += term_mem(term) + POSTING_MEM;
 	} else {
+	    size_t old_size = i->second.size();
 	    i->second.remove_posting(did, wdf);
+	    mem_used += (i->second.size() - old_size) * POSTING_MEM;
 	}
     }
 
@@ -145,26 +250,45 @@ class Inverter {
 	if (i == postlist_changes.end()) {
 	    postlist_changes.insert(
 		std::make_pair(term, PostingChanges(did, old_wdf, new_wdf)));
+	    mem_used += term_mem(term) + POSTING_MEM;
 	} else {
+	    size_t old_size = i->second.size();
 	    i->second.update_posting(did, old_wdf, new_wdf);
+	    mem_used += (i->second.size() - old_size) * POSTING_MEM;
 	}
     }
 
     void clear() {
 	doclen_changes.clear();
 	postlist_changes.clear();
+	mem_used = 0;
     }
 
+    /// Return the approximate number of bytes used by buffered changes.
+    size_t get_memory_used() const { return mem_used; }
+
     void set_doclength(Xapian::docid did, Xapian::termcount doclen, bool add) {
 	if (add) {
 	    Assert(doclen_changes.find(did) == doclen_changes.end() || doclen_changes[did] == DELETED_POSTING);
 	}
-	doclen_changes[did] = doclen;
+	std::pair<std::map<Xapian::docid, Xapian::termcount>::iterator, bool> r;
+	r = doclen_changes.insert(std::make_pair(did, doclen));
+	if (r.second) {
+	    mem_used += DOCLEN_MEM;
+	} else {
+	    r.first->second = doclen;
+	}
     }
 
     void delete_doclength(Xapian::docid did) {
 	Assert(doclen_changes.find(did) == doclen_changes.end() || doclen_changes[did] != DELETED_POSTING);
-	doclen_changes[did] = DELETED_POSTING;
+	std::pair<std::map<Xapian::docid, Xapian::termcount>::iterator, bool> r;
+	r = doclen_changes.insert(std::make_pair(did, DELETED_POSTING));
+	if (r.second) {
+	    mem_used += DOCLEN_MEM;
+	} else {
+	    r.first->second = DELETED_POSTING;
+	}
     }
 
     bool get_doclength(Xapian::docid did, Xapian::termcount & doclen) const  {
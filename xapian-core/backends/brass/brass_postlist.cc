@@ -33,29 +33,42 @@
 
 using Xapian::Internal::intrusive_ptr;
 
+void
+BrassPostListTable::get_freqs(const string & term,
+			      Xapian::doccount * termfreq_ptr,
+			      Xapian::termcount * collfreq_ptr) const
+{
+    Xapian::doccount termfreq;
+    Xapian::termcount collfreq;
+    if (!freq_cache.find(term, termfreq, collfreq)) {
+	string tag;
+	if (get_exact_entry(make_key(term), tag)) {
+	    const char * p = tag.data();
+	    BrassPostList::read_number_of_entries(&p, p + tag.size(),
+						  &termfreq, &collfreq);
+	} else {
+	    termfreq = 0;
+	    collfreq = 0;
+	}
+	freq_cache.add(term, termfreq, collfreq);
+    }
+    if (termfreq_ptr) *termfreq_ptr = termfreq;
+    if (collfreq_ptr) *collfreq_ptr = collfreq;
+}
+
 Xapian::doccount
 BrassPostListTable::get_termfreq(const string & term) const
 {
-    string key = make_key(term);
-    string tag;
-    if (!get_exact_entry(key, tag)) return 0;
-
     Xapian::doccount termfreq;
-    const char * p = tag.data();
-    BrassPostList::read_number_of_entries(&p, p + tag.size(), &termfreq, NULL);
+    get_freqs(term, &termfreq, NULL);
     return termfreq;
 }
 
 Xapian::termcount
 BrassPostListTable::get_collection_freq(const string & term) const
 {
-    string key = make_key(term);
-    string tag;
-    if (!get_exact_entry(key, tag)) return 0;
-
     Xapian::termcount collfreq;
-    const char * p = tag.data();
-    BrassPostList::read_number_of_entries(&p, p + tag.size(), NULL, &collfreq);
+    get_freqs(term, NULL, &collfreq);
     return collfreq;
 }
 
@@ -1069,6 +1082,8 @@ BrassPostListTable::merge_doclen_changes(const map<Xapian::docid, Xapian::termco
 
     // The cursor in the doclen_pl will no longer be valid, so reset it.
     doclen_pl.reset(0);
+    // The cached stats for the doclen postlist will be stale too.
+    freq_cache.erase(string());
 
     LOGVALUE(DB, doclens.size());
     if (doclens.empty()) return;
@@ -1134,6 +1149,9 @@ void
 BrassPostListTable::merge_changes(const string &term,
 				  const Inverter::PostingChanges & changes)
 {
+    // The cached stats for this term will be stale after this.
+    freq_cache.erase(term);
+
     {
 	// Rewrite the first chunk of this posting list with the updated
 	// termfreq and collfreq.
@@ -1194,7 +1212,7 @@ BrassPostListTable::merge_changes(const string &term,
 	    add(current_key, tag);
 	}
     }
-    map<Xapian::docid, Xapian::termcount>::const_iterator j;
+    Inverter::PostingChanges::pl_changes_type::const_iterator j;
     j = changes.pl_changes.begin();
     Assert(j != changes.pl_changes.end()); // This case is caught above.
 
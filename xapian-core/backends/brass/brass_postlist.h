@@ -31,6 +31,7 @@
 #include "brass_types.h"
 #include "brass_positionlist.h"
 #include "api/leafpostlist.h"
+#include "backends/termstatscache.h"
 #include "omassert.h"
 
 #include "autoptr.h"
@@ -53,6 +54,21 @@ class BrassPostListTable : public BrassTable {
 	/// PostList for looking up document lengths.
 	mutable AutoPtr<BrassPostList> doclen_pl;
 
+	/** Cache of the termfreq and collection freq of recently used terms.
+	 *
+	 *  This is cleared whenever we open a revision or change the table.
+	 */
+	mutable TermStatsCache freq_cache;
+
+	/** Read the termfreq and collection freq of @a term.
+	 *
+	 *  Both are stored in the header of the first chunk of the postlist,
+	 *  so we fetch them together and cache them.
+	 */
+	void get_freqs(const std::string & term,
+		       Xapian::doccount * termfreq_ptr,
+		       Xapian::termcount * collfreq_ptr) const;
+
     public:
 	/** Create a new table object.
 	 *
@@ -73,9 +89,15 @@ class BrassPostListTable : public BrassTable {
 
 	bool open(brass_revision_number_t revno) {
 	    doclen_pl.reset(0);
+	    freq_cache.clear();
 	    return BrassTable::open(revno);
 	}
 
+	void cancel() {
+	    freq_cache.clear();
+	    BrassTable::cancel();
+	}
+
 	/// Merge changes for a term.
 	void merge_changes(const string &term, const Inverter::PostingChanges & changes);
 
@@ -52,6 +52,20 @@ BrassRecordTable::get_record(Xapian::docid did) const
     RETURN(tag);
 }
 
+void
+BrassRecordTable::get_records(const vector<Xapian::docid> & dids,
+			      map<Xapian::docid, string> & records) const
+{
+    LOGCALL_VOID(DB, "BrassRecordTable::get_records", dids | records);
+    vector<Xapian::docid>::const_iterator i;
+    for (i = dids.begin(); i != dids.end(); ++i) {
+	AssertRel(*i, >, 0);
+	string tag;
+	if (get_exact_entry(make_key(*i), tag))
+	    swap(records[*i], tag);
+    }
+}
+
 Xapian::doccount
 BrassRecordTable::get_doccount() const
 {   
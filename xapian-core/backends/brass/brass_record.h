@@ -24,7 +24,9 @@
 #ifndef OM_HGUARD_BRASS_RECORD_H
 #define OM_HGUARD_BRASS_RECORD_H
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include <xapian/types.h>
 #include "brass_types.h"
@@ -55,6 +57,19 @@ class BrassRecordTable : public BrassTable {
 	 */
 	string get_record(Xapian::docid did) const;
 
+	/** Retrieve several documents from the table.
+	 *
+	 *  Reading them in ascending docid order means we make a single pass
+	 *  through the table, rather than a separate lookup from the root for
+	 *  each document.
+	 *
+	 *  @param dids	    The document IDs to read, in ascending order.
+	 *  @param records  The data for each of @a dids which exists is
+	 *		    stored in this map.
+	 */
+	void get_records(const vector<Xapian::docid> & dids,
+			 map<Xapian::docid, string> & records) const;
+
 	/** Get the number of records in the table.
 	 */
 	Xapian::doccount get_doccount() const;
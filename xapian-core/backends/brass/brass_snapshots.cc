@@ -0,0 +1,200 @@
+/** @file brass_snapshots.cc
+ * @brief Share revision information between brass databases in a process.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "brass_snapshots.h"
+
+#include <map>
+
+#ifndef __WIN32__
+# include "safesysstat.h"
+#endif
+
+#include "mutex.h"
+#include "str.h"
+
+using namespace std;
+
+namespace {
+
+/// What we know about a database which is open in this process.
+struct SharedState {
+    /// The revisions pinned by readers (with a count for each).
+    map<brass_revision_number_t, unsigned> pinned;
+
+    /// Is a writer publishing revisions?
+    bool published;
+
+    /// The latest revision published by the writer.
+    brass_revision_number_t revision;
+
+    SharedState() : published(false), revision(0) { }
+
+    bool empty() const { return pinned.empty() && !published; }
+};
+
+typedef map<string, SharedState> shared_state_map;
+
+/* The mutex and the shared state are allocated on first use and deliberately
+ * never destroyed, so a database object with static storage duration can
+ * still safely use them from its destructor during static destruction.
+ */
+
+/// Return the mutex which protects the state returned by get_shared_states().
+Mutex &
+get_mutex()
+{
+    static Mutex * mutex = new Mutex;
+    return *mutex;
+}
+
+/** Return the state for each database, keyed by BrassSnapshots::get_key().
+ *
+ *  The caller must hold the mutex returned by get_mutex().
+ */
+shared_state_map &
+get_shared_states()
+{
+    static shared_state_map * shared_states = new shared_state_map;
+    return *shared_states;
+}
+
+/// Create the mutex before main() is called, and so before any threads are.
+struct MutexInitialiser {
+    MutexInitialiser() { (void)get_mutex(); }
+} mutex_initialiser;
+
+}
+
+BrassSnapshots::~BrassSnapshots()
+{
+    unpin();
+    withdraw();
+}
+
+const string &
+BrassSnapshots::get_key() const
+{
+    if (key.empty()) {
+#ifdef __WIN32__
+	// No inode numbers, so just use the path as given.
+	key = db_dir;
+#else
+	// Use the device and inode so different paths to the same directory
+	// share state.
+	struct stat statbuf;
+	if (stat(db_dir.c_str(), &statbuf) == 0) {
+	    key = str(statbuf.st_dev);
+	    key += ':';
+	    key += str(statbuf.st_ino);
+	}
+#endif
+    }
+    return key;
+}
+
+void
+BrassSnapshots::pin(brass_revision_number_t revision)
+{
+    if (pinning && pinned_revision == revision) return;
+    const string & k = get_key();
+    if (k.empty()) return;
+    MutexLock lock(get_mutex());
+    shared_state_map & states = get_shared_states();
+    SharedState & state = states[k];
+    if (pinning) {
+	map<brass_revision_number_t, unsigned>::iterator i;
+	i = state.pinned.find(pinned_revision);
+	if (--i->second == 0) state.pinned.erase(i);
+    }
+    ++state.pinned[revision];
+    pinning = true;
+    pinned_revision = revision;
+}
+
+void
+BrassSnapshots::unpin()
+{
+    if (!pinning) return;
+    pinning = false;
+    MutexLock lock(get_mutex());
+    shared_state_map & states = get_shared_states();
+    shared_state_map::iterator s = states.find(key);
+    map<brass_revision_number_t, unsigned>::iterator i;
+    i = s->second.pinned.find(pinned_revision);
+    if (--i->second == 0) s->second.pinned.erase(i);
+    if (s->second.empty()) states.erase(s);
+}
+
+void
+BrassSnapshots::get_pinned(vector<brass_revision_number_t> & revisions) const
+{
+    revisions.clear();
+    const string & k = get_key();
+    if (k.empty()) return;
+    MutexLock lock(get_mutex());
+    shared_state_map & states = get_shared_states();
+    shared_state_map::const_iterator s = states.find(k);
+    if (s == states.end()) return;
+    map<brass_revision_number_t, unsigned>::const_iterator i;
+    for (i = s->second.pinned.begin(); i != s->second.pinned.end(); ++i) {
+	revisions.push_back(i->first);
+    }
+}
+
+void
+BrassSnapshots::publish(brass_revision_number_t revision)
+{
+    const string & k = get_key();
+    if (k.empty()) return;
+    MutexLock lock(get_mutex());
+    shared_state_map & states = get_shared_states();
+    SharedState & state = states[k];
+    state.published = true;
+    state.revision = revision;
+    publishing = true;
+}
+
+void
+BrassSnapshots::withdraw()
+{
+    if (!publishing) return;
+    publishing = false;
+    MutexLock lock(get_mutex());
+    shared_state_map & states = get_shared_states();
+    shared_state_map::iterator s = states.find(key);
+    s->second.published = false;
+    if (s->second.empty()) states.erase(s);
+}
+
+bool
+BrassSnapshots::get_published(brass_revision_number_t & revision) const
+{
+    const string & k = get_key();
+    if (k.empty()) return false;
+    MutexLock lock(get_mutex());
+    shared_state_map & states = get_shared_states();
+    shared_state_map::const_iterator s = states.find(k);
+    if (s == states.end() || !s->second.published) return false;
+    revision = s->second.revision;
+    return true;
+}
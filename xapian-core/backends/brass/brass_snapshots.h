@@ -0,0 +1,113 @@
+/** @file brass_snapshots.h
+ * @brief Share revision information between brass databases in a process.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BRASS_SNAPSHOTS_H
+#define XAPIAN_INCLUDED_BRASS_SNAPSHOTS_H
+
+#include <string>
+#include <vector>
+
+#include "brass_types.h"
+
+/** Share revision information between brass databases in a process.
+ *
+ *  A writer in the same process as readers of a database publishes each
+ *  revision it commits here, so a reader's reopen() can tell there's nothing
+ *  new without reading the base files from disk.
+ *
+ *  Each reader pins the revision it has open, and the writer avoids reusing
+ *  blocks which pinned revisions may still be using, so a reader in the same
+ *  process as the writer doesn't get DatabaseModifiedError however many
+ *  revisions it falls behind.  This can only protect revisions the writer
+ *  has committed itself, and readers in other processes get no protection.
+ *
+ *  The shared state is protected by a mutex, so different database objects
+ *  may still be used concurrently from different threads.
+ */
+class BrassSnapshots {
+    /// Don't allow assignment.
+    void operator=(const BrassSnapshots &);
+
+    /// Don't allow copying.
+    BrassSnapshots(const BrassSnapshots &);
+
+    /// The database directory.
+    std::string db_dir;
+
+    /// Key identifying the database, or empty if not yet determined.
+    mutable std::string key;
+
+    /// Are we currently pinning a revision?
+    bool pinning;
+
+    /// The revision we're pinning, if pinning is true.
+    brass_revision_number_t pinned_revision;
+
+    /// Are we currently publishing revisions?
+    bool publishing;
+
+    /// Return the key for db_dir, or an empty string if we can't get one.
+    const std::string & get_key() const;
+
+  public:
+    explicit BrassSnapshots(const std::string & db_dir_)
+	: db_dir(db_dir_), pinning(false), pinned_revision(0),
+	  publishing(false) { }
+
+    /// Releases any pin and stops publishing.
+    ~BrassSnapshots();
+
+    /** Pin revision @a revision, releasing any revision previously pinned.
+     *
+     *  Pinning revision 0 means "a revision not yet known", and protects
+     *  every revision committed until a real revision is pinned - a reader
+     *  should do this before it starts opening the tables.
+     */
+    void pin(brass_revision_number_t revision);
+
+    /// Release any pinned revision.
+    void unpin();
+
+    /// Is a revision currently pinned?
+    bool is_pinned() const { return pinning; }
+
+    /** Get the revisions pinned by readers in this process.
+     *
+     *  @param revisions	Set to the pinned revisions, in ascending order
+     *			and without duplicates.
+     */
+    void get_pinned(std::vector<brass_revision_number_t> & revisions) const;
+
+    /// Publish that @a revision is the latest committed revision.
+    void publish(brass_revision_number_t revision);
+
+    /// Stop publishing revisions.
+    void withdraw();
+
+    /** Get the latest revision published by a writer in this process.
+     *
+     *  @return true if a writer in this process is publishing revisions, in
+     *		which case @a revision has been set to the latest.
+     */
+    bool get_published(brass_revision_number_t & revision) const;
+};
+
+#endif // XAPIAN_INCLUDED_BRASS_SNAPSHOTS_H
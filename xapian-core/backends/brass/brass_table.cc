@@ -63,6 +63,7 @@ PWRITE_PROTOTYPE
 
 #include <cstdio>    /* for rename */
 #include <cstring>   /* for memmove */
+#include <cstdlib>   /* for getenv */
 #include <climits>   /* for CHAR_BIT */
 
 #include "brass_btreebase.h"
@@ -84,6 +85,58 @@ using namespace std;
 // Only try to compress tags longer than this many bytes.
 const size_t COMPRESS_MIN = 4;
 
+/** Parse a codec name from XAPIAN_BRASS_COMPRESSION.
+ *
+ *  @return The codec, or -1 if @a name isn't a known codec.
+ */
+static int
+parse_codec(const string & name)
+{
+    if (name == "zlib") return CODEC_ZLIB;
+    if (name == "lz4") return CODEC_LZ4;
+    if (name == "zstd") return CODEC_ZSTD;
+    return -1;
+}
+
+/** Pick the codec to use for a new table.
+ *
+ *  XAPIAN_BRASS_COMPRESSION is a comma separated list of entries, each of
+ *  which is either a codec name (zlib, lz4 or zstd) to use for all tables,
+ *  or TABLE=CODEC to use CODEC for just the table named TABLE (e.g.
+ *  "postlist=lz4").  Where several entries apply to a table, the last one
+ *  wins.
+ */
+static int
+default_codec(const char * tablename)
+{
+    const char * env = getenv("XAPIAN_BRASS_COMPRESSION");
+    if (!env || !*env) return CODEC_ZLIB;
+    int result = CODEC_ZLIB;
+    const char * p = env;
+    const char * end = p + strlen(p);
+    while (true) {
+	const char * comma = find(p, end, ',');
+	string entry(p, comma - p);
+	string::size_type eq = entry.find('=');
+	int codec;
+	if (eq == string::npos) {
+	    codec = parse_codec(entry);
+	} else {
+	    codec = parse_codec(entry.substr(eq + 1));
+	}
+	if (codec < 0) {
+	    string msg = "Bad value for XAPIAN_BRASS_COMPRESSION: ";
+	    msg += env;
+	    throw Xapian::InvalidArgumentError(msg);
+	}
+	if (eq == string::npos || entry.compare(0, eq, tablename) == 0)
+	    result = codec;
+	if (comma == end) break;
+	p = comma + 1;
+    }
+    return result;
+}
+
 //#define BTREE_DEBUG_FULL 1
 #undef BTREE_DEBUG_FULL
 
@@ -1030,28 +1083,8 @@ BrassTable::add(const string &key, string tag, bool already_compressed)
 	CompileTimeAssert(DONT_COMPRESS != Z_RLE);
 #endif
 
-	comp_stream.lazy_alloc_deflate_zstream();
-
-	comp_stream.deflate_zstream->next_in = (Bytef *)const_cast<char *>(tag.data());
-	comp_stream.deflate_zstream->avail_in = (uInt)tag.size();
-
-	// If compressed size is >= tag.size(), we don't want to compress.
-	unsigned long blk_len = tag.size() - 1;
-	unsigned char * blk = new unsigned char[blk_len];
-	comp_stream.deflate_zstream->next_out = blk;
-	comp_stream.deflate_zstream->avail_out = (uInt)blk_len;
-
-	int err = deflate(comp_stream.deflate_zstream, Z_FINISH);
-	if (err == Z_STREAM_END) {
-	    // If deflate succeeded, then the output was at least one byte
-	    // smaller than the input.
-	    tag.assign(reinterpret_cast<const char *>(blk), comp_stream.deflate_zstream->total_out);
-	    compressed = true;
-	} else {
-	    // Deflate failed - presumably the data wasn't compressible.
-	}
-
-	delete [] blk;
+	// This only compresses the tag if that makes it smaller.
+	compressed = comp_stream.compress_tag(tag);
     }
 
     // sort of matching kt.append_chunk(), but setting the chunk
@@ -1212,13 +1245,37 @@ BrassTable::read_tag(Brass::Cursor * C_, string *tag, bool keep_compressed) cons
     /* n components to join */
     int n = item.components_of();
 
+    bool compressed = item.get_compressed();
+    if (compressed && !keep_compressed &&
+	comp_stream.get_codec() == CODEC_ZLIB) {
+	// Decompress each chunk as we read it so we don't need both the full
+	// compressed and uncompressed tags in memory at once.
+	int len;
+	const char * chunk = item.get_chunk(len);
+	comp_stream.decompress_start(*tag, size_t(len) * n);
+	bool done = comp_stream.decompress_chunk(chunk, len, *tag);
+	for (int i = 2; i <= n; i++) {
+	    if (!next(C_, 0)) {
+		throw Xapian::DatabaseCorruptError("Unexpected end of table when reading continuation of tag");
+	    }
+	    if (rare(done)) {
+		throw Xapian::DatabaseCorruptError("Compressed tag ended before its last continuation");
+	    }
+	    chunk = Item(C_[0].p, C_[0].c).get_chunk(len);
+	    done = comp_stream.decompress_chunk(chunk, len, *tag);
+	}
+	if (!done) comp_stream.decompress_finish(*tag);
+	// At this point the cursor is on the last item - calling next will
+	// move it to the next key (BrassCursor::get_tag() relies on this).
+	RETURN(false);
+    }
+
     tag->resize(0);
     // max_item_size also includes K1 + I2 + C2 + C2 bytes overhead and the key
     // (which is at least 1 byte long).
     if (n > 1) tag->reserve((max_item_size - (1 + K1 + I2 + C2 + C2)) * n);
 
     item.append_chunk(tag);
-    bool compressed = item.get_compressed();
 
     for (int i = 2; i <= n; i++) {
 	if (!next(C_, 0)) {
@@ -1228,64 +1285,15 @@ BrassTable::read_tag(Brass::Cursor * C_, string *tag, bool keep_compressed) cons
     }
     // At this point the cursor is on the last item - calling next will move
     // it to the next key (BrassCursor::get_tag() relies on this).
-    if (!compressed || keep_compressed) RETURN(compressed);
-
-    // FIXME: Perhaps we should we decompress each chunk as we read it so we
-    // don't need both the full compressed and uncompressed tags in memory
-    // at once.
-
-    string utag;
-    // May not be enough for a compressed tag, but it's a reasonable guess.
-    utag.reserve(tag->size() + tag->size() / 2);
-
-    Bytef buf[8192];
-
-    comp_stream.lazy_alloc_inflate_zstream();
-
-    comp_stream.inflate_zstream->next_in = (Bytef*)const_cast<char *>(tag->data());
-    comp_stream.inflate_zstream->avail_in = (uInt)tag->size();
-
-    int err = Z_OK;
-    while (err != Z_STREAM_END) {
-	comp_stream.inflate_zstream->next_out = buf;
-	comp_stream.inflate_zstream->avail_out = (uInt)sizeof(buf);
-	err = inflate(comp_stream.inflate_zstream, Z_SYNC_FLUSH);
-	if (err == Z_BUF_ERROR && comp_stream.inflate_zstream->avail_in == 0) {
-	    LOGLINE(DB, "Z_BUF_ERROR - faking checksum of " << comp_stream.inflate_zstream->adler);
-	    Bytef header2[4];
-	    setint4(header2, 0, comp_stream.inflate_zstream->adler);
-	    comp_stream.inflate_zstream->next_in = header2;
-	    comp_stream.inflate_zstream->avail_in = 4;
-	    err = inflate(comp_stream.inflate_zstream, Z_SYNC_FLUSH);
-	    if (err == Z_STREAM_END) break;
-	}
-
-	if (err != Z_OK && err != Z_STREAM_END) {
-	    if (err == Z_MEM_ERROR) throw std::bad_alloc();
-	    string msg = "inflate failed";
-	    if (comp_stream.inflate_zstream->msg) {
-		msg += " (";
-		msg += comp_stream.inflate_zstream->msg;
-		msg += ')';
-	    }
-	    throw Xapian::DatabaseError(msg);
-	}
-
-	utag.append(reinterpret_cast<const char *>(buf),
-		    comp_stream.inflate_zstream->next_out - buf);
-    }
-    if (utag.size() != comp_stream.inflate_zstream->total_out) {
-	string msg = "compressed tag didn't expand to the expected size: ";
-	msg += str(utag.size());
-	msg += " != ";
-	// OpenBSD's zlib.h uses off_t instead of uLong for total_out.
-	msg += str((size_t)comp_stream.inflate_zstream->total_out);
-	throw Xapian::DatabaseCorruptError(msg);
+    if (compressed && !keep_compressed) {
+	// Codecs other than zlib need the whole compressed tag at once.
+	string compressed_tag;
+	tag->swap(compressed_tag);
+	comp_stream.decompress_tag(compressed_tag.data(), compressed_tag.size(),
+				   *tag);
+	RETURN(false);
     }
-
-    swap(*tag, utag);
-
-    RETURN(false);
+    RETURN(compressed);
 }
 
 void
@@ -1416,6 +1424,8 @@ BrassTable::basic_open(bool revision_supplied, brass_revision_number_t revision_
 	faked_root_block = base.get_have_fakeroot();
 	sequential =       base.get_sequential();
 
+	comp_stream.set_codec(base.get_codec());
+
 	if (other_base != 0) {
 	    latest_revision_number = other_base->get_revision();
 	    if (revision_number > latest_revision_number)
@@ -1560,6 +1570,10 @@ BrassTable::BrassTable(const char * tablename_, const string & path_,
 	  changed_c(0),
 	  max_item_size(0),
 	  Btree_modified(false),
+	  commit_pending(false),
+	  old_revision_number(0),
+	  old_latest_revision_number(0),
+	  old_both_bases(false),
 	  full_compaction(false),
 	  writable(!readonly_),
 	  cursor_created_since_last_modification(false),
@@ -1627,6 +1641,13 @@ BrassTable::create_and_open(unsigned int block_size_)
     base_.set_block_size(block_size_);
     base_.set_have_fakeroot(true);
     base_.set_sequential(true);
+    if (compress_strategy != DONT_COMPRESS) {
+	int codec = default_codec(tablename);
+	// Check support for the codec was compiled in before we create the
+	// table.
+	comp_stream.set_codec(codec);
+	base_.set_codec(codec);
+    }
     base_.write_to_file(name + "baseA", 'A', string(), -1, NULL);
 
     /* remove the alternative base file, if any */
@@ -1644,6 +1665,8 @@ BrassTable::~BrassTable() {
 void BrassTable::close(bool permanent) {
     LOGCALL_VOID(DB, "BrassTable::close", NO_ARGS);
 
+    commit_pending = false;
+
     if (handle >= 0) {
 	// If an error occurs here, we just ignore it, since we're just
 	// trying to free everything.
@@ -1694,11 +1717,12 @@ BrassTable::flush_db()
 }
 
 void
-BrassTable::commit(brass_revision_number_t revision, int changes_fd,
-		   const string * changes_tail)
+BrassTable::start_commit(brass_revision_number_t revision, int changes_fd,
+			 const string * changes_tail)
 {
-    LOGCALL_VOID(DB, "BrassTable::commit", revision | changes_fd | changes_tail);
+    LOGCALL_VOID(DB, "BrassTable::start_commit", revision | changes_fd | changes_tail);
     Assert(writable);
+    Assert(!commit_pending);
 
     if (revision <= revision_number) {
 	throw Xapian::DatabaseError("New revision too low");
@@ -1725,6 +1749,10 @@ BrassTable::commit(brass_revision_number_t revision, int changes_fd,
 	base.set_have_fakeroot(faked_root_block);
 	base.set_sequential(sequential);
 
+	old_revision_number = revision_number;
+	old_latest_revision_number = latest_revision_number;
+	old_both_bases = both_bases;
+
 	base_letter = other_base_letter();
 
 	both_bases = true;
@@ -1739,14 +1767,49 @@ BrassTable::commit(brass_revision_number_t revision, int changes_fd,
 	    C[i].rewrite = false;
 	}
 
-	// Save to "<table>.tmp" and then rename to "<table>.base<letter>" so
-	// that a reader can't try to read a partially written base file.
+	// Save to "<table>.tmp" and then rename to "<table>.base<letter>" in
+	// complete_commit() so that a reader can't try to read a partially
+	// written base file.
+	string tmp = name;
+	tmp += "tmp";
+	base.write_to_file(tmp, base_letter, tablename, changes_fd, changes_tail,
+			   false);
+
+	// Get the kernel started on writing out the blocks, but don't wait for
+	// it to finish - complete_commit() does that.
+	io_start_sync(handle);
+	commit_pending = true;
+    } catch (...) {
+	BrassTable::close();
+	throw;
+    }
+}
+
+void
+BrassTable::complete_commit()
+{
+    LOGCALL_VOID(DB, "BrassTable::complete_commit", NO_ARGS);
+    if (!commit_pending) return;
+    commit_pending = false;
+
+    try {
 	string tmp = name;
 	tmp += "tmp";
 	string basefile = name;
 	basefile += "base";
 	basefile += char(base_letter);
-	base.write_to_file(tmp, base_letter, tablename, changes_fd, changes_tail);
+
+	// Wait for the new base file to reach the disk.  It was closed by
+	// write_to_file(), but syncing an fd opened on the same file is enough.
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_BINARY | O_CLOEXEC);
+	if (fd < 0 || !io_sync(fd)) {
+	    if (fd >= 0) (void)::close(fd);
+	    (void)unlink(tmp.c_str());
+	    string msg("Couldn't sync base file ");
+	    msg += tmp;
+	    throw Xapian::DatabaseError(msg, errno);
+	}
+	(void)::close(fd);
 
 	// Do this as late as possible to allow maximum time for writes to
 	// happen, and so the calls to io_sync() are adjacent which may be
@@ -1786,6 +1849,23 @@ BrassTable::commit(brass_revision_number_t revision, int changes_fd,
     }
 }
 
+void
+BrassTable::abort_commit()
+{
+    LOGCALL_VOID(DB, "BrassTable::abort_commit", NO_ARGS);
+    if (!commit_pending) return;
+    commit_pending = false;
+
+    string tmp = name;
+    tmp += "tmp";
+    (void)unlink(tmp.c_str());
+
+    base_letter = other_base_letter();
+    both_bases = old_both_bases;
+    revision_number = old_revision_number;
+    latest_revision_number = old_latest_revision_number;
+}
+
 void
 BrassTable::write_changed_blocks(int changes_fd, bool compressed)
 {
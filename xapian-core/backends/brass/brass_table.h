@@ -166,6 +166,15 @@ public:
 	int l = size() - cd;
 	tag->append(reinterpret_cast<const char *>(p + cd), l);
     }
+    /** Get a pointer to this item's chunk of the tag.
+     *
+     *  @param[out] len	Set to the length of the chunk.
+     */
+    const char * get_chunk(int & len) const {
+	int cd = getK(p, I2) + I2 + C2;
+	len = size() - cd;
+	return reinterpret_cast<const char *>(p + cd);
+    }
     /** Get this item's tag as a block number (this block should not be at
      *  level 0).
      */
@@ -325,7 +334,7 @@ class BrassTable {
 	 *  Any outstanding changes (ie, changes made without commit() having
 	 *  subsequently been called) will be lost.
 	 */
-	~BrassTable();
+	virtual ~BrassTable();
 
 	/** Close the Btree.  This closes and frees any of the btree
 	 *  structures which have been created and opened.
@@ -397,7 +406,54 @@ class BrassTable {
 	 *	    Defaults to -1, meaning no changes will be written.
 	 */
 	void commit(brass_revision_number_t revision, int changes_fd = -1,
-		    const std::string * changes_tail = NULL);
+		    const std::string * changes_tail = NULL) {
+	    start_commit(revision, changes_fd, changes_tail);
+	    complete_commit();
+	}
+
+	/** Start committing a new revision of the table.
+	 *
+	 *  This does the first half of commit(), writing the new base file
+	 *  and starting to write the table's data to disk, but doesn't wait
+	 *  for the writes to finish.  It must be followed by a call to
+	 *  complete_commit() before any further changes are made.
+	 *
+	 *  Splitting commit() in two allows the writes for all the tables in
+	 *  a database to be started before we wait for any of them, so they
+	 *  can proceed in parallel.
+	 *
+	 *  The parameters are as for commit().
+	 */
+	void start_commit(brass_revision_number_t revision, int changes_fd = -1,
+			  const std::string * changes_tail = NULL);
+
+	/** Finish committing a new revision of the table.
+	 *
+	 *  Waits for the data and new base file written by start_commit() to
+	 *  reach the disk, and then makes the new base file live.
+	 */
+	void complete_commit();
+
+	/** Abandon a commit started by start_commit().
+	 *
+	 *  Removes the new base file written by start_commit() and restores
+	 *  the table's revision and base file letter, so that cancel() will
+	 *  reread the base for the revision which is still live on disk.
+	 *
+	 *  Used when a commit of the database fails after some of its tables
+	 *  have started committing.  Does nothing if there's no commit
+	 *  pending.
+	 */
+	void abort_commit();
+
+	/// Don't reuse blocks readers may be using (see BrassTable_base).
+	void pin_blocks(brass_revision_number_t old_revision,
+			const std::vector<brass_revision_number_t> & pinned) {
+	    base.pin_blocks(old_revision, pinned);
+	}
+
+	/// Allow blocks pinned by pin_blocks() to be reused.
+	void unpin_blocks() { base.unpin_blocks(); }
 
 	/** Append the list of blocks changed to a changeset file.
 	 *
@@ -408,9 +464,10 @@ class BrassTable {
 	/** Cancel any outstanding changes.
 	 *
 	 *  This will discard any modifications which haven't been committed
-	 *  by calling commit().
+	 *  by calling commit().  Subclasses which buffer changes or cache
+	 *  data read from the table override this to discard them too.
 	 */
-	void cancel();
+	virtual void cancel();
 
 	/** Read an entry from the table, if and only if it is exactly that
 	 *  being asked for.
@@ -451,6 +508,13 @@ class BrassTable {
 	 */
 	bool read_tag(Brass::Cursor * C_, std::string *tag, bool keep_compressed) const;
 
+	/** Return the codec used to compress tags in this table.
+	 *
+	 *  Tags read with keep_compressed set can only be passed to add()
+	 *  with already_compressed set for a table using the same codec.
+	 */
+	int get_codec() const { return comp_stream.get_codec(); }
+
 	/** Add a key/tag pair to the table, replacing any existing pair with
 	 *  the same key.
 	 *
@@ -720,6 +784,18 @@ class BrassTable {
 	/// Set to true the first time the B-tree is modified.
 	mutable bool Btree_modified;
 
+	/// True if start_commit() has been called but complete_commit() hasn't.
+	bool commit_pending;
+
+	/// The value of revision_number before start_commit() was called.
+	brass_revision_number_t old_revision_number;
+
+	/// The value of latest_revision_number before start_commit() was called.
+	brass_revision_number_t old_latest_revision_number;
+
+	/// The value of both_bases before start_commit() was called.
+	bool old_both_bases;
+
 	/// set to true when full compaction is to be achieved
 	bool full_compaction;
 
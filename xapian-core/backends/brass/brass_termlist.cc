@@ -96,7 +96,7 @@ BrassTermList::accumulate_stats(Xapian::Internal::ExpandStats & stats) const
 {
     LOGCALL_VOID(DB, "BrassTermList::accumulate_stats", stats);
     Assert(!at_end());
-    stats.accumulate(current_wdf, doclen, get_termfreq(), db->get_doccount());
+    stats.accumulate(current_wdf, doclen, *this, db->get_doccount());
 }
 
 string
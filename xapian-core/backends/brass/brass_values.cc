@@ -129,6 +129,32 @@ ValueChunkReader::skip_to(Xapian::docid target)
     p = NULL;
 }
 
+void
+BrassValueManager::set_change(map<Xapian::docid, string> & slot_changes,
+			      Xapian::docid did, const string & val)
+{
+    pair<map<Xapian::docid, string>::iterator, bool> r;
+    r = slot_changes.insert(make_pair(did, val));
+    if (r.second) {
+	mem_used += ENTRY_MEM + val.size();
+    } else {
+	mem_used -= r.first->second.size();
+	r.first->second = val;
+	mem_used += val.size();
+    }
+}
+
+void
+BrassValueManager::swap_slots(Xapian::docid did, string & enc)
+{
+    pair<map<Xapian::docid, string>::iterator, bool> r;
+    r = slots.insert(make_pair(did, string()));
+    if (r.second) mem_used += ENTRY_MEM;
+    mem_used -= r.first->second.size();
+    swap(r.first->second, enc);
+    mem_used += r.first->second.size();
+}
+
 void
 BrassValueManager::add_value(Xapian::docid did, Xapian::valueno slot,
 			     const string & val)
@@ -137,8 +163,9 @@ BrassValueManager::add_value(Xapian::docid did, Xapian::valueno slot,
     i = changes.find(slot);
     if (i == changes.end()) {
 	i = changes.insert(make_pair(slot, map<Xapian::docid, string>())).first;
+	mem_used += SLOT_MEM;
     }
-    i->second[did] = val;
+    set_change(i->second, did, val);
 }
 
 void
@@ -148,8 +175,9 @@ BrassValueManager::remove_value(Xapian::docid did, Xapian::valueno slot)
     i = changes.find(slot);
     if (i == changes.end()) {
 	i = changes.insert(make_pair(slot, map<Xapian::docid, string>())).first;
+	mem_used += SLOT_MEM;
     }
-    i->second[did] = string();
+    set_change(i->second, did, string());
 }
 
 Xapian::docid
@@ -353,6 +381,9 @@ BrassValueManager::merge_changes()
 	}
 	changes.clear();
     }
+
+    // If the termlist table isn't open, slots is always empty.
+    mem_used = 0;
 }
 
 void
@@ -402,7 +433,7 @@ BrassValueManager::add_document(Xapian::docid did, const Xapian::Document &doc,
     if (slots_used.empty() && slots.find(did) == slots.end()) {
 	// Adding a new document with no values which we didn't just remove.
     } else {
-	swap(slots[did], slots_used);
+	swap_slots(did, slots_used);
     }
 }
 
@@ -414,11 +445,13 @@ BrassValueManager::delete_document(Xapian::docid did,
     map<Xapian::docid, string>::iterator it = slots.find(did);
     string s;
     if (it != slots.end()) {
+	mem_used -= it->second.size();
 	swap(s, it->second);
     } else {
 	// Get from table, making a swift exit if this document has no values.
 	if (!termlist_table->get_exact_entry(make_slot_key(did), s)) return;
 	slots.insert(make_pair(did, string()));
+	mem_used += ENTRY_MEM;
     }
     const char * p = s.data();
     const char * end = p + s.size();
@@ -90,6 +90,34 @@ class BrassValueManager {
 
     std::map<Xapian::valueno, std::map<Xapian::docid, std::string> > changes;
 
+    /** Approximate number of bytes of memory used by the buffered changes.
+     *
+     *  Like Inverter, this is an estimate based on the number and size of
+     *  the entries in slots and changes.
+     */
+    size_t mem_used;
+
+    /// Estimated memory used by each entry in a std::map.
+    static const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+
+    /// Estimated memory used by an entry in slots or a slot's changes,
+    /// excluding the string's contents.
+    static const size_t ENTRY_MEM =
+	MAP_NODE_OVERHEAD + sizeof(std::pair<Xapian::docid, std::string>);
+
+    /// Estimated memory used by a slot's entry in changes.
+    static const size_t SLOT_MEM =
+	MAP_NODE_OVERHEAD + sizeof(Xapian::valueno) +
+	sizeof(std::map<Xapian::docid, std::string>);
+
+    /// Set the buffered change for @a did in @a slot_changes to @a val.
+    void set_change(std::map<Xapian::docid, std::string> & slot_changes,
+		    Xapian::docid did, const std::string & val);
+
+    /// Set the buffered slots used by @a did to @a enc, leaving the old
+    /// value in @a enc.
+    void swap_slots(Xapian::docid did, std::string & enc);
+
     void add_value(Xapian::docid did, Xapian::valueno slot,
 		   const std::string & val);
 
@@ -110,7 +138,8 @@ class BrassValueManager {
 		      BrassTermListTable * termlist_table_)
 	: mru_slot(Xapian::BAD_VALUENO),
 	  postlist_table(postlist_table_),
-	  termlist_table(termlist_table_) { }
+	  termlist_table(termlist_table_),
+	  mem_used(0) { }
 
     // Merge in batched-up changes.
     void merge_changes();
@@ -162,10 +191,14 @@ class BrassValueManager {
 	return !changes.empty();
     }
 
+    /// Return the approximate number of bytes used by buffered changes.
+    size_t get_memory_used() const { return mem_used; }
+
     void cancel() {
 	// Discard batched-up changes.
 	slots.clear();
 	changes.clear();
+	mem_used = 0;
     }
 };
 
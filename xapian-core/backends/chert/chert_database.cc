@@ -474,6 +474,8 @@ ChertDatabase::reopen()
 {
     LOGCALL(DB, bool, "ChertDatabase::reopen", NO_ARGS);
     if (!readonly) return false;
+    requested_docs.clear();
+    prefetched_docs.clear();
     return open_tables_consistent();
 }
 
@@ -481,6 +483,8 @@ void
 ChertDatabase::close()
 {
     LOGCALL_VOID(DB, "ChertDatabase::close", NO_ARGS);
+    requested_docs.clear();
+    prefetched_docs.clear();
     postlist_table.close(true);
     position_table.close(true);
     termlist_table.close(true);
@@ -898,6 +902,43 @@ ChertDatabase::open_document(Xapian::docid did, bool lazy) const
     RETURN(new ChertDocument(ptrtothis, did, &value_manager, &record_table));
 }
 
+void
+ChertDatabase::request_document(Xapian::docid did) const
+{
+    LOGCALL_VOID(DB, "ChertDatabase::request_document", did);
+    Assert(did != 0);
+    requested_docs.push_back(did);
+}
+
+Xapian::Document::Internal *
+ChertDatabase::collect_document(Xapian::docid did) const
+{
+    LOGCALL(DB, Xapian::Document::Internal *, "ChertDatabase::collect_document", did);
+    if (!requested_docs.empty()) {
+	// Read the data for all the requested documents in one pass through
+	// the record table.  They're usually requested in rank order, so
+	// sort them into docid order first.  Any documents from an earlier
+	// batch which were never collected are discarded.
+	prefetched_docs.clear();
+	sort(requested_docs.begin(), requested_docs.end());
+	requested_docs.erase(unique(requested_docs.begin(),
+				    requested_docs.end()),
+			     requested_docs.end());
+	record_table.get_records(requested_docs, prefetched_docs);
+	requested_docs.clear();
+    }
+
+    map<Xapian::docid, string>::iterator i = prefetched_docs.find(did);
+    if (i == prefetched_docs.end()) RETURN(open_document(did, true));
+
+    intrusive_ptr<const Database::Internal> ptrtothis(this);
+    Xapian::Document::Internal * doc;
+    doc = new ChertDocument(ptrtothis, did, &value_manager, &record_table,
+			    i->second);
+    prefetched_docs.erase(i);
+    RETURN(doc);
+}
+
 PositionList *
 ChertDatabase::open_position_list(Xapian::docid did, const string & term) const
 {
@@ -42,6 +42,7 @@
 #include "noreturn.h"
 
 #include <map>
+#include <vector>
 
 class ChertTermList;
 class ChertAllDocsPostList;
@@ -118,6 +119,12 @@ class ChertDatabase : public Xapian::Database::Internal {
 	/// Database statistics.
 	ChertDatabaseStats stats;
 
+	/// Documents passed to request_document() which haven't been read yet.
+	mutable vector<Xapian::docid> requested_docs;
+
+	/// Data for requested documents which haven't been collected yet.
+	mutable map<Xapian::docid, string> prefetched_docs;
+
 	/** Return true if a database exists at the path specified for this
 	 *  database.
 	 */
@@ -272,6 +279,8 @@ class ChertDatabase : public Xapian::Database::Internal {
 	LeafPostList * open_post_list(const string & tname) const;
 	ValueList * open_value_list(Xapian::valueno slot) const;
 	Xapian::Document::Internal * open_document(Xapian::docid did, bool lazy) const;
+	void request_document(Xapian::docid did) const;
+	Xapian::Document::Internal * collect_document(Xapian::docid did) const;
 
 	PositionList * open_position_list(Xapian::docid did, const string & term) const;
 	TermList * open_term_list(Xapian::docid did) const;
@@ -404,6 +413,13 @@ class ChertWritableDatabase : public ChertDatabase {
 	Xapian::Document::Internal * open_document(Xapian::docid did,
 						   bool lazy) const;
 
+	/** Don't prefetch documents from a writable database.
+	 *
+	 *  The database could be modified between a document being requested
+	 *  and being collected.
+	 */
+	void request_document(Xapian::docid) const { }
+
 	//@}
 
     public:
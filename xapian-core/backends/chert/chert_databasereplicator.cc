@@ -193,13 +193,8 @@ ChertDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
 		throw NetworkError("Incomplete block in changeset");
 
 	    // Write the block.
-	    // FIXME - should use pwrite if that's available.
-	    if (lseek(fd, off_t(changeset_blocksize) * block_number, SEEK_SET) == -1) {
-		string msg = "Failed to seek to block ";
-		msg += str(block_number);
-		throw DatabaseError(msg, errno);
-	    }
-	    io_write(fd, buf.data(), changeset_blocksize);
+	    io_write_at(fd, buf.data(), changeset_blocksize,
+			off_t(changeset_blocksize) * block_number);
 
 	    write_and_clear_changes(changes_fd, buf, changeset_blocksize);
 	}
@@ -55,5 +55,6 @@ string
 ChertDocument::do_get_data() const
 {
     LOGCALL(DB, string, "ChertDocument::do_get_data", NO_ARGS);
+    if (data_prefetched) RETURN(prefetched_data);
     RETURN(record_table->get_record(did));
 }
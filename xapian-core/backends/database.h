@@ -75,7 +75,7 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 	bool transaction_active() const { return int(transaction_state) > 0; }
 
 	/** Create a database - called only by derived classes. */
-	Internal() : transaction_state(TRANSACTION_NONE) { }
+	Internal() : transaction_state(TRANSACTION_NONE), change_count(0) { }
 
 	/** Internal method to perform cleanup when a writable database is
 	 *  destroyed with uncommitted changes.
@@ -103,6 +103,15 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 	 */
 	virtual ~Internal();
 
+	/** Count of changes made through the API.
+	 *
+	 *  This is incremented whenever documents are added, deleted or
+	 *  replaced, a transaction is cancelled, or reopen() may have moved to
+	 *  a new revision.  This allows cached statistics to be cheaply
+	 *  checked to see if they may be out of date.
+	 */
+	unsigned long change_count;
+
 	/** Send a keep-alive signal to a remote database, to stop
 	 *  it from timing out.
 	 */
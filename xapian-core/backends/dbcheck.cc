@@ -44,33 +44,43 @@ using namespace std;
 
 // FIXME: We don't currently cross-check wdf between postlist and termlist.
 // It's hard to see how to efficiently.  We do cross-check doclens, but that
-// "only" requires (4 * last_docid()) bytes.
+// "only" requires (4 * last_docid()) bytes (or for brass, can be done by
+// reading the termlist table again instead).
 
 #if defined XAPIAN_HAS_BRASS_BACKEND || defined XAPIAN_HAS_CHERT_BACKEND
-static void
+/** Reserve space to cross-check document lengths in memory.
+ *
+ *  @param fallback	What we'll do instead if we can't, for the message
+ *			we report.
+ *
+ *  @return true if the space was reserved.
+ */
+static bool
 reserve_doclens(vector<Xapian::termcount>& doclens, Xapian::docid last_docid,
-		ostream & out)
+		ostream & out, const char * fallback)
 {
     if (last_docid >= 0x40000000ul / sizeof(Xapian::termcount)) {
 	// The memory block needed by the vector would be >= 1GB.
 	out << "Cross-checking document lengths between the postlist and "
 	       "termlist tables would use more than 1GB of memory, so "
-	       "skipping that check" << endl;
-	return;
+	    << fallback << endl;
+	return false;
     }
     try {
 	doclens.reserve(last_docid + 1);
+	return true;
     } catch (const std::bad_alloc &) {
 	// Failed to allocate the required memory.
 	out << "Couldn't allocate enough memory for cross-checking document "
 	       "lengths between the postlist and termlist tables, so "
-	       "skipping that check" << endl;
+	    << fallback << endl;
     } catch (const std::length_error &) {
 	// There are too many elements for the vector to handle!
 	out << "Couldn't allocate enough elements for cross-checking document "
 	       "lengths between the postlist and termlist tables, so "
-	       "skipping that check" << endl;
+	    << fallback << endl;
     }
+    return false;
 }
 #endif
 
@@ -95,7 +105,8 @@ Database::check(const string & path, int opts, std::ostream &out)
 	try {
 	    Xapian::Database db = Xapian::Chert::open(path);
 	    db_last_docid = db.get_lastdocid();
-	    reserve_doclens(doclens, db_last_docid, out);
+	    reserve_doclens(doclens, db_last_docid, out,
+			    "skipping that check");
 	} catch (const Xapian::Error & e) {
 	    // Ignore so we can check a database too broken to open.
 	    out << "Database couldn't be opened for reading: "
@@ -155,10 +166,18 @@ Database::check(const string & path, int opts, std::ostream &out)
 	// If we can't read the last docid, set it to its maximum value
 	// to suppress errors.
 	Xapian::docid db_last_docid = static_cast<Xapian::docid>(-1);
+	// Cross-check document lengths by reading the termlist table
+	// alongside the postlist table if asked to, or if we can't hold them
+	// all in memory.
+	bool stream_doclens = (opts & Xapian::DBCHECK_LOW_MEMORY);
 	try {
 	    Xapian::Database db = Xapian::Brass::open(path);
 	    db_last_docid = db.get_lastdocid();
-	    reserve_doclens(doclens, db_last_docid, out);
+	    if (!stream_doclens &&
+		!reserve_doclens(doclens, db_last_docid, out,
+				 "reading the termlist table again instead")) {
+		stream_doclens = true;
+	    }
 	} catch (const Xapian::Error & e) {
 	    // Ignore so we can check a database too broken to open.
 	    out << "Database couldn't be opened for reading: "
@@ -192,7 +211,7 @@ Database::check(const string & path, int opts, std::ostream &out)
 		}
 	    }
 	    errors += check_brass_table(*t, table, opts, doclens,
-					db_last_docid, out);
+					stream_doclens, db_last_docid, out);
 	}
 #endif
     } else {
@@ -236,7 +255,7 @@ Database::check(const string & path, int opts, std::ostream &out)
 	    // Set the last docid to its maximum value to suppress errors.
 	    Xapian::docid db_last_docid = static_cast<Xapian::docid>(-1);
 	    errors = check_brass_table(tablename.c_str(), filename, opts,
-				       doclens, db_last_docid, out);
+				       doclens, false, db_last_docid, out);
 #endif
 	} else if (file_exists(dir + "iamflint")) {
 	    // Flint is no longer supported as of Xapian 1.3.0.
@@ -226,8 +226,7 @@ InMemoryTermList::accumulate_stats(Xapian::Internal::ExpandStats & stats) const
     if (db->is_closed()) InMemoryDatabase::throw_database_closed();
     Assert(started);
     Assert(!at_end());
-    stats.accumulate(InMemoryTermList::get_wdf(), document_length,
-		     InMemoryTermList::get_termfreq(),
+    stats.accumulate(InMemoryTermList::get_wdf(), document_length, *this,
 		     db->get_doccount());
 }
 
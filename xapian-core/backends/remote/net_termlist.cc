@@ -57,7 +57,7 @@ NetworkTermList::accumulate_stats(Xapian::Internal::ExpandStats & stats) const
 
     stats.accumulate(current_position->wdf,
 		     document_length,
-		     current_position->termfreq,
+		     *this,
 		     database_size);
 }
 
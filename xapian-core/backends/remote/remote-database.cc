@@ -42,6 +42,7 @@
 #include "stringutils.h" // For STRINGIZE().
 #include "weight/weightinternal.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -65,6 +66,8 @@ RemoteDatabase::RemoteDatabase(int fd, double timeout_,
 	  cached_stats_valid(),
 	  mru_valstats(),
 	  mru_slot(Xapian::BAD_VALUENO),
+	  connection_reusable(true),
+	  query_in_progress(false),
 	  timeout(timeout_)
 {
 #ifndef __WIN32__
@@ -121,11 +124,17 @@ RemoteDatabase::open_metadata_keylist(const std::string &prefix) const
     string term = prefix;
     char type;
     while ((type = get_message(message)) == REPLY_METADATAKEYLIST) {
-	NetworkTermListItem item;
-	term.resize(size_t((unsigned char)message[0]));
-	term.append(message, 1, string::npos);
-	item.tname = term;
-	items.push_back(item);
+	const char * p = message.data();
+	const char * p_end = p + message.size();
+	while (p != p_end) {
+	    NetworkTermListItem item;
+	    term.resize(size_t((unsigned char)*p++));
+	    size_t len = decode_length(&p, p_end, true);
+	    term.append(p, len);
+	    p += len;
+	    item.tname = term;
+	    items.push_back(item);
+	}
     }
     if (type != REPLY_DONE)
 	throw_bad_message(context);
@@ -162,15 +171,20 @@ RemoteDatabase::open_term_list(Xapian::docid did) const
     string term;
     char type;
     while ((type = get_message(message)) == REPLY_TERMLIST) {
-	NetworkTermListItem item;
 	p = message.data();
 	p_end = p + message.size();
-	item.wdf = decode_length(&p, p_end, false);
-	item.termfreq = decode_length(&p, p_end, false);
-	term.resize(size_t((unsigned char)*p++));
-	term.append(p, p_end);
-	item.tname = term;
-	items.push_back(item);
+	while (p != p_end) {
+	    NetworkTermListItem item;
+	    item.wdf = decode_length(&p, p_end, false);
+	    item.termfreq = decode_length(&p, p_end, false);
+	    if (p == p_end) throw_bad_message(context);
+	    term.resize(size_t((unsigned char)*p++));
+	    size_t len = decode_length(&p, p_end, true);
+	    term.append(p, len);
+	    p += len;
+	    item.tname = term;
+	    items.push_back(item);
+	}
     }
     if (type != REPLY_DONE)
 	throw_bad_message(context);
@@ -196,14 +210,19 @@ RemoteDatabase::open_allterms(const string & prefix) const {
     string message;
     char type;
     while ((type = get_message(message)) == REPLY_ALLTERMS) {
-	NetworkTermListItem item;
 	const char * p = message.data();
 	const char * p_end = p + message.size();
-	item.termfreq = decode_length(&p, p_end, false);
-	term.resize(size_t((unsigned char)*p++));
-	term.append(p, p_end);
-	item.tname = term;
-	items.push_back(item);
+	while (p != p_end) {
+	    NetworkTermListItem item;
+	    item.termfreq = decode_length(&p, p_end, false);
+	    if (p == p_end) throw_bad_message(context);
+	    term.resize(size_t((unsigned char)*p++));
+	    size_t len = decode_length(&p, p_end, true);
+	    term.append(p, len);
+	    p += len;
+	    item.tname = term;
+	    items.push_back(item);
+	}
     }
     if (type != REPLY_DONE)
 	throw_bad_message(context);
@@ -253,8 +272,10 @@ RemoteDatabase::open_position_list(Xapian::docid did, const string &term) const
     while ((type = get_message(message)) == REPLY_POSITIONLIST) {
 	const char * p = message.data();
 	const char * p_end = p + message.size();
-	lastpos += decode_length(&p, p_end, false) + 1;
-	positions.push_back(lastpos);
+	while (p != p_end) {
+	    lastpos += decode_length(&p, p_end, false) + 1;
+	    positions.push_back(lastpos);
+	}
     }
     if (type != REPLY_DONE)
 	throw_bad_message(context);
@@ -273,6 +294,8 @@ bool
 RemoteDatabase::reopen()
 {
     mru_slot = Xapian::BAD_VALUENO;
+    requested_docs.clear();
+    prefetched_docs.clear();
     return update_stats(MSG_REOPEN);
 }
 
@@ -297,7 +320,16 @@ RemoteDatabase::open_document(Xapian::docid did, bool /*lazy*/) const
     send_message(MSG_DOCUMENT, encode_length(did));
     string doc_data;
     map<Xapian::valueno, string> values;
-    get_message(doc_data, REPLY_DOCDATA);
+    read_document(doc_data, values);
+
+    return new RemoteDocument(this, did, doc_data, values);
+}
+
+void
+RemoteDatabase::read_document(string & data,
+			      map<Xapian::valueno, string> & values) const
+{
+    get_message(data, REPLY_DOCDATA);
 
     reply_type type;
     string message;
@@ -309,8 +341,74 @@ RemoteDatabase::open_document(Xapian::docid did, bool /*lazy*/) const
     }
     if (type != REPLY_DONE)
 	throw_bad_message(context);
+}
 
-    return new RemoteDocument(this, did, doc_data, values);
+void
+RemoteDatabase::request_document(Xapian::docid did) const
+{
+    Assert(did);
+    // The database could be modified between a document being requested and
+    // being collected, so don't prefetch from a writable database.
+    if (transaction_state != TRANSACTION_UNIMPLEMENTED) return;
+    requested_docs.push_back(did);
+}
+
+void
+RemoteDatabase::read_requested_docs() const
+{
+    // Any documents from an earlier batch which were never collected are
+    // discarded.
+    prefetched_docs.clear();
+    sort(requested_docs.begin(), requested_docs.end());
+    requested_docs.erase(unique(requested_docs.begin(), requested_docs.end()),
+			 requested_docs.end());
+
+    // Send the requests in batches and then read the replies, so we only
+    // wait for a round trip once per batch, not once per document.  We
+    // limit the batch size so the server can't block writing replies while
+    // we're blocked writing requests.
+    const size_t BATCH_SIZE = 64;
+    vector<Xapian::docid>::const_iterator i = requested_docs.begin();
+    while (i != requested_docs.end()) {
+	vector<Xapian::docid>::const_iterator batch_end = i;
+	size_t n = min(BATCH_SIZE, size_t(requested_docs.end() - i));
+	batch_end += n;
+	vector<Xapian::docid>::const_iterator j;
+	for (j = i; j != batch_end; ++j) {
+	    send_message(MSG_DOCUMENT, encode_length(*j));
+	}
+	for (j = i; j != batch_end; ++j) {
+	    prefetched_doc & doc = prefetched_docs[*j];
+	    try {
+		read_document(doc.first, doc.second);
+	    } catch (const Xapian::NetworkError &) {
+		requested_docs.clear();
+		prefetched_docs.clear();
+		throw;
+	    } catch (const Xapian::Error &) {
+		// The error will be reported if the document is collected,
+		// since then we'll ask for it again.
+		prefetched_docs.erase(*j);
+	    }
+	}
+	i = batch_end;
+    }
+    requested_docs.clear();
+}
+
+Xapian::Document::Internal *
+RemoteDatabase::collect_document(Xapian::docid did) const
+{
+    if (!requested_docs.empty()) read_requested_docs();
+
+    map<Xapian::docid, prefetched_doc>::iterator i;
+    i = prefetched_docs.find(did);
+    if (i == prefetched_docs.end()) return open_document(did, true);
+
+    Xapian::Document::Internal * doc;
+    doc = new RemoteDocument(this, did, i->second.first, i->second.second);
+    prefetched_docs.erase(i);
+    return doc;
 }
 
 bool
@@ -359,6 +457,8 @@ RemoteDatabase::update_stats(message_type msg_code) const
     total_length = decode_length(&p, p_end, false);
     uuid.assign(p, p_end);
     cached_stats_valid = true;
+    // We may now be looking at a different revision.
+    freq_cache.clear();
     return true;
 }
 
@@ -402,31 +502,50 @@ RemoteDatabase::term_exists(const string & tname) const
     return (type == REPLY_TERMEXISTS);
 }
 
+void
+RemoteDatabase::get_freqs(const string & tname,
+			  Xapian::doccount * termfreq_ptr,
+			  Xapian::termcount * collfreq_ptr) const
+{
+    Assert(!tname.empty());
+    // The statistics of a WritableDatabase change as it is modified, so only
+    // cache them if we're read-only.
+    bool cacheable = (transaction_state == TRANSACTION_UNIMPLEMENTED);
+    Xapian::doccount termfreq;
+    Xapian::termcount collfreq;
+    if (!cacheable || !freq_cache.find(tname, termfreq, collfreq)) {
+	send_message(MSG_FREQS, tname);
+	string message;
+	get_message(message, REPLY_FREQS);
+	const char * p = message.data();
+	const char * p_end = p + message.size();
+	termfreq = decode_length(&p, p_end, false);
+	collfreq = decode_length(&p, p_end, false);
+	if (p != p_end) {
+	    throw Xapian::NetworkError("Bad REPLY_FREQS message received", context);
+	}
+	if (cacheable) freq_cache.add(tname, termfreq, collfreq);
+    }
+    if (termfreq_ptr) *termfreq_ptr = termfreq;
+    if (collfreq_ptr) *collfreq_ptr = collfreq;
+}
+
 Xapian::doccount
 RemoteDatabase::get_termfreq(const string & tname) const
 {
-    Assert(!tname.empty());
-    send_message(MSG_TERMFREQ, tname);
-    string message;
-    get_message(message, REPLY_TERMFREQ);
-    const char * p = message.data();
-    const char * p_end = p + message.size();
-    return decode_length(&p, p_end, false);
+    Xapian::doccount termfreq;
+    get_freqs(tname, &termfreq, NULL);
+    return termfreq;
 }
 
 Xapian::termcount
 RemoteDatabase::get_collection_freq(const string & tname) const
 {
-    Assert(!tname.empty());
-    send_message(MSG_COLLFREQ, tname);
-    string message;
-    get_message(message, REPLY_COLLFREQ);
-    const char * p = message.data();
-    const char * p_end = p + message.size();
-    return decode_length(&p, p_end, false);
+    Xapian::termcount collfreq;
+    get_freqs(tname, NULL, &collfreq);
+    return collfreq;
 }
 
-
 void
 RemoteDatabase::read_value_stats(Xapian::valueno slot) const
 {
@@ -513,11 +632,18 @@ reply_type
 RemoteDatabase::get_message(string &result, reply_type required_type) const
 {
     double end_time = RealTime::end_time(timeout);
-    reply_type type = static_cast<reply_type>(link.get_message(result, end_time));
+    reply_type type;
+    try {
+	type = static_cast<reply_type>(link.get_message(result, end_time));
+    } catch (const Xapian::NetworkError &) {
+	connection_reusable = false;
+	throw;
+    }
     if (type == REPLY_EXCEPTION) {
 	unserialise_error(result, "REMOTE:", context);
     }
     if (required_type != REPLY_MAX && type != required_type) {
+	connection_reusable = false;
 	string errmsg("Expecting reply type ");
 	errmsg += str(int(required_type));
 	errmsg += ", got ";
@@ -532,7 +658,12 @@ void
 RemoteDatabase::send_message(message_type type, const string &message) const
 {
     double end_time = RealTime::end_time(timeout);
-    link.send_message(static_cast<unsigned char>(type), message, end_time);
+    try {
+	link.send_message(static_cast<unsigned char>(type), message, end_time);
+    } catch (const Xapian::NetworkError &) {
+	connection_reusable = false;
+	throw;
+    }
 }
 
 void
@@ -553,6 +684,17 @@ RemoteDatabase::do_close()
     link.do_close(writable);
 }
 
+int
+RemoteDatabase::release_connection()
+{
+    // We don't reuse a connection to a writable database since the server
+    // holds the write lock until the connection is closed.
+    if (transaction_state != TRANSACTION_UNIMPLEMENTED ||
+	!connection_reusable || query_in_progress)
+	return -1;
+    return link.detach();
+}
+
 void
 RemoteDatabase::set_query(const Xapian::Query& query,
 			 Xapian::termcount qlen,
@@ -563,6 +705,7 @@ RemoteDatabase::set_query(const Xapian::Query& query,
 			 Xapian::Enquire::Internal::sort_setting sort_by,
 			 bool sort_value_forward,
 			 double time_limit,
+			 const string & continuation,
 			 int percent_cutoff, double weight_cutoff,
 			 const Xapian::Weight *wtscheme,
 			 const Xapian::RSet &omrset,
@@ -581,6 +724,8 @@ RemoteDatabase::set_query(const Xapian::Query& query,
     message += char('0' + sort_by);
     message += char('0' + sort_value_forward);
     message += serialise_double(time_limit);
+    message += encode_length(continuation.size());
+    message += continuation;
     message += char(percent_cutoff);
     message += serialise_double(weight_cutoff);
 
@@ -611,6 +756,7 @@ RemoteDatabase::set_query(const Xapian::Query& query,
     }
 
     send_message(MSG_QUERY, message);
+    query_in_progress = true;
 }
 
 bool
@@ -657,6 +803,7 @@ RemoteDatabase::get_mset(Xapian::MSet &mset,
 	(*i)->merge_results(spyresults);
     }
     mset = unserialise_mset(p, p_end);
+    query_in_progress = false;
 }
 
 void
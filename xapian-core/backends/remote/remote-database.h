@@ -26,6 +26,7 @@
 #include "api/omenquireinternal.h"
 #include "api/queryinternal.h"
 #include "net/remoteconnection.h"
+#include "backends/termstatscache.h"
 #include "backends/valuestats.h"
 #include "xapian/weight.h"
 
@@ -86,8 +87,45 @@ class RemoteDatabase : public Xapian::Database::Internal {
      */
     mutable Xapian::valueno mru_slot;
 
+    /** Cache of the termfreq and collection freq of recently used terms.
+     *
+     *  Only used for a read-only database, and cleared when the remote
+     *  database is updated to a new revision.
+     */
+    mutable TermStatsCache freq_cache;
+
+    /// Documents passed to request_document() which haven't been read yet.
+    mutable vector<Xapian::docid> requested_docs;
+
+    /// The data and values of a document which was read in advance.
+    typedef pair<string, map<Xapian::valueno, string> > prefetched_doc;
+
+    /// Requested documents which have been read but not yet collected.
+    mutable map<Xapian::docid, prefetched_doc> prefetched_docs;
+
+    /** Could the connection be reused by another RemoteDatabase?
+     *
+     *  This becomes false once a network error has occurred, since then we
+     *  don't know what state the connection is in.
+     */
+    mutable bool connection_reusable;
+
+    /** Have we sent MSG_QUERY without yet reading the resulting MSet?
+     *
+     *  If so, the server is partway through a conversation, so the connection
+     *  can't be reused.
+     */
+    bool query_in_progress;
+
     bool update_stats(message_type msg_code = MSG_UPDATE) const;
 
+    /// Read the reply to MSG_DOCUMENT.
+    void read_document(string & data,
+		       map<Xapian::valueno, string> & values) const;
+
+    /// Read all the documents in requested_docs.
+    void read_requested_docs() const;
+
   protected:
     /** Constructor.  The constructor is protected so that raw instances
      *  can't be created - a derived class must be instantiated which
@@ -114,6 +152,16 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Close the socket
     void do_close();
 
+    /** Detach the connection so another RemoteDatabase can reuse it.
+     *
+     *  This is only possible for a read-only database with no conversation
+     *  with the server in progress.
+     *
+     *  @return	The fd of the connection, or -1 if it can't be reused (in which
+     *		case it is left open).
+     */
+    int release_connection();
+
     bool get_posting(Xapian::docid &did, double &w, string &value);
 
     /// The timeout value used in network communications, in seconds.
@@ -140,6 +188,8 @@ class RemoteDatabase : public Xapian::Database::Internal {
      * @param sort_value_forward	Sort order for values.
      * @param time_limit_		Seconds to reduce check_at_least after
      *					(or <= 0 for no limit).
+     * @param continuation		Continuation token (or empty for
+     *					none).
      * @param percent_cutoff		Percentage cutoff.
      * @param weight_cutoff		Weight cutoff.
      * @param wtscheme			Weighting scheme.
@@ -155,6 +205,7 @@ class RemoteDatabase : public Xapian::Database::Internal {
 		   Xapian::Enquire::Internal::sort_setting sort_by,
 		   bool sort_value_forward,
 		   double time_limit,
+		   const string & continuation,
 		   int percent_cutoff, double weight_cutoff,
 		   const Xapian::Weight *wtscheme,
 		   const Xapian::RSet &omrset,
@@ -201,6 +252,10 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Get a remote document.
     Xapian::Document::Internal * open_document(Xapian::docid did, bool lazy) const;
 
+    void request_document(Xapian::docid did) const;
+
+    Xapian::Document::Internal * collect_document(Xapian::docid did) const;
+
     /// Get the document count.
     Xapian::doccount get_doccount() const;
 
@@ -217,6 +272,11 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Check if term exists.
     bool term_exists(const string & tname) const;
 
+    /// Read the termfreq and collection freq of a term.
+    void get_freqs(const string & tname,
+		   Xapian::doccount * termfreq_ptr,
+		   Xapian::termcount * collfreq_ptr) const;
+
     /// Find frequency of term.
     Xapian::doccount get_termfreq(const string & tname) const;
 
@@ -0,0 +1,127 @@
+/** @file termstatscache.h
+ * @brief Bounded LRU cache of per-term statistics.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_TERMSTATSCACHE_H
+#define XAPIAN_INCLUDED_TERMSTATSCACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "xapian/types.h"
+
+/** Bounded LRU cache of the termfreq and collection frequency of terms.
+ *
+ *  A backend owns one of these per revision it has open, so it is shared by
+ *  everything using that Database object.  The owner must call erase() for a
+ *  term whose statistics change, and clear() when they all might (e.g. on
+ *  reopen() or when changes are cancelled).
+ */
+class TermStatsCache {
+    /// The statistics we cache for each term.
+    struct Entry {
+	Xapian::doccount termfreq;
+
+	Xapian::termcount collfreq;
+
+	/// Position of this term in lru.
+	std::list<std::string>::iterator lru_pos;
+    };
+
+    typedef std::map<std::string, Entry> entry_map;
+
+    /// The cached entries.
+    entry_map entries;
+
+    /// Terms in entries, most recently used first.
+    std::list<std::string> lru;
+
+    /// The maximum number of entries to cache.
+    size_t max_entries;
+
+    /// Don't allow assignment.
+    void operator=(const TermStatsCache &);
+
+    /// Don't allow copying.
+    TermStatsCache(const TermStatsCache &);
+
+  public:
+    /// The default number of terms to cache statistics for.
+    static const size_t DEFAULT_MAX_ENTRIES = 1000;
+
+    explicit TermStatsCache(size_t max_entries_ = DEFAULT_MAX_ENTRIES)
+	: max_entries(max_entries_) { }
+
+    /** Look up the statistics for @a term.
+     *
+     *  @return true if @a term was found in the cache, in which case
+     *		@a termfreq and @a collfreq have been set.
+     */
+    bool find(const std::string & term,
+	      Xapian::doccount & termfreq,
+	      Xapian::termcount & collfreq) {
+	entry_map::iterator i = entries.find(term);
+	if (i == entries.end()) return false;
+	// Move this term to the front of the LRU list.
+	lru.splice(lru.begin(), lru, i->second.lru_pos);
+	termfreq = i->second.termfreq;
+	collfreq = i->second.collfreq;
+	return true;
+    }
+
+    /// Add the statistics for @a term, evicting the LRU entry if full.
+    void add(const std::string & term,
+	     Xapian::doccount termfreq,
+	     Xapian::termcount collfreq) {
+	if (max_entries == 0) return;
+	std::pair<entry_map::iterator, bool> r;
+	r = entries.insert(std::make_pair(term, Entry()));
+	Entry & entry = r.first->second;
+	if (r.second) {
+	    if (entries.size() > max_entries) {
+		entries.erase(lru.back());
+		lru.pop_back();
+	    }
+	    lru.push_front(term);
+	} else {
+	    lru.splice(lru.begin(), lru, entry.lru_pos);
+	}
+	entry.lru_pos = lru.begin();
+	entry.termfreq = termfreq;
+	entry.collfreq = collfreq;
+    }
+
+    /// Discard any cached statistics for @a term.
+    void erase(const std::string & term) {
+	entry_map::iterator i = entries.find(term);
+	if (i == entries.end()) return;
+	lru.erase(i->second.lru_pos);
+	entries.erase(i);
+    }
+
+    /// Discard all cached statistics.
+    void clear() {
+	entries.clear();
+	lru.clear();
+    }
+};
+
+#endif // XAPIAN_INCLUDED_TERMSTATSCACHE_H
@@ -35,11 +35,12 @@ using namespace std;
 #define PROG_DESC "Check the consistency of a database or table"
 
 static void show_usage() {
-    cout << "Usage: "PROG_NAME" <database directory>|<path to btree and prefix> [[F][t][f][b][v][+]]\n\n"
+    cout << "Usage: "PROG_NAME" <database directory>|<path to btree and prefix> [[F][m][t][f][b][v][+]]\n\n"
 "If a whole database is checked, then additional cross-checks between\n"
 "the tables are performed.\n\n"
 "The btree(s) is/are always checked - control the output verbosity with:\n"
 " F = attempt to fix a broken database (implemented for chert currently)\n"
+" m = use bounded memory for cross-checks (implemented for brass currently)\n"
 " t = short tree printing\n"
 " f = full tree printing\n"
 " b = show bitmap\n"
@@ -85,9 +86,12 @@ main(int argc, char **argv)
 	    case 'F':
 		opts |= Xapian::DBCHECK_FIX;
 		break;
+	    case 'm':
+		opts |= Xapian::DBCHECK_LOW_MEMORY;
+		break;
 	    default:
 		cerr << "option " << opt_string << " unknown\n";
-		cerr << "use t,f,b,v and/or + in the option string\n";
+		cerr << "use F,m,t,f,b,v and/or + in the option string\n";
 		exit(1);
 	}
     }
@@ -14,6 +14,7 @@ noinst_HEADERS +=\
 	common/keyword.h\
 	common/log2.h\
 	common/msvc_dirent.h\
+	common/mutex.h\
 	common/noreturn.h\
 	common/omassert.h\
 	common/output.h\
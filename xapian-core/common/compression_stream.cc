@@ -22,11 +22,17 @@
 
 #include <config.h>
 #include "compression_stream.h"
+#include "pack.h"
 #include "str.h"
 #include "stringutils.h"
+#include "unaligned.h"
 
 #include "xapian/error.h"
 
+#ifdef HAVE_LZ4
+# include <lz4.h>
+#endif
+
 using namespace std;
 
 CompressionStream::CompressionStream(int compress_strategy_)
@@ -35,7 +41,12 @@ CompressionStream::CompressionStream(int compress_strategy_)
       out_len(0),
       out(NULL),
       deflate_zstream(NULL),
-      inflate_zstream(NULL)
+      inflate_zstream(NULL),
+      codec(CODEC_ZLIB)
+#ifdef HAVE_ZSTD
+      , zstd_cctx(NULL),
+      zstd_dctx(NULL)
+#endif
 {
     // LOGCALL_CTOR()
 }
@@ -55,6 +66,11 @@ CompressionStream::~CompressionStream() {
 	delete inflate_zstream;
     }
 
+#ifdef HAVE_ZSTD
+    if (zstd_cctx) (void)ZSTD_freeCCtx(zstd_cctx);
+    if (zstd_dctx) (void)ZSTD_freeDCtx(zstd_dctx);
+#endif
+
     delete [] out;
 }
 
@@ -90,6 +106,235 @@ CompressionStream::compress(byte * buf, int size) {
     zerr = deflate(deflate_zstream, Z_FINISH);
 }
 
+void
+CompressionStream::inflate_error(int err) const
+{
+    if (err == Z_MEM_ERROR) throw std::bad_alloc();
+    string msg = "inflate failed";
+    if (inflate_zstream->msg) {
+	msg += " (";
+	msg += inflate_zstream->msg;
+	msg += ')';
+    }
+    throw Xapian::DatabaseError(msg);
+}
+
+void
+CompressionStream::decompress_start(string & output, size_t size_hint) const {
+    lazy_alloc_inflate_zstream();
+    // Tags usually expand to a few times their compressed size, so start
+    // with twice the size and double whenever we run out of space.
+    output.resize(size_hint * 2 + 64);
+}
+
+bool
+CompressionStream::decompress_chunk(const char * p, size_t len,
+				    string & output) const {
+    inflate_zstream->next_in = (Bytef*)const_cast<char *>(p);
+    inflate_zstream->avail_in = (uInt)len;
+
+    while (true) {
+	size_t done = inflate_zstream->total_out;
+	if (done == output.size()) output.resize(output.size() * 2);
+	inflate_zstream->next_out = reinterpret_cast<Bytef*>(&output[done]);
+	inflate_zstream->avail_out = (uInt)(output.size() - done);
+	int err = inflate(inflate_zstream, Z_SYNC_FLUSH);
+	if (err == Z_STREAM_END) {
+	    // OpenBSD's zlib.h uses off_t instead of uLong for total_out.
+	    output.resize((size_t)inflate_zstream->total_out);
+	    return true;
+	}
+	if (err == Z_BUF_ERROR && inflate_zstream->avail_in == 0) {
+	    // No progress possible without more input.
+	    return false;
+	}
+	if (err != Z_OK) inflate_error(err);
+	// If there's output space left over, all the input has been used
+	// and there's no pending output.
+	if (inflate_zstream->avail_in == 0 && inflate_zstream->avail_out != 0)
+	    return false;
+    }
+}
+
+void
+CompressionStream::decompress_finish(string & output) const {
+    // We've run out of input without reaching the end of the stream.  Older
+    // tags may lack the checksum zlib is expecting, so try supplying it.
+    Bytef header2[4];
+    setint4(header2, 0, inflate_zstream->adler);
+    if (decompress_chunk(reinterpret_cast<const char *>(header2), 4, output))
+	return;
+    inflate_error(Z_BUF_ERROR);
+}
+
+bool
+CompressionStream::decompress_block(const char * p, size_t len,
+				    char * output, size_t output_len) const {
+    lazy_alloc_inflate_zstream();
+    inflate_zstream->next_in = (Bytef*)const_cast<char *>(p);
+    inflate_zstream->avail_in = (uInt)len;
+    inflate_zstream->next_out = reinterpret_cast<Bytef*>(output);
+    inflate_zstream->avail_out = (uInt)output_len;
+    int err = inflate(inflate_zstream, Z_FINISH);
+    if (err == Z_MEM_ERROR) throw std::bad_alloc();
+    return err == Z_STREAM_END && inflate_zstream->total_out == output_len;
+}
+
+bool
+CompressionStream::codec_supported(int codec_)
+{
+    switch (codec_) {
+	case CODEC_ZLIB:
+	    return true;
+#ifdef HAVE_LZ4
+	case CODEC_LZ4:
+	    return true;
+#endif
+#ifdef HAVE_ZSTD
+	case CODEC_ZSTD:
+	    return true;
+#endif
+    }
+    return false;
+}
+
+void
+CompressionStream::set_codec(int codec_)
+{
+    if (rare(!codec_supported(codec_))) {
+	const char * name;
+	switch (codec_) {
+	    case CODEC_LZ4:
+		name = "LZ4";
+		break;
+	    case CODEC_ZSTD:
+		name = "Zstandard";
+		break;
+	    default:
+		throw Xapian::FeatureUnavailableError("Unknown compression "
+						      "codec " + str(codec_));
+	}
+	string msg = name;
+	msg += " compression support wasn't enabled when Xapian was built";
+	throw Xapian::FeatureUnavailableError(msg);
+    }
+    codec = codec_;
+}
+
+bool
+CompressionStream::compress_tag(string & buf)
+{
+    if (codec == CODEC_ZLIB) {
+	lazy_alloc_deflate_zstream();
+	// If compressed size is >= buf.size(), we don't want to compress, so
+	// compress() only allows for buf.size() - 1 bytes of output.
+	compress(buf);
+	if (zerr != Z_STREAM_END) {
+	    // Deflate failed - presumably the data wasn't compressible.
+	    return false;
+	}
+	buf.assign(reinterpret_cast<const char *>(out),
+		   deflate_zstream->total_out);
+	return true;
+    }
+
+    // The other codecs need to know the uncompressed size when
+    // decompressing, so we store it first.
+    string header;
+    pack_uint(header, buf.size());
+    if (buf.size() <= header.size() + 1) return false;
+    // Only accept output which is at least one byte smaller than the input.
+    size_t max_len = buf.size() - header.size() - 1;
+    if (!out || out_len < max_len) {
+	delete [] out;
+	out = NULL;
+	out_len = max_len;
+	out = new unsigned char[out_len];
+    }
+    char * dest = reinterpret_cast<char *>(out);
+    size_t len = 0;
+    switch (codec) {
+#ifdef HAVE_LZ4
+	case CODEC_LZ4: {
+	    if (buf.size() > size_t(LZ4_MAX_INPUT_SIZE)) return false;
+	    int r = LZ4_compress_default(buf.data(), dest, int(buf.size()),
+					 int(max_len));
+	    // 0 means the output didn't fit.
+	    if (r <= 0) return false;
+	    len = r;
+	    break;
+	}
+#endif
+#ifdef HAVE_ZSTD
+	case CODEC_ZSTD: {
+	    if (!zstd_cctx) {
+		zstd_cctx = ZSTD_createCCtx();
+		if (!zstd_cctx) throw std::bad_alloc();
+	    }
+	    size_t r = ZSTD_compressCCtx(zstd_cctx, dest, max_len,
+					 buf.data(), buf.size(),
+					 ZSTD_CLEVEL_DEFAULT);
+	    // An error probably means the output didn't fit.
+	    if (ZSTD_isError(r)) return false;
+	    len = r;
+	    break;
+	}
+#endif
+	default:
+	    // set_codec() only allows codecs which are supported.
+	    return false;
+    }
+    buf = header;
+    buf.append(dest, len);
+    return true;
+}
+
+void
+CompressionStream::decompress_tag(const char * p, size_t len,
+				  string & output) const
+{
+    if (codec == CODEC_ZLIB) {
+	decompress_start(output, len);
+	if (!decompress_chunk(p, len, output)) decompress_finish(output);
+	return;
+    }
+
+    const char * end = p + len;
+    size_t size;
+    if (!unpack_uint(&p, end, &size)) {
+	throw Xapian::DatabaseCorruptError("Bad uncompressed size for "
+					   "compressed tag");
+    }
+    output.resize(size);
+    bool ok = false;
+    switch (codec) {
+#ifdef HAVE_LZ4
+	case CODEC_LZ4: {
+	    if (size > size_t(LZ4_MAX_INPUT_SIZE)) break;
+	    int r = LZ4_decompress_safe(p, size ? &output[0] : NULL,
+					int(end - p), int(size));
+	    ok = (r >= 0 && size_t(r) == size);
+	    break;
+	}
+#endif
+#ifdef HAVE_ZSTD
+	case CODEC_ZSTD: {
+	    if (!zstd_dctx) {
+		zstd_dctx = ZSTD_createDCtx();
+		if (!zstd_dctx) throw std::bad_alloc();
+	    }
+	    size_t r = ZSTD_decompressDCtx(zstd_dctx, size ? &output[0] : NULL,
+					   size, p, end - p);
+	    ok = (!ZSTD_isError(r) && r == size);
+	    break;
+	}
+#endif
+    }
+    if (rare(!ok)) {
+	throw Xapian::DatabaseCorruptError("Failed to decompress tag");
+    }
+}
+
 void
 CompressionStream::lazy_alloc_deflate_zstream() const {
     if (usual(deflate_zstream)) {
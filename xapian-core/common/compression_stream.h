@@ -23,11 +23,25 @@
 #define XAPIAN_INCLUDED_COMPRESSION_STREAM_H
 
 #include "internaltypes.h"
+#include "noreturn.h"
 #include <string>
 #include <zlib.h>
+#ifdef HAVE_ZSTD
+# include <zstd.h>
+#endif
 
 #define DONT_COMPRESS -1
 
+/** Codecs which compress_tag() and decompress_tag() can use.
+ *
+ *  These values are stored in brass base files, so mustn't be changed.
+ */
+enum {
+    CODEC_ZLIB = 0,
+    CODEC_LZ4 = 1,
+    CODEC_ZSTD = 2
+};
+
 class CompressionStream {
   public:
     explicit CompressionStream(int compress_strategy_ = Z_DEFAULT_STRATEGY);
@@ -48,6 +62,17 @@ class CompressionStream {
     /// Zlib state object for inflating
     mutable z_stream *inflate_zstream;
 
+    /// The codec used by compress_tag() and decompress_tag().
+    int codec;
+
+#ifdef HAVE_ZSTD
+    /// Zstandard context for compressing, or NULL if not yet allocated.
+    ZSTD_CCtx * zstd_cctx;
+
+    /// Zstandard context for decompressing, or NULL if not yet allocated.
+    mutable ZSTD_DCtx * zstd_dctx;
+#endif
+
     /// Allocate the zstream for deflating, if not already allocated.
     void lazy_alloc_deflate_zstream() const;
 
@@ -56,6 +81,85 @@ class CompressionStream {
 
     void compress(std::string &);
     void compress(byte *, int);
+
+    /** Start decompressing a raw deflate stream supplied in pieces.
+     *
+     *  The data is inflated directly into @a output, which is grown as
+     *  needed.  This allows a tag split over several items to be
+     *  decompressed as each item is read, without first joining the
+     *  compressed pieces.
+     *
+     *  @param output	  String to decompress into.
+     *  @param size_hint  Approximate size of the compressed data.
+     */
+    void decompress_start(std::string & output, size_t size_hint) const;
+
+    /** Decompress the next piece of the stream.
+     *
+     *  @return true if the end of the stream has been reached, in which
+     *		case @a output holds the decompressed data.
+     */
+    bool decompress_chunk(const char * p, size_t len,
+			  std::string & output) const;
+
+    /** Finish decompressing after the last piece.
+     *
+     *  Only needed if decompress_chunk() returned false for the last piece.
+     */
+    void decompress_finish(std::string & output) const;
+
+    /** Decompress a raw deflate stream of known uncompressed size.
+     *
+     *  @param p	The compressed data.
+     *  @param len	The length of the compressed data.
+     *  @param output	Buffer to decompress into.
+     *  @param output_len	The expected size of the decompressed data.
+     *
+     *  @return true if the data decompressed to exactly @a output_len
+     *		bytes, false if it was corrupt or the wrong size.
+     */
+    bool decompress_block(const char * p, size_t len,
+			  char * output, size_t output_len) const;
+
+    /** Return true if support for @a codec_ was compiled in.
+     *
+     *  zlib is always supported.
+     */
+    static bool codec_supported(int codec_);
+
+    /** Set the codec used by compress_tag() and decompress_tag().
+     *
+     *  @exception Xapian::FeatureUnavailableError if support for @a codec_
+     *		   wasn't compiled in.
+     */
+    void set_codec(int codec_);
+
+    /// Return the codec used by compress_tag() and decompress_tag().
+    int get_codec() const { return codec; }
+
+    /** Compress @a buf with the codec set by set_codec().
+     *
+     *  @return true if the compressed data is smaller than @a buf, in which
+     *		case @a buf is replaced by it; false if @a buf is unchanged.
+     */
+    bool compress_tag(std::string & buf);
+
+    /** Decompress data produced by compress_tag().
+     *
+     *  The LZ4 and Zstandard codecs need all the compressed data at once.
+     *  With zlib, decompress_start() and decompress_chunk() can be used to
+     *  decompress it a piece at a time instead.
+     *
+     *  @param p	The compressed data.
+     *  @param len	The length of the compressed data.
+     *  @param output	String to decompress into.
+     */
+    void decompress_tag(const char * p, size_t len,
+			std::string & output) const;
+
+  private:
+    /// Throw a suitable exception for zlib error @a err from inflate().
+    XAPIAN_NORETURN(void inflate_error(int err) const);
 };
 
 #endif // XAPIAN_INCLUDED_COMPRESSION_STREAM_H
@@ -31,6 +31,11 @@
 
 #include <xapian/error.h>
 
+// See the comment in brass_table.cc for why we do this.
+#if defined HAVE_PWRITE && defined PWRITE_PROTOTYPE
+PWRITE_PROTOTYPE
+#endif
+
 bool
 io_unlink(const std::string & filename)
 {
@@ -78,3 +83,24 @@ io_write(int fd, const char * p, size_t n)
 	n -= c;
     }
 }
+
+void
+io_write_at(int fd, const char * p, size_t n, off_t o)
+{
+#ifdef HAVE_PWRITE
+    while (n) {
+	ssize_t c = pwrite(fd, p, n, o);
+	if (c < 0) {
+	    if (errno == EINTR) continue;
+	    throw Xapian::DatabaseError("Error writing to file", errno);
+	}
+	p += c;
+	n -= c;
+	o += c;
+    }
+#else
+    if (lseek(fd, o, SEEK_SET) == -1)
+	throw Xapian::DatabaseError("Error seeking in file", errno);
+    io_write(fd, p, n);
+#endif
+}
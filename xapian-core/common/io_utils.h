@@ -62,6 +62,21 @@ inline bool io_sync(int fd)
 #endif
 }
 
+/** Start writing data previously written to file descriptor fd to disk.
+ *
+ *  This doesn't wait for the data to reach the disk, but means a later
+ *  io_sync() on fd has less to wait for, so the writes for several files can
+ *  proceed in parallel.  If this isn't supported, it does nothing.
+ */
+inline void io_start_sync(int fd)
+{
+#ifdef HAVE_SYNC_FILE_RANGE
+    (void)sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+#else
+    (void)fd;
+#endif
+}
+
 /** Read n bytes (or until EOF) into block pointed to by p from file descriptor
  *  fd.
  *
@@ -74,6 +89,13 @@ size_t io_read(int fd, char * p, size_t n, size_t min);
 /** Write n bytes from block pointed to by p to file descriptor fd. */
 void io_write(int fd, const char * p, size_t n);
 
+/** Write n bytes from block pointed to by p to file descriptor fd at offset o.
+ *
+ *  Uses pwrite() if available, which avoids a separate lseek() call.  The
+ *  file position of fd may or may not be changed.
+ */
+void io_write_at(int fd, const char * p, size_t n, off_t o);
+
 /** Delete a file.
  *
  *  @param	filename	The file to delete.
@@ -0,0 +1,84 @@
+/** @file mutex.h
+ * @brief Portable mutex for protecting process-wide state.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MUTEX_H
+#define XAPIAN_INCLUDED_MUTEX_H
+
+#ifdef __WIN32__
+# include "safewindows.h"
+#elif defined HAVE_PTHREAD_MUTEX
+# include <pthread.h>
+#endif
+
+/** A mutex, for state shared between different objects in a process.
+ *
+ *  Xapian objects aren't thread-safe, but different objects may be used
+ *  concurrently from different threads, so any state they share needs to be
+ *  protected.  If we don't have a mutex implementation, we assume there are
+ *  no threads and this does nothing.
+ */
+class Mutex {
+    /// Don't allow assignment.
+    void operator=(const Mutex &);
+
+    /// Don't allow copying.
+    Mutex(const Mutex &);
+
+#ifdef __WIN32__
+    CRITICAL_SECTION cs;
+
+  public:
+    Mutex() { InitializeCriticalSection(&cs); }
+    ~Mutex() { DeleteCriticalSection(&cs); }
+    void lock() { EnterCriticalSection(&cs); }
+    void unlock() { LeaveCriticalSection(&cs); }
+#elif defined HAVE_PTHREAD_MUTEX
+    pthread_mutex_t m;
+
+  public:
+    Mutex() { (void)pthread_mutex_init(&m, NULL); }
+    ~Mutex() { (void)pthread_mutex_destroy(&m); }
+    void lock() { (void)pthread_mutex_lock(&m); }
+    void unlock() { (void)pthread_mutex_unlock(&m); }
+#else
+  public:
+    Mutex() { }
+    void lock() { }
+    void unlock() { }
+#endif
+};
+
+/// Hold a Mutex for the lifetime of this object.
+class MutexLock {
+    /// Don't allow assignment.
+    void operator=(const MutexLock &);
+
+    /// Don't allow copying.
+    MutexLock(const MutexLock &);
+
+    Mutex & mutex;
+
+  public:
+    explicit MutexLock(Mutex & mutex_) : mutex(mutex_) { mutex.lock(); }
+    ~MutexLock() { mutex.unlock(); }
+};
+
+#endif // XAPIAN_INCLUDED_MUTEX_H
@@ -48,8 +48,12 @@
 // 36: 1.3.0 REPLY_UPDATE and REPLY_GREETING merged, and more...
 // 37: 1.3.1 Prefix-compress termlists.
 // 38: 1.3.2 Stats serialisation now includes collection freq, and more...
-#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 38
-#define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 0
+// 38.1: New MSG_FREQS returns termfreq and collection freq together.
+// 39: 1.3.2 MSG_QUERY passes a continuation token; MSets include sort keys;
+//     replies for postlists, termlists, etc contain batches of entries.
+// 39.1: MSG_UPDATE reopens a read-only database first.
+#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 39
+#define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 1
 
 /** Message types (client -> server).
  *
@@ -86,6 +90,7 @@ enum message_type {
     MSG_GETMSET,		// Get MSet
     MSG_SHUTDOWN,		// Shutdown
     MSG_METADATAKEYLIST,	// Iterator for metadata keys
+    MSG_FREQS,			// Get termfreq and collfreq
     MSG_MAX
 };
 
@@ -112,6 +117,7 @@ enum reply_type {
     REPLY_RESULTS,		// Results (MSet)
     REPLY_METADATA,		// Metadata
     REPLY_METADATAKEYLIST,	// Iterator for metadata keys
+    REPLY_FREQS,		// Get termfreq and collfreq
     REPLY_MAX
 };
 
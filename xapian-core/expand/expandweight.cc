@@ -40,7 +40,7 @@ ExpandWeight::get_weight(TermList * merger, const string & term) const
     LOGCALL(MATCH, double, "ExpandWeight::get_weight", merger | term);
 
     // Accumulate the stats for this term across all relevant documents.
-    ExpandStats stats(avlen, expand_k);
+    stats.clear();
     merger->accumulate_stats(stats);
 
     double termfreq = stats.termfreq;
@@ -25,6 +25,7 @@
 
 #include "api/termlist.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -63,8 +64,18 @@ class ExpandStats {
 	  dbsize(0), termfreq(0), multiplier(0), rtermfreq(0), db_index(0) {
     }
 
+    /** Accumulate the stats for a relevant document indexed by the term.
+     *
+     *  @param wdf	The wdf of the term in the document.
+     *  @param doclen	The length of the document.
+     *  @param tl	The termlist for the document, positioned on the term.
+     *			Its get_termfreq() method is only called the first time
+     *			each sub-database is seen for a term, since looking up
+     *			the termfreq can be expensive.
+     *  @param subdbsize	The number of documents in the sub-database.
+     */
     void accumulate(Xapian::termcount wdf, Xapian::termcount doclen,
-		    Xapian::doccount subtf, Xapian::doccount subdbsize) {
+		    const TermList & tl, Xapian::doccount subdbsize) {
 	// Boolean terms may have wdf == 0, but treat that as 1 so such terms
 	// get a non-zero weight.
 	if (wdf == 0) wdf = 1;
@@ -78,9 +89,19 @@ class ExpandStats {
 	    if (db_index >= dbs_seen.size()) dbs_seen.resize(db_index + 1);
 	    dbs_seen[db_index] = true;
 	    dbsize += subdbsize;
-	    termfreq += subtf;
+	    termfreq += tl.get_termfreq();
 	}
     }
+
+    /// Reset to start accumulating the stats for another term.
+    void clear() {
+	std::fill(dbs_seen.begin(), dbs_seen.end(), false);
+	dbsize = 0;
+	termfreq = 0;
+	multiplier = 0;
+	rtermfreq = 0;
+	db_index = 0;
+    }
 };
 
 /// Class for calculating probabilistic ESet term weights.
@@ -112,6 +133,13 @@ class ExpandWeight {
     /// Parameter k in the probabilistic expand weighting formula.
     double expand_k;
 
+    /** The stats for the current term.
+     *
+     *  We reuse this object for each term to avoid reallocating its
+     *  record of which sub-databases have been seen.
+     */
+    mutable ExpandStats stats;
+
 public:
     /** Constructor.
      *
@@ -129,7 +157,7 @@ public:
 		 double expand_k_)
 	: db(db_), dbsize(db.get_doccount()), avlen(db.get_avlength()),
 	  rsize(rsize_), use_exact_termfreq(use_exact_termfreq_),
-	  expand_k(expand_k_) { }
+	  expand_k(expand_k_), stats(avlen, expand_k) { }
 
     /** Get the expand weight.
      *
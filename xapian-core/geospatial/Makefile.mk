@@ -3,10 +3,13 @@ EXTRA_DIST += \
 	geospatial/Makefile
 
 noinst_HEADERS +=\
-	geospatial/geoencode.h
+	geospatial/geoencode.h \
+	geospatial/geohash.h \
+	geospatial/greatcircle.h
 
 lib_src += \
 	geospatial/geoencode.cc \
+	geospatial/geohash.cc \
 	geospatial/latlongcoord.cc \
 	geospatial/latlong_distance_keymaker.cc \
 	geospatial/latlong_metrics.cc \
@@ -0,0 +1,209 @@
+/** @file geohash.cc
+ * @brief Geohash cells, for finding coordinates near a point quickly.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "geohash.h"
+
+#include "xapian/document.h"
+#include "xapian/geospatial.h"
+
+#include "omassert.h"
+
+#include <cmath>
+
+using namespace std;
+
+/** Set M_PI if it's not already set.
+ */
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/// The characters used to encode each 5 bits of a geohash.
+static const char base32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+/** The most cells GeoHash::cover() will return for each circle.
+ *
+ *  Allowing more cells would mean a closer fit to the circle (so fewer
+ *  documents which are out of range are considered), but more postings
+ *  lists to merge.
+ */
+const unsigned MAX_CELLS = 16;
+
+/// The number of bits of latitude in a geohash of length @a length.
+inline unsigned
+lat_bits(unsigned length)
+{
+    return length * 5 / 2;
+}
+
+/// The number of bits of longitude in a geohash of length @a length.
+inline unsigned
+lon_bits(unsigned length)
+{
+    return (length * 5 + 1) / 2;
+}
+
+/// Return the row of the cell containing latitude @a lat.
+static unsigned
+lat_cell(double lat, unsigned bits)
+{
+    unsigned n = 1u << bits;
+    double i = floor((lat + 90.0) * (1.0 / 180.0) * n);
+    if (i < 0) return 0;
+    if (i >= n) return n - 1;
+    return unsigned(i);
+}
+
+/** Return the column of the cell containing longitude @a lon.
+ *
+ *  @a lon should be in the range -540 <= lon < 540, and the column returned
+ *  isn't wrapped, so may be negative or too large by up to a turn.
+ */
+static long
+lon_cell(double lon, unsigned bits)
+{
+    return long(floor((lon + 180.0) * (1.0 / 360.0) * (1ul << bits)));
+}
+
+/// Wrap @a lon into the range -180 <= lon < 180.
+static double
+wrap_longitude(double lon)
+{
+    lon = fmod(lon, 360.0);
+    if (lon < -180.0) {
+	lon += 360.0;
+    } else if (lon >= 180.0) {
+	lon -= 360.0;
+    }
+    return lon;
+}
+
+/// Append the geohash of the cell in row @a lat_i and column @a lon_i.
+static void
+append_cell(unsigned lat_i, unsigned lon_i, unsigned length, string & result)
+{
+    unsigned lat_b = lat_bits(length);
+    unsigned lon_b = lon_bits(length);
+    unsigned ch = 0;
+    for (unsigned b = 0; b != length * 5; ++b) {
+	// Bits of longitude and latitude alternate, starting with longitude.
+	if (b % 2 == 0) {
+	    ch = (ch << 1) | ((lon_i >> --lon_b) & 1);
+	} else {
+	    ch = (ch << 1) | ((lat_i >> --lat_b) & 1);
+	}
+	if (b % 5 == 4) {
+	    result += base32[ch];
+	    ch = 0;
+	}
+    }
+}
+
+void
+GeoHash::encode(double lat, double lon, unsigned length, string & result)
+{
+    AssertRel(length,<=,MAX_LENGTH);
+    lon = wrap_longitude(lon);
+    unsigned lon_n = 1u << lon_bits(length);
+    long lon_i = lon_cell(lon, lon_bits(length));
+    if (lon_i >= long(lon_n)) lon_i = lon_n - 1;
+    append_cell(lat_cell(lat, lat_bits(length)), unsigned(lon_i), length,
+		result);
+}
+
+bool
+GeoHash::cover(double lat, double lon, double angle, vector<string> & cells)
+{
+    if (angle >= M_PI) return false;
+
+    // Find the bounding box of the circle.
+    double dlat = angle * (180.0 / M_PI);
+    double lat_lo = lat - dlat;
+    double lat_hi = lat + dlat;
+    double lon_lo = 0, lon_hi = 0;
+    bool all_lon = true;
+    if (lat_lo > -90.0 && lat_hi < 90.0) {
+	// The circle doesn't contain a pole, so its extent in longitude is
+	// limited.  The widest point isn't at the latitude of the centre, but
+	// the extent there is given by asin(sin(angle) / cos(lat)).
+	double s = sin(angle) / cos(lat * (M_PI / 180.0));
+	if (s < 1.0) {
+	    double dlon = asin(s) * (180.0 / M_PI);
+	    lon = wrap_longitude(lon);
+	    lon_lo = lon - dlon;
+	    lon_hi = lon + dlon;
+	    all_lon = false;
+	}
+    }
+
+    for (unsigned length = MAX_LENGTH; length > 0; --length) {
+	unsigned lat_i0 = lat_cell(lat_lo, lat_bits(length));
+	unsigned lat_i1 = lat_cell(lat_hi, lat_bits(length));
+	unsigned long lon_n = 1ul << lon_bits(length);
+	long lon_i0 = 0;
+	unsigned long n_lon = lon_n;
+	if (!all_lon) {
+	    lon_i0 = lon_cell(lon_lo, lon_bits(length));
+	    n_lon = lon_cell(lon_hi, lon_bits(length)) - lon_i0 + 1;
+	    if (n_lon > lon_n) n_lon = lon_n;
+	}
+	double n_cells = double(lat_i1 - lat_i0 + 1) * n_lon;
+	if (n_cells > MAX_CELLS) continue;
+
+	for (unsigned lat_i = lat_i0; lat_i <= lat_i1; ++lat_i) {
+	    for (unsigned long j = 0; j != n_lon; ++j) {
+		// Wrap around the antimeridian.
+		long lon_i = (lon_i0 + long(j)) % long(lon_n);
+		if (lon_i < 0) lon_i += lon_n;
+		string cell;
+		append_cell(lat_i, unsigned(lon_i), length, cell);
+		cells.push_back(cell);
+	    }
+	}
+	return true;
+    }
+
+    // Even single character geohashes would need too many cells, so the
+    // circle must cover a large part of the sphere.
+    return false;
+}
+
+void
+Xapian::index_latlong_cells(Xapian::Document & doc,
+			    const LatLongCoords & coords,
+			    const string & prefix)
+{
+    for (LatLongCoordsIterator i = coords.begin(); i != coords.end(); ++i) {
+	// Use the coordinate as it will be after storing in a value slot, so
+	// a coordinate on the edge of a cell is always indexed in the cell
+	// LatLongDistancePostingSource will look for it in.
+	LatLongCoord coord;
+	coord.unserialise((*i).serialise());
+	string term(prefix);
+	GeoHash::encode(coord.latitude, coord.longitude, GeoHash::MAX_LENGTH,
+			term);
+	for (size_t len = prefix.size() + 1; len <= term.size(); ++len) {
+	    doc.add_boolean_term(term.substr(0, len));
+	}
+    }
+}
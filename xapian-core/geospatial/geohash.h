@@ -0,0 +1,69 @@
+/** @file geohash.h
+ * @brief Geohash cells, for finding coordinates near a point quickly.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_GEOHASH_H
+#define XAPIAN_INCLUDED_GEOHASH_H
+
+#include <string>
+#include <vector>
+
+namespace GeoHash {
+
+/** The length of the longest geohashes we use.
+ *
+ *  A geohash of this length identifies a cell about 38m by 19m at the equator.
+ */
+const unsigned MAX_LENGTH = 8;
+
+/** Encode a coordinate as a geohash and append it to a string.
+ *
+ *  The geohash of a given length is a prefix of the geohash of any greater
+ *  length for the same coordinate, so each prefix identifies a larger cell
+ *  containing the coordinate.
+ *
+ *  @param lat	The latitude in degrees (from -90 to +90).
+ *  @param lon	The longitude in degrees (any range is valid - longitudes will
+ *		be wrapped).
+ *  @param length	The number of characters to append (at most MAX_LENGTH).
+ *  @param result	The string to append the geohash to.
+ */
+void encode(double lat, double lon, unsigned length, std::string & result);
+
+/** Find geohash cells which cover a circle on the surface of a sphere.
+ *
+ *  The cells are all the same length, which is the longest for which the
+ *  circle's bounding box can be covered by a small number of cells.
+ *
+ *  @param lat	The latitude of the centre in degrees.
+ *  @param lon	The longitude of the centre in degrees.
+ *  @param angle	The radius of the circle, as the angle it subtends at the
+ *			centre of the sphere, in radians.
+ *  @param cells	The geohashes of the cells are appended to this.
+ *
+ *  @return false if the circle covers so much of the sphere that restricting
+ *	    to cells isn't useful, in which case @a cells is unchanged.
+ */
+bool cover(double lat, double lon, double angle,
+	   std::vector<std::string> & cells);
+
+}
+
+#endif // XAPIAN_INCLUDED_GEOHASH_H
@@ -0,0 +1,89 @@
+/** @file greatcircle.h
+ * @brief Calculate great-circle distances from a fixed centre efficiently.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_GREATCIRCLE_H
+#define XAPIAN_INCLUDED_GREATCIRCLE_H
+
+#include "xapian/geospatial.h"
+
+#include <string>
+#include <vector>
+
+namespace GreatCircle {
+
+/** Calculate the great-circle distance between two points.
+ *
+ *  @param radius	The radius of the sphere.
+ *  @param a		The first point.
+ *  @param cos_lat_a	cos() of the latitude of @a a in radians, which a
+ *			caller measuring from a fixed point can calculate
+ *			just once.
+ *  @param b		The second point.
+ */
+double distance(double radius,
+		const Xapian::LatLongCoord & a, double cos_lat_a,
+		const Xapian::LatLongCoord & b);
+
+/** Check if @a metric is exactly a GreatCircleMetric.
+ *
+ *  A subclass might calculate distances differently, so isn't accepted.
+ *
+ *  @param radius	Set to the radius of @a metric if it is a
+ *			GreatCircleMetric.
+ */
+bool get_radius(const Xapian::LatLongMetric & metric, double & radius);
+
+/** Prepare to calculate distances from @a centre using @a metric.
+ *
+ *  If get_radius() accepts @a metric, @a radius is set to its radius and
+ *  @a cos_lat to cos() of the latitude of each point in @a centre, ready to
+ *  pass to min_distance().  Otherwise @a cos_lat is cleared, and distances
+ *  need to be calculated by calling @a metric.
+ */
+void init(const Xapian::LatLongMetric & metric,
+	  const Xapian::LatLongCoords & centre,
+	  double & radius, std::vector<double> & cos_lat);
+
+/** Return the distance between the closest pair of points from @a centre and
+ *  the coordinates serialised in @a value.
+ *
+ *  This gives the same result as GreatCircleMetric(radius)(centre, value).
+ *
+ *  @param cos_lat	The cosines set up by init().
+ */
+double min_distance(double radius,
+		    const Xapian::LatLongCoords & centre,
+		    const std::vector<double> & cos_lat,
+		    const std::string & value);
+
+/** Return the distance between the closest pair of points from @a centre and
+ *  the coordinates serialised in @a value.
+ *
+ *  This is like the version above, but works out cos() of the latitude of
+ *  each point in @a centre itself, once per call.
+ */
+double min_distance(double radius,
+		    const Xapian::LatLongCoords & centre,
+		    const std::string & value);
+
+}
+
+#endif // XAPIAN_INCLUDED_GREATCIRCLE_H
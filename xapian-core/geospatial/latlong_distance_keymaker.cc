@@ -27,6 +27,8 @@
 #include "xapian/document.h"
 #include "xapian/queryparser.h" // For sortable_serialise.
 
+#include "greatcircle.h"
+
 using namespace Xapian;
 using namespace std;
 
@@ -37,9 +39,15 @@ LatLongDistanceKeyMaker::operator()(const Document &doc) const
     if (val.empty()) {
 	return defkey;
     }
-    LatLongCoords doccoords;
-    doccoords.unserialise(val);
-    double distance = (*metric)(centre, doccoords);
+    // Calculate the distance from the serialised form, which avoids
+    // building a LatLongCoords object for every document.
+    double distance;
+    double radius;
+    if (GreatCircle::get_radius(*metric, radius)) {
+	distance = GreatCircle::min_distance(radius, centre, val);
+    } else {
+	distance = (*metric)(centre, val);
+    }
     return sortable_serialise(distance);
 }
 
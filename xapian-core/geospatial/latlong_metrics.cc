@@ -24,9 +24,11 @@
 
 #include "xapian/geospatial.h"
 #include "xapian/error.h"
+#include "greatcircle.h"
 #include "serialise-double.h"
 
 #include <cmath>
+#include <typeinfo>
 
 using namespace Xapian;
 using namespace std;
@@ -116,21 +118,8 @@ double
 GreatCircleMetric::pointwise_distance(const LatLongCoord & a,
 				      const LatLongCoord & b) const
 {
-    double lata = a.latitude * (M_PI / 180.0);
-    double latb = b.latitude * (M_PI / 180.0);
-
-    double latdiff = lata - latb;
-    double longdiff = (a.longitude - b.longitude) * (M_PI / 180.0);
-
-    double sin_half_lat = sin(latdiff / 2);
-    double sin_half_long = sin(longdiff / 2);
-    double h = sin_half_lat * sin_half_lat +
-	    sin_half_long * sin_half_long * cos(lata) * cos(latb);
-    if (rare(h > 1.0)) {
-	// Clamp to 1.0, asin(1.0) = M_PI / 2.0.
-	return radius * M_PI;
-    }
-    return 2 * radius * asin(sqrt(h));
+    return GreatCircle::distance(radius, a, cos(a.latitude * (M_PI / 180.0)),
+				 b);
 }
 
 LatLongMetric *
@@ -164,3 +153,114 @@ GreatCircleMetric::unserialise(const string & s) const
 
     return new GreatCircleMetric(new_radius);
 }
+
+double
+GreatCircle::distance(double radius,
+		      const LatLongCoord & a, double cos_lat_a,
+		      const LatLongCoord & b)
+{
+    double lata = a.latitude * (M_PI / 180.0);
+    double latb = b.latitude * (M_PI / 180.0);
+
+    double latdiff = lata - latb;
+    double longdiff = (a.longitude - b.longitude) * (M_PI / 180.0);
+
+    double sin_half_lat = sin(latdiff / 2);
+    double sin_half_long = sin(longdiff / 2);
+    double h = sin_half_lat * sin_half_lat +
+	    sin_half_long * sin_half_long * cos_lat_a * cos(latb);
+    if (rare(h > 1.0)) {
+	// Clamp to 1.0, asin(1.0) = M_PI / 2.0.
+	return radius * M_PI;
+    }
+    return 2 * radius * asin(sqrt(h));
+}
+
+bool
+GreatCircle::get_radius(const LatLongMetric & metric, double & radius)
+{
+    if (typeid(metric) != typeid(GreatCircleMetric)) return false;
+
+    // The serialised form of a GreatCircleMetric is just its radius.
+    string s = metric.serialise();
+    const char * p = s.data();
+    radius = unserialise_double(&p, p + s.size());
+    return true;
+}
+
+void
+GreatCircle::init(const LatLongMetric & metric, const LatLongCoords & centre,
+		  double & radius, vector<double> & cos_lat)
+{
+    cos_lat.clear();
+    if (!get_radius(metric, radius)) return;
+
+    cos_lat.reserve(centre.size());
+    for (LatLongCoordsIterator i = centre.begin(); i != centre.end(); ++i) {
+	cos_lat.push_back(cos((*i).latitude * (M_PI / 180.0)));
+    }
+}
+
+double
+GreatCircle::min_distance(double radius, const LatLongCoords & centre,
+			  const vector<double> & cos_lat, const string & value)
+{
+    // This follows LatLongMetric::operator()(), but uses the cosines of the
+    // centre latitudes which were calculated up front.
+    if (centre.empty() || value.empty()) {
+	throw InvalidArgumentError("Empty coordinate list supplied to LatLongMetric::operator()().");
+    }
+    double min_dist = 0.0;
+    bool have_min = false;
+    LatLongCoord b;
+    const char * b_ptr = value.data();
+    const char * b_end = b_ptr + value.size();
+    while (b_ptr != b_end) {
+	b.unserialise(&b_ptr, b_end);
+	vector<double>::const_iterator c = cos_lat.begin();
+	for (LatLongCoordsIterator a_iter = centre.begin();
+	     a_iter != centre.end();
+	     ++a_iter, ++c)
+	{
+	    double dist = distance(radius, *a_iter, *c, b);
+	    if (!have_min) {
+		min_dist = dist;
+		have_min = true;
+	    } else if (dist < min_dist) {
+		min_dist = dist;
+	    }
+	}
+    }
+    return min_dist;
+}
+
+double
+GreatCircle::min_distance(double radius, const LatLongCoords & centre,
+			  const string & value)
+{
+    if (centre.empty() || value.empty()) {
+	throw InvalidArgumentError("Empty coordinate list supplied to LatLongMetric::operator()().");
+    }
+    double min_dist = 0.0;
+    bool have_min = false;
+    LatLongCoord b;
+    const char * value_end = value.data() + value.size();
+    for (LatLongCoordsIterator a_iter = centre.begin();
+	 a_iter != centre.end();
+	 ++a_iter)
+    {
+	double cos_lat_a = cos((*a_iter).latitude * (M_PI / 180.0));
+	const char * b_ptr = value.data();
+	while (b_ptr != value_end) {
+	    b.unserialise(&b_ptr, value_end);
+	    double dist = distance(radius, *a_iter, cos_lat_a, b);
+	    if (!have_min) {
+		min_dist = dist;
+		have_min = true;
+	    } else if (dist < min_dist) {
+		min_dist = dist;
+	    }
+	}
+    }
+    return min_dist;
+}
@@ -28,26 +28,112 @@
 #include "xapian/error.h"
 #include "xapian/registry.h"
 
+#include "geohash.h"
+#include "greatcircle.h"
 #include "net/length.h"
 #include "net/serialise.h"
 #include "serialise-double.h"
 #include "str.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace Xapian;
 using namespace std;
 
+/** Set M_PI if it's not already set.
+ */
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 static double
 weight_from_distance(double dist, double k1, double k2)
 {
     return k1 * pow(dist + k1, -k2);
 }
 
+/// State of LatLongDistancePostingSource which isn't part of the ABI.
+class LatLongDistancePostingSource::Internal {
+  public:
+    /// Prefix of geohash cell terms to use, or empty to not use them.
+    string cell_prefix;
+
+    /// Are we only considering documents in cell_postings?
+    bool use_cells;
+
+    /// Postings for the cells which might contain documents within range.
+    vector<PostingIterator> cell_postings;
+
+    /** cos() of the latitude of each point in centre if metric is a
+     *  GreatCircleMetric, or empty if it isn't.
+     *
+     *  These are calculated once so they don't need to be for every document.
+     */
+    vector<double> cos_centre_latitudes;
+
+    /// The radius of metric, if it's a GreatCircleMetric.
+    double radius;
+
+    Internal() : use_cells(false), radius(0.0) { }
+
+    /** Find the lowest docid >= @a did in any of cell_postings.
+     *
+     *  @return The docid, or 0 if there aren't any more.
+     */
+    Xapian::docid next_cell_docid(Xapian::docid did);
+};
+
+Xapian::docid
+LatLongDistancePostingSource::Internal::next_cell_docid(Xapian::docid did)
+{
+    Xapian::docid result = 0;
+    vector<PostingIterator>::iterator i = cell_postings.begin();
+    while (i != cell_postings.end()) {
+	i->skip_to(did);
+	if (*i == PostingIterator()) {
+	    i = cell_postings.erase(i);
+	    continue;
+	}
+	if (result == 0 || **i < result) result = **i;
+	++i;
+    }
+    return result;
+}
+
 void
 LatLongDistancePostingSource::calc_distance()
 {
-    dist = (*metric)(centre, *value_it);
+    if (!internal->cos_centre_latitudes.empty()) {
+	dist = GreatCircle::min_distance(internal->radius, centre,
+					 internal->cos_centre_latitudes,
+					 *value_it);
+    } else {
+	dist = (*metric)(centre, *value_it);
+    }
+}
+
+void
+LatLongDistancePostingSource::find_in_range()
+{
+    while (value_it != db.valuestream_end(slot)) {
+	if (internal->use_cells) {
+	    // Skip documents which aren't in any of the cells.
+	    docid did = internal->next_cell_docid(value_it.get_docid());
+	    if (did == 0) {
+		value_it = db.valuestream_end(slot);
+		break;
+	    }
+	    if (did != value_it.get_docid()) {
+		value_it.skip_to(did);
+		continue;
+	    }
+	}
+	calc_distance();
+	if (max_range == 0 || dist <= max_range)
+	    break;
+	++value_it;
+    }
 }
 
 /// Validate the parameters supplied to LatLongDistancePostingSource.
@@ -79,10 +165,13 @@ LatLongDistancePostingSource::LatLongDistancePostingSource(
 	  metric(metric_),
 	  max_range(max_range_),
 	  k1(k1_),
-	  k2(k2_)
+	  k2(k2_),
+	  internal(new Internal)
 {
     validate_postingsource_params(k1, k2);
     set_maxweight(weight_from_distance(0, k1, k2));
+    GreatCircle::init(*metric, centre, internal->radius,
+		      internal->cos_centre_latitudes);
 }
 
 LatLongDistancePostingSource::LatLongDistancePostingSource(
@@ -97,28 +186,32 @@ LatLongDistancePostingSource::LatLongDistancePostingSource(
 	  metric(metric_.clone()),
 	  max_range(max_range_),
 	  k1(k1_),
-	  k2(k2_)
+	  k2(k2_),
+	  internal(new Internal)
 {
     validate_postingsource_params(k1, k2);
     set_maxweight(weight_from_distance(0, k1, k2));
+    GreatCircle::init(*metric, centre, internal->radius,
+		      internal->cos_centre_latitudes);
 }
 
 LatLongDistancePostingSource::~LatLongDistancePostingSource()
 {
     delete metric;
+    delete internal;
+}
+
+void
+LatLongDistancePostingSource::set_cell_prefix(const string & prefix)
+{
+    internal->cell_prefix = prefix;
 }
 
 void
 LatLongDistancePostingSource::next(double min_wt)
 {
     ValuePostingSource::next(min_wt);
-
-    while (value_it != db.valuestream_end(slot)) {
-	calc_distance();
-	if (max_range == 0 || dist <= max_range)
-	    break;
-	++value_it;
-    }
+    find_in_range();
 }
 
 void
@@ -126,19 +219,18 @@ LatLongDistancePostingSource::skip_to(docid min_docid,
 				      double min_wt)
 {
     ValuePostingSource::skip_to(min_docid, min_wt);
-
-    while (value_it != db.valuestream_end(slot)) {
-	calc_distance();
-	if (max_range == 0 || dist <= max_range)
-	    break;
-	++value_it;
-    }
+    find_in_range();
 }
 
 bool
 LatLongDistancePostingSource::check(docid min_docid,
 				    double min_wt)
 {
+    if (internal->use_cells) {
+	// Checking the cells is no cheaper than advancing through them.
+	skip_to(min_docid, min_wt);
+	return true;
+    }
     if (!ValuePostingSource::check(min_docid, min_wt)) {
 	// check returned false, so we know the document is not in the source.
 	return false;
@@ -164,9 +256,11 @@ LatLongDistancePostingSource::get_weight() const
 LatLongDistancePostingSource *
 LatLongDistancePostingSource::clone() const
 {
-    return new LatLongDistancePostingSource(slot, centre,
-					    metric->clone(),
-					    max_range, k1, k2);
+    LatLongDistancePostingSource * res =
+	new LatLongDistancePostingSource(slot, centre, metric->clone(),
+					 max_range, k1, k2);
+    res->set_cell_prefix(internal->cell_prefix);
+    return res;
 }
 
 string
@@ -192,6 +286,11 @@ LatLongDistancePostingSource::serialise() const
     result += serialise_double(max_range);
     result += serialise_double(k1);
     result += serialise_double(k2);
+    const string & cell_prefix = internal->cell_prefix;
+    if (!cell_prefix.empty()) {
+	result += encode_length(cell_prefix.size());
+	result += cell_prefix;
+    }
     return result;
 }
 
@@ -215,6 +314,12 @@ LatLongDistancePostingSource::unserialise_with_registry(const string &s,
     double new_max_range = unserialise_double(&p, end);
     double new_k1 = unserialise_double(&p, end);
     double new_k2 = unserialise_double(&p, end);
+    string new_cell_prefix;
+    if (p != end) {
+	len = decode_length(&p, end, true);
+	new_cell_prefix.assign(p, len);
+	p += len;
+    }
     if (p != end) {
 	throw NetworkError("Bad serialised LatLongDistancePostingSource - junk at end");
     }
@@ -233,9 +338,11 @@ LatLongDistancePostingSource::unserialise_with_registry(const string &s,
     LatLongMetric * new_metric =
 	    metric_type->unserialise(new_serialised_metric);
 
-    return new LatLongDistancePostingSource(new_slot, new_centre,
-					    new_metric,
-					    new_max_range, new_k1, new_k2);
+    LatLongDistancePostingSource * res =
+	new LatLongDistancePostingSource(new_slot, new_centre, new_metric,
+					 new_max_range, new_k1, new_k2);
+    res->set_cell_prefix(new_cell_prefix);
+    return res;
 }
 
 void
@@ -249,6 +356,45 @@ LatLongDistancePostingSource::init(const Database & db_)
 	// I can't think of anything we can do with the information
 	// available.
     }
+
+    internal->use_cells = false;
+    internal->cell_postings.clear();
+    const string & cell_prefix = internal->cell_prefix;
+    if (max_range <= 0.0 || cell_prefix.empty()) return;
+
+    // Find the radius of the sphere the metric measures distances on by
+    // measuring a degree, so we can convert max_range to an angle.  The small
+    // allowance is so rounding errors can't exclude anything within range.
+    double sphere_radius = metric->pointwise_distance(LatLongCoord(0, 0),
+						      LatLongCoord(0, 1));
+    sphere_radius *= 180.0 / M_PI;
+    double angle = max_range / sphere_radius * 1.000001;
+
+    vector<string> cells;
+    for (LatLongCoordsIterator i = centre.begin(); i != centre.end(); ++i) {
+	if (!GeoHash::cover((*i).latitude, (*i).longitude, angle, cells)) {
+	    // Restricting to cells wouldn't help.
+	    return;
+	}
+    }
+    sort(cells.begin(), cells.end());
+    cells.erase(unique(cells.begin(), cells.end()), cells.end());
+
+    internal->use_cells = true;
+    Xapian::doccount cell_freq = 0;
+    vector<string>::const_iterator c;
+    for (c = cells.begin(); c != cells.end(); ++c) {
+	string term = cell_prefix;
+	term += *c;
+	PostingIterator p = db.postlist_begin(term);
+	if (p == db.postlist_end(term)) continue;
+	internal->cell_postings.push_back(p);
+	cell_freq += db.get_termfreq(term);
+    }
+    if (cell_freq < termfreq_max) {
+	termfreq_max = cell_freq;
+	if (termfreq_est > termfreq_max) termfreq_est = termfreq_max;
+    }
 }
 
 string
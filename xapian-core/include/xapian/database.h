@@ -625,6 +625,12 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
 	 *  you can improve indexing throughput dramatically by setting
 	 *  XAPIAN_FLUSH_THRESHOLD in the environment to a larger value.
 	 *
+	 *  With the brass backend, you can instead set XAPIAN_FLUSH_MEMORY to
+	 *  the approximate amount of memory to use for buffering changes (in
+	 *  bytes, or with a K, M or G suffix).  If only XAPIAN_FLUSH_MEMORY is
+	 *  set, the number of modifications is ignored; if both are set, the
+	 *  changes are flushed when either limit is reached.
+	 *
 	 *  This method was new in Xapian 1.1.0 - in earlier versions it was
 	 *  called flush().
 	 *
@@ -1026,6 +1032,18 @@ const int DBCHECK_SHOW_STATS = 8;
  */
 const int DBCHECK_FIX = 16;
 
+/** Use a bounded amount of memory for cross-checks between tables.
+ *
+ *  Currently this is supported for brass, and means that document lengths
+ *  are cross-checked between the postlist and termlist tables by reading the
+ *  termlist table a second time, rather than by holding the length of every
+ *  document in memory (which needs 4 bytes per document).  This is done
+ *  anyway if there isn't enough memory to hold them.
+ *
+ *  For use with Xapian::Database::check().
+ */
+const int DBCHECK_LOW_MEMORY = 32;
+
 }
 
 #endif /* XAPIAN_INCLUDED_DATABASE_H */
@@ -31,6 +31,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 #include <xapian/attributes.h>
 #include <xapian/intrusive_ptr.h>
@@ -212,6 +213,22 @@ class XAPIAN_VISIBILITY_DEFAULT MSet {
 	 */
 	double get_max_attained() const;
 
+	/** Get a token for continuing after the last item in this MSet.
+	 *
+	 *  Passing this token to Enquire::set_continuation() allows the
+	 *  next page of results to be fetched by calling
+	 *  Enquire::get_mset(0, maxitems), which needs much less work and
+	 *  memory than asking for a large value of first.
+	 *
+	 *  The token is an opaque string, which can be stored and passed to
+	 *  a different Enquire object (e.g. in a later request to a web
+	 *  application).  It is only meaningful for the same query and
+	 *  sort order as the MSet it came from.
+	 *
+	 *  @return	The token, or an empty string if this MSet is empty.
+	 */
+	std::string get_continuation() const;
+
 	/** The number of items in this MSet */
 	Xapian::doccount size() const;
 
@@ -964,6 +981,53 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
 	 */
 	void set_time_limit(double time_limit);
 
+	/** Only return items which rank after a continuation point.
+	 *
+	 *  After this has been called with a token from
+	 *  MSet::get_continuation(), get_mset() only considers items
+	 *  which rank after the last item of the MSet which the token came
+	 *  from, so get_mset(0, 10) returns the next 10 items.  Each page
+	 *  only needs to keep first + maxitems candidates, however deep into
+	 *  the results it is, and a forward boolean match in docid order
+	 *  (e.g. a query with OP_SCALE_WEIGHT by 0 and the default docid
+	 *  order) against a single local database with no match spies skips
+	 *  directly to the documents after the token, so a complete export
+	 *  can be made a page at a time in bounded memory.
+	 *
+	 *  The match statistics (e.g. get_matches_estimated()) still count
+	 *  the items ranking before the token, and match spies still see
+	 *  them.
+	 *
+	 *  Continuation tokens can't currently be used with collapsing (see
+	 *  set_collapse_key()) - get_mset() will throw
+	 *  Xapian::InvalidArgumentError if both are set.
+	 *
+	 *  @param token  A token from MSet::get_continuation(), or an empty
+	 *		  string to return to the default behaviour.
+	 *
+	 *  @exception Xapian::InvalidArgumentError if @a token isn't valid.
+	 */
+	void set_continuation(const std::string & token);
+
+	/** Prepare the current query for running several times.
+	 *
+	 *  This collates the term statistics which the current query needs
+	 *  from the database now, and keeps them so that subsequent calls to
+	 *  get_mset() with the same relevance set don't need to look them up
+	 *  again.  This is useful if the same query is run many times, for
+	 *  example to fetch successive pages of results.
+	 *
+	 *  The prepared statistics are discarded when set_query() is called,
+	 *  and when the database is modified or reopened.
+	 *
+	 *  If any of the databases is remote, the statistics can't be
+	 *  collated ahead of the match, so this method does nothing.
+	 *
+	 *  @param omrset    the relevance set which will be passed to
+	 *		     get_mset().
+	 */
+	void prepare_mset(const RSet * omrset = 0) const;
+
 	/** Get (a portion of) the match set for the current query.
 	 *
 	 *  @param first     the first item in the result set to return.
@@ -1013,6 +1077,51 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
 	}
 	/** @} */
 
+	/** Get match sets for several queries in one go.
+	 *
+	 *  This is equivalent to calling set_query() and get_mset() for each
+	 *  query in turn (the query set with set_query() is left unchanged),
+	 *  except that the term statistics needed by all the queries are
+	 *  collated in a single pass over each database, so a term which
+	 *  appears in several of the queries is only looked up once.  This
+	 *  can save a lot of work when running many queries against the same
+	 *  database, for example in a batch job.
+	 *
+	 *  The other settings of this Enquire object (weighting scheme,
+	 *  sorting, collapsing, cutoffs, match spies, etc) apply to every
+	 *  query.  Note that any MatchSpy objects will see the matches from
+	 *  all the queries.
+	 *
+	 *  If any of the databases is remote, the statistics can't be shared
+	 *  and the queries are simply run one at a time.
+	 *
+	 *  A continuation token (see set_continuation()) only makes sense for
+	 *  the query it came from, so one can't be set when calling this
+	 *  method.
+	 *
+	 *  @param queries   the queries to run.
+	 *  @param first     the first item in each result set to return.
+	 *  @param maxitems  the maximum number of items to return for each
+	 *		     query.
+	 *  @param checkatleast  the minimum number of items to check for each
+	 *		     query.
+	 *  @param omrset    the relevance set to use when performing the
+	 *		     queries.
+	 *  @param mdecider  a decision functor to use to decide whether a
+	 *		     given document should be put in an MSet.
+	 *
+	 *  @return	     A vector of Xapian::MSet objects, one for each entry
+	 *		     in @a queries, in the same order.
+	 *
+	 *  @exception Xapian::InvalidArgumentError  See class documentation.
+	 */
+	std::vector<MSet> get_msets(const std::vector<Xapian::Query> & queries,
+				    Xapian::doccount first,
+				    Xapian::doccount maxitems,
+				    Xapian::doccount checkatleast = 0,
+				    const RSet * omrset = 0,
+				    const MatchDecider * mdecider = 0) const;
+
 	static const int INCLUDE_QUERY_TERMS = 1;
 	static const int USE_EXACT_TERMFREQ = 2;
 
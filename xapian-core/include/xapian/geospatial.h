@@ -41,6 +41,7 @@
 
 namespace Xapian {
 
+class Document;
 class Registry;
 
 double
@@ -273,6 +274,30 @@ operator!=(const LatLongCoordsIterator &a, const LatLongCoordsIterator &b)
     return !(a == b);
 }
 
+/** Add terms for the geohash cells containing some coordinates to a document.
+ *
+ *  Experimental - see http://xapian.org/docs/deprecation#experimental-features
+ *
+ *  For each coordinate, a term is added for the cell containing it at each
+ *  geohash length from 1 to 8 characters (from cells thousands of kilometres
+ *  across down to cells about 38m by 19m).  Each term is @a prefix followed by
+ *  the geohash.
+ *
+ *  These terms allow LatLongDistancePostingSource to find documents within
+ *  range without looking at every document with coordinates - see
+ *  LatLongDistancePostingSource::set_cell_prefix().
+ *
+ *  @param doc	The document to add the terms to.
+ *  @param coords	The coordinates to add terms for.  These should be the
+ *			same coordinates which are stored in the document's
+ *			value slot.
+ *  @param prefix	The prefix to use for the terms.
+ */
+XAPIAN_VISIBILITY_DEFAULT
+void index_latlong_cells(Xapian::Document & doc,
+			 const LatLongCoords & coords,
+			 const std::string & prefix);
+
 /** Base class for calculating distances between two lat/long coordinates.
  *
  *  Experimental - see http://xapian.org/docs/deprecation#experimental-features
@@ -448,9 +473,18 @@ class XAPIAN_VISIBILITY_DEFAULT LatLongDistancePostingSource : public ValuePosti
     /// Constant used in weighting function.
     double k2;
 
+    /// Class holding state which isn't part of the ABI.
+    class Internal;
+
+    /// @internal State which isn't part of the ABI.
+    Internal * internal;
+
     /// Calculate the distance for the current document.
     void calc_distance();
 
+    /// Advance value_it to the next document which is within range.
+    void find_in_range();
+
     /// Internal constructor; used by clone() and serialise().
     LatLongDistancePostingSource(Xapian::valueno slot_,
 				 const LatLongCoords & centre_,
@@ -479,6 +513,21 @@ class XAPIAN_VISIBILITY_DEFAULT LatLongDistancePostingSource : public ValuePosti
 				 double k2_ = 1.0);
     ~LatLongDistancePostingSource();
 
+    /** Only consider documents in geohash cells near the centre.
+     *
+     *  The documents must have had terms for the cells containing their
+     *  coordinates added using index_latlong_cells() with the same @a prefix.
+     *  Then only documents in cells which could contain points within range
+     *  are looked at, rather than every document with coordinates.
+     *
+     *  This only has an effect if a maximum range was specified.  The cells
+     *  are chosen assuming that the metric measures distance along the
+     *  surface of a sphere, as GreatCircleMetric does.
+     *
+     *  @param prefix	The prefix used for the cell terms.
+     */
+    void set_cell_prefix(const std::string & prefix);
+
     void next(double min_wt);
     void skip_to(Xapian::docid min_docid, double min_wt);
     bool check(Xapian::docid min_docid, double min_wt);
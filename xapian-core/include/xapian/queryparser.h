@@ -88,6 +88,62 @@ class XAPIAN_VISIBILITY_DEFAULT SimpleStopper : public Stopper {
     virtual std::string get_description() const;
 };
 
+/** Split CJK text into words using a lexicon.
+ *
+ *  If the environment variable XAPIAN_CJK_NGRAM is set, TermGenerator and
+ *  QueryParser split runs of CJK characters into overlapping n-grams.  That
+ *  needs no knowledge of the language, but generates a lot of terms, and
+ *  phrase searches have to work from positional data for every character.
+ *
+ *  If a CJKSegmenter is set on them instead, runs of CJK characters are split
+ *  into words from its lexicon, taking the longest word at each point (and
+ *  treating a character which doesn't start any word in the lexicon as a word
+ *  on its own).  This is done whether or not XAPIAN_CJK_NGRAM is set.
+ *
+ *  The terms generated depend on the lexicon, so the same lexicon needs to be
+ *  used for indexing and searching.
+ */
+class XAPIAN_VISIBILITY_DEFAULT CJKSegmenter {
+  public:
+    /// @private @internal Class representing the CJKSegmenter internals.
+    class Internal;
+    /// @private @internal Reference counted internals.
+    Xapian::Internal::intrusive_ptr<Internal> internal;
+
+    /// Copy constructor.
+    CJKSegmenter(const CJKSegmenter & o);
+
+    /// Assignment.
+    CJKSegmenter & operator=(const CJKSegmenter & o);
+
+    /// Construct with an empty lexicon.
+    CJKSegmenter();
+
+    /** Construct with the lexicon read from a file.
+     *
+     *  @param filename	The file to read, which should contain one word per
+     *			line, encoded in UTF-8.  Anything after a space or tab
+     *			on a line is ignored, so a list of words and their
+     *			frequencies can be used as is.
+     *
+     *  @exception Xapian::InvalidArgumentError if the file can't be opened.
+     */
+    explicit CJKSegmenter(const std::string & filename);
+
+    /// Destructor.
+    ~CJKSegmenter();
+
+    /** Add a word to the lexicon.
+     *
+     *  Copies of a CJKSegmenter share the same lexicon, so the word will be
+     *  added to any copies too.
+     */
+    void add_word(const std::string & word);
+
+    /// Return a string describing this object.
+    std::string get_description() const;
+};
+
 /// Base class for value range processors.
 struct XAPIAN_VISIBILITY_DEFAULT ValueRangeProcessor {
     /// Destructor.
@@ -541,6 +597,15 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
      */
     void set_stopper(const Stopper *stop = NULL);
 
+    /** Set the lexicon to split CJK text into words with.
+     *
+     *  This should be the same lexicon that was used by the TermGenerator
+     *  when indexing.  See CJKSegmenter for details.
+     *
+     *  @param segmenter	The CJKSegmenter object to set.
+     */
+    void set_cjk_segmenter(const Xapian::CJKSegmenter & segmenter);
+
     /** Set the default operator.
      *
      *  @param default_op	The operator to use to combine non-filter
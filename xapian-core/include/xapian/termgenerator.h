@@ -34,6 +34,7 @@
 
 namespace Xapian {
 
+class CJKSegmenter;
 class Document;
 class Stem;
 class Stopper;
@@ -77,6 +78,17 @@ class XAPIAN_VISIBILITY_DEFAULT TermGenerator {
      */
     void set_stopper(const Xapian::Stopper *stop = NULL);
 
+    /** Set the lexicon to split CJK text into words with.
+     *
+     *  Words found are indexed with positional information, so phrase
+     *  searches work from the words rather than from individual characters.
+     *  The QueryParser needs to use the same lexicon.  See CJKSegmenter for
+     *  details.
+     *
+     *  @param segmenter	The CJKSegmenter object to set.
+     */
+    void set_cjk_segmenter(const Xapian::CJKSegmenter & segmenter);
+
     /// Set the current document.
     void set_document(const Xapian::Document & doc);
 
@@ -173,6 +173,54 @@ split_rset_by_db(const Xapian::RSet * rset,
     Assert(subrsets.size() == number_of_subdbs);
 }
 
+/** Convert a continuation docid to the docids of one sub-database.
+ *
+ *  Items which tie on weight and sort key are ordered by docid, so a
+ *  continuation passed to a remote sub-database needs its docid converting
+ *  so that it ranks the remote items the same way as the merged docids
+ *  would.
+ *
+ *  @param did		The docid in the combined database.
+ *  @param subdatabase	The index of the sub-database.
+ *  @param number_of_subdbs The number of sub databases which exist.
+ *  @param forward	Are docids in ascending order?
+ *
+ *  @return The docid in the sub-database, or 0 if all items in the
+ *	    sub-database which tie with the continuation rank after it.
+ */
+static Xapian::docid
+continuation_docid_for_db(Xapian::docid did,
+			  Xapian::doccount subdatabase,
+			  Xapian::doccount number_of_subdbs,
+			  bool forward)
+{
+    if (did <= subdatabase) {
+	// Every docid in this sub-database is greater than did.
+	return forward ? 0 : 1;
+    }
+    Xapian::docid offset = did - subdatabase - 1;
+    if (!forward) offset += number_of_subdbs - 1;
+    return offset / number_of_subdbs + 1;
+}
+
+/** Does @a item rank after the continuation point @a after?
+ *
+ *  A docid of 0 in @a after means every item which ties with it on weight
+ *  and sort key ranks after it (see continuation_docid_for_db()).
+ */
+inline bool
+ranks_after(const MSetCmp & mcmp,
+	    const Xapian::Internal::MSetItem & after,
+	    const Xapian::Internal::MSetItem & item)
+{
+    if (rare(after.did == 0)) {
+	Xapian::Internal::MSetItem tied(after);
+	tied.did = item.did;
+	return !mcmp(item, tied);
+    }
+    return mcmp(after, item);
+}
+
 /** Prepare some SubMatches.
  *
  *  This calls the prepare_match() method on each SubMatch object, causing them
@@ -269,11 +317,13 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 		       Xapian::Enquire::Internal::sort_setting sort_by_,
 		       bool sort_value_forward_,
 		       double time_limit_,
+		       const string & continuation,
 		       Xapian::ErrorHandler * errorhandler_,
 		       Xapian::Weight::Internal & stats,
 		       const Xapian::Weight * weight_,
 		       const vector<Xapian::MatchSpy *> & matchspies_,
-		       bool have_sorter, bool have_mdecider)
+		       bool have_sorter, bool have_mdecider,
+		       bool stats_prepared)
 	: db(db_), query(query_),
 	  collapse_max(collapse_max_), collapse_key(collapse_key_),
 	  percent_cutoff(percent_cutoff_), weight_cutoff(weight_cutoff_),
@@ -281,11 +331,15 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 	  sort_key(sort_key_), sort_by(sort_by_),
 	  sort_value_forward(sort_value_forward_),
 	  time_limit(time_limit_),
+	  have_search_after(!continuation.empty()), search_after(0.0, 0),
 	  errorhandler(errorhandler_), weight(weight_),
 	  is_remote(db.internal.size()),
 	  matchspies(matchspies_)
 {
-    LOGCALL_CTOR(MATCH, "MultiMatch", db_ | query_ | qlen | omrset | collapse_max_ | collapse_key_ | percent_cutoff_ | weight_cutoff_ | int(order_) | sort_key_ | int(sort_by_) | sort_value_forward_ | time_limit_| errorhandler_ | stats | weight_ | matchspies_ | have_sorter | have_mdecider);
+    LOGCALL_CTOR(MATCH, "MultiMatch", db_ | query_ | qlen | omrset | collapse_max_ | collapse_key_ | percent_cutoff_ | weight_cutoff_ | int(order_) | sort_key_ | int(sort_by_) | sort_value_forward_ | time_limit_ | continuation | errorhandler_ | stats | weight_ | matchspies_ | have_sorter | have_mdecider | stats_prepared);
+
+    if (have_search_after)
+	search_after = Xapian::Internal::unserialise_continuation(continuation);
 
     if (query.empty()) return;
 
@@ -308,11 +362,22 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 		if (have_mdecider) {
 		    throw Xapian::UnimplementedError("Xapian::MatchDecider not supported for the remote backend");
 		}
+		string rem_continuation;
+		if (have_search_after) {
+		    Xapian::Internal::MSetItem rem_after(search_after);
+		    if (number_of_subdbs > 1) {
+			rem_after.did = continuation_docid_for_db(
+				search_after.did, i, number_of_subdbs,
+				order != Xapian::Enquire::DESCENDING);
+		    }
+		    rem_continuation =
+			Xapian::Internal::serialise_continuation(rem_after);
+		}
 		// FIXME: Remote handling for time_limit with multiple
 		// databases may need some work.
 		rem_db->set_query(query, qlen, collapse_max, collapse_key,
 				  order, sort_key, sort_by, sort_value_forward,
-				  time_limit,
+				  time_limit, rem_continuation,
 				  percent_cutoff, weight_cutoff, weight,
 				  subrsets[i], matchspies);
 		bool decreasing_relevance =
@@ -338,6 +403,12 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 	leaves.push_back(smatch);
     }
 
+    if (stats_prepared) {
+	// The caller has already collated statistics covering this query's
+	// terms, so there's nothing more to fetch.
+	return;
+    }
+
     stats.mark_wanted_terms(query);
     prepare_sub_matches(leaves, errorhandler, stats);
     stats.set_bounds_from_db(db);
@@ -589,6 +660,22 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     // Is the mset a valid heap?
     bool is_heap = false;
 
+    // Have all the matches which rank before the continuation point been
+    // counted in docs_matched?
+    bool counted_all = true;
+
+    // In a forward boolean match in docid order, every document up to the
+    // continuation point's docid ranks before it, so we can skip over them.
+    // MergePostList doesn't support skip_to(), and we mustn't skip documents
+    // which a matchspy needs to see.
+    Xapian::docid skip_to_did = 0;
+    if (have_search_after && sort_by == REL && max_possible == 0 &&
+	sort_forward && search_after.wt <= 0.0 && leaves.size() == 1 &&
+	!is_remote[0] && matchspy == NULL) {
+	skip_to_did = search_after.did + 1;
+	counted_all = false;
+    }
+
     while (true) {
 	bool pushback;
 
@@ -602,7 +689,16 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	}
 
 	PostList * pl_copy = pl.get();
-	if (rare(next_handling_prune(pl_copy, min_weight, this))) {
+	bool pruned;
+	if (rare(skip_to_did)) {
+	    LOGLINE(MATCH, "Skipping to continuation point");
+	    pruned = skip_to_handling_prune(pl_copy, skip_to_did, min_weight,
+					    this);
+	    skip_to_did = 0;
+	} else {
+	    pruned = next_handling_prune(pl_copy, min_weight, this);
+	}
+	if (rare(pruned)) {
 	    (void)pl.release();
 	    pl.reset(pl_copy);
 	    LOGLINE(MATCH, "*** REPLACING ROOT");
@@ -714,6 +810,14 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	    new_item.wt = wt;
 	}
 
+	if (have_search_after && !ranks_after(mcmp, search_after, new_item)) {
+	    // This item was returned as part of an earlier page.
+	    LOGLINE(MATCH, "Rejecting candidate which ranks before continuation point");
+	    ++docs_matched;
+	    if (wt > greatest_wt) goto new_greatest_weight;
+	    continue;
+	}
+
 	pushback = true;
 
 	// Perform collapsing on key if requested.
@@ -934,7 +1038,26 @@ new_greatest_weight:
     Xapian::doccount uncollapsed_lower_bound = matches_lower_bound;
     Xapian::doccount uncollapsed_upper_bound = matches_upper_bound;
     Xapian::doccount uncollapsed_estimated = matches_estimated;
-    if (items.size() < max_msize) {
+    if (items.size() < max_msize && have_search_after) {
+	// We have all the matches after the continuation point, but some of
+	// those before it may not have been seen.
+	LOGLINE(MATCH, "items.size() = " << items.size() <<
+		", max_msize = " << max_msize << ", after continuation");
+	// Continuation tokens can't be used with collapsing.
+	Assert(!collapser);
+	matches_lower_bound = items.size();
+	if (!percent_cutoff) {
+	    // docs_matched counts every match we've seen.
+	    matches_lower_bound = max(docs_matched, matches_lower_bound);
+	}
+	if (counted_all && definite_matches_not_seen == 0) {
+	    // docs_matched can only overcount the matches.
+	    matches_upper_bound = min(docs_matched, matches_upper_bound);
+	}
+	matches_upper_bound = max(matches_upper_bound, matches_lower_bound);
+	matches_estimated = max(matches_estimated, matches_lower_bound);
+	matches_estimated = min(matches_estimated, matches_upper_bound);
+    } else if (items.size() < max_msize) {
 	// We have fewer items in the mset than we tried to get for it, so we
 	// must have all the matches in it.
 	LOGLINE(MATCH, "items.size() = " << items.size() <<
@@ -945,7 +1068,7 @@ new_greatest_weight:
 	    = items.size();
 	if (collapser && matches_lower_bound > uncollapsed_lower_bound)
 	    uncollapsed_lower_bound = matches_lower_bound;
-    } else if (!collapser && docs_matched < check_at_least) {
+    } else if (!collapser && counted_all && docs_matched < check_at_least) {
 	// We have seen fewer matches than we checked for, so we must have seen
 	// all the matches.
 	LOGLINE(MATCH, "Setting bounds equal");
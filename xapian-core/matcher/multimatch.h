@@ -59,6 +59,12 @@ class MultiMatch
 
 	double time_limit;
 
+	/// Are we only returning items which rank after search_after?
+	bool have_search_after;
+
+	/// The continuation point (if have_search_after is true).
+	Xapian::Internal::MSetItem search_after;
+
 	/// ErrorHandler
 	Xapian::ErrorHandler * errorhandler;
 
@@ -97,12 +103,18 @@ class MultiMatch
 	 *  @param omrset    The relevance set (or NULL for no RSet)
 	 *  @param time_limit_ Seconds to reduce check_at_least after (or <= 0
 	 *                     for no limit)
+	 *  @param continuation Continuation token from
+	 *			MSet::get_continuation() (or empty for none)
 	 *  @param errorhandler Errorhandler object
 	 *  @param stats     The stats object to add our stats to.
 	 *  @param wtscheme  Weighting scheme
 	 *  @param matchspies_ Any the MatchSpy objects in use.
 	 *  @param have_sorter Is there a sorter in use?
 	 *  @param have_mdecider Is there a Xapian::MatchDecider in use?
+	 *  @param stats_prepared Has @a stats already been collated for this
+	 *			  query (e.g. by an earlier MultiMatch in a
+	 *			  batch)?  If so, the statistics aren't fetched
+	 *			  again.
 	 */
 	MultiMatch(const Xapian::Database &db_,
 		   const Xapian::Query & query,
@@ -117,11 +129,13 @@ class MultiMatch
 		   Xapian::Enquire::Internal::sort_setting sort_by_,
 		   bool sort_value_forward_,
 		   double time_limit_,
+		   const std::string & continuation,
 		   Xapian::ErrorHandler * errorhandler,
 		   Xapian::Weight::Internal & stats,
 		   const Xapian::Weight *wtscheme,
 		   const vector<Xapian::MatchSpy *> & matchspies_,
-		   bool have_sorter, bool have_mdecider);
+		   bool have_sorter, bool have_mdecider,
+		   bool stats_prepared = false);
 
 	/** Run the match and generate an MSet object.
 	 *
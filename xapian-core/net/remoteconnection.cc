@@ -42,10 +42,30 @@
 #include "length.h"
 #include "socket_utils.h"
 
+#ifdef HAVE_SENDFILE
+# include <sys/sendfile.h>
+#endif
+
 using namespace std;
 
 #define CHUNKSIZE 4096
 
+/** How much file data to read before writing it out in receive_file().
+ *
+ *  Replicating a large database means receiving a lot of file data, so we
+ *  want to make fewer, larger write() calls than CHUNKSIZE would give.
+ */
+#define FILE_CHUNKSIZE 65536
+
+#ifdef HAVE_SENDFILE
+/** The most to ask sendfile() to send in one call.
+ *
+ *  Linux won't send more than 2GB minus a page at once anyway, and keeping it
+ *  under 1GB means the count fits comfortably in a size_t and a ssize_t.
+ */
+#define SENDFILE_CHUNKSIZE 0x40000000
+#endif
+
 XAPIAN_NORETURN(static void throw_database_closed());
 static void
 throw_database_closed()
@@ -65,7 +85,7 @@ update_overlapped_offset(WSAOVERLAPPED & overlapped, DWORD n)
 
 RemoteConnection::RemoteConnection(int fdin_, int fdout_,
 				   const string & context_)
-    : fdin(fdin_), fdout(fdout_), context(context_)
+    : fdin(fdin_), fdout(fdout_), chunked_data_left(0), context(context_)
 {
 #ifdef __WIN32__
     memset(&overlapped, 0, sizeof(overlapped));
@@ -327,7 +347,6 @@ RemoteConnection::send_file(char type, int fd, double end_time)
     off_t size = file_size(fd);
     if (errno)
 	throw Xapian::NetworkError("Couldn't stat file to send", errno);
-    // FIXME: Use sendfile() or similar if available?
 
     char buf[CHUNKSIZE];
     buf[0] = type;
@@ -391,30 +410,72 @@ RemoteConnection::send_file(char type, int fd, double end_time)
 
     fd_set fdset;
     size_t count = 0;
+#ifdef HAVE_SENDFILE
+    // Once the header has been written, we try to send the file contents
+    // using sendfile(), which avoids copying them through userspace.  If
+    // sendfile() doesn't support this pair of fds, we fall back to read() and
+    // write().
+    bool use_sendfile = true;
+    bool in_sendfile = false;
+#endif
     while (true) {
-	// We've set write to non-blocking, so just try writing as there
-	// will usually be space.
-	ssize_t n = write(fdout, buf + count, c - count);
-
-	if (n >= 0) {
-	    count += n;
-	    if (count == c) {
+	ssize_t n;
+#ifdef HAVE_SENDFILE
+	if (in_sendfile) {
+	    size_t want = size_t(min(size, off_t(SENDFILE_CHUNKSIZE)));
+	    n = sendfile(fdout, fd, NULL, want);
+	    if (n > 0) {
+		size -= n;
 		if (size == 0) return;
+		continue;
+	    }
+	    if (n == 0)
+		throw Xapian::NetworkError("File to send was truncated",
+					   context);
+	    LOGLINE(REMOTE, "sendfile gave errno = " << strerror(errno));
+	    if (errno == EINVAL || errno == ENOSYS) {
+		// sendfile() advances the file position of fd by the amount it
+		// sent, so we can just carry on from here with read() and
+		// write().  Setting c and count to 0 makes the loop read the
+		// next chunk of the file.
+		use_sendfile = in_sendfile = false;
+		c = count = 0;
+		continue;
+	    }
+	} else
+#endif
+	{
+	    // We've set write to non-blocking, so just try writing as there
+	    // will usually be space.
+	    n = write(fdout, buf + count, c - count);
+
+	    if (n >= 0) {
+		count += n;
+		if (count == c) {
+		    if (size == 0) return;
+
+#ifdef HAVE_SENDFILE
+		    if (use_sendfile) {
+			in_sendfile = true;
+			continue;
+		    }
+#endif
 
-		ssize_t res;
-		do {
-		    res = read(fd, buf, sizeof(buf));
-		} while (res < 0 && errno == EINTR);
-		if (res < 0) throw Xapian::NetworkError("read failed", errno);
-		c = size_t(res);
+		    ssize_t res;
+		    do {
+			res = read(fd, buf, sizeof(buf));
+		    } while (res < 0 && errno == EINTR);
+		    if (res < 0) throw Xapian::NetworkError("read failed", errno);
+		    c = size_t(res);
 
-		size -= c;
-		count = 0;
+		    size -= c;
+		    count = 0;
+		}
+		continue;
 	    }
-	    continue;
-	}
 
-	LOGLINE(REMOTE, "write gave errno = " << strerror(errno));
+	    LOGLINE(REMOTE, "write gave errno = " << strerror(errno));
+	}
 	if (errno == EINTR) continue;
 
 	if (errno != EAGAIN)
@@ -624,7 +685,7 @@ RemoteConnection::receive_file(const string &file, double end_time)
     char type = buffer[0];
     buffer.erase(0, header_len + remainlen);
     while (len > 0) {
-	read_at_least(min(len, size_t(CHUNKSIZE)), end_time);
+	read_at_least(min(len, size_t(FILE_CHUNKSIZE)), end_time);
 	remainlen = min(buffer.size(), len);
 	write_all(fd, buffer.data(), remainlen);
 	len -= remainlen;
@@ -681,6 +742,17 @@ RemoteConnection::do_close(bool wait)
     }
 }
 
+int
+RemoteConnection::detach()
+{
+    LOGCALL(REMOTE, int, "RemoteConnection::detach", NO_ARGS);
+    if (fdin == -1 || fdin != fdout || !buffer.empty() || chunked_data_left)
+	RETURN(-1);
+    int fd = fdin;
+    fdin = fdout = -1;
+    RETURN(fd);
+}
+
 #ifdef __WIN32__
 DWORD
 RemoteConnection::calc_read_wait_msecs(double end_time)
@@ -280,6 +280,16 @@ class RemoteConnection {
      *			connection before returning.
      */
     void do_close(bool wait);
+
+    /** Stop using the connection without closing it.
+     *
+     *  This is only possible if the same fd is used in both directions, and
+     *  there's no unprocessed input buffered.
+     *
+     *  @return	The fd, or -1 if the connection couldn't be detached (in
+     *		which case it is left as it was).
+     */
+    int detach();
 };
 
 #endif // XAPIAN_INCLUDED_REMOTECONNECTION_H
@@ -55,6 +55,14 @@ throw_read_only()
 /// Class to throw when we receive the connection closing message.
 struct ConnectionClosed { };
 
+/** Send list entries in replies of at least this many bytes.
+ *
+ *  Sending each entry of a postlist, termlist, etc in its own message makes
+ *  iterating a long list over the network very slow, but we don't want to
+ *  build up the whole list in memory either.
+ */
+static const size_t LIST_BATCH_SIZE = 8192;
+
 RemoteServer::RemoteServer(const std::vector<std::string> &dbpaths,
 			   int fdin_, int fdout_,
 			   double active_timeout_, double idle_timeout_,
@@ -100,7 +108,7 @@ RemoteServer::RemoteServer(const std::vector<std::string> &dbpaths,
 #endif
 
     // Send greeting message.
-    msg_update(string());
+    send_update();
 }
 
 RemoteServer::~RemoteServer()
@@ -183,6 +191,7 @@ RemoteServer::run()
 		0, // MSG_GETMSET - used during a conversation.
 		0, // MSG_SHUTDOWN - handled by get_message().
 		&RemoteServer::msg_openmetadatakeylist,
+		&RemoteServer::msg_freqs,
 	    };
 
 	    string message;
@@ -240,12 +249,17 @@ RemoteServer::msg_allterms(const string &message)
 	    prev.resize(255);
 	const string & v = *t;
 	size_t reuse = common_prefix_length(prev, v);
-	reply = encode_length(t.get_termfreq());
+	reply += encode_length(t.get_termfreq());
 	reply.append(1, char(reuse));
+	reply += encode_length(v.size() - reuse);
 	reply.append(v, reuse, string::npos);
-	send_message(REPLY_ALLTERMS, reply);
+	if (reply.size() >= LIST_BATCH_SIZE) {
+	    send_message(REPLY_ALLTERMS, reply);
+	    reply.resize(0);
+	}
 	prev = v;
     }
+    if (!reply.empty()) send_message(REPLY_ALLTERMS, reply);
 
     send_message(REPLY_DONE, string());
 }
@@ -259,19 +273,25 @@ RemoteServer::msg_termlist(const string &message)
 
     send_message(REPLY_DOCLENGTH, encode_length(db->get_doclength(did)));
     string prev;
+    string reply;
     const Xapian::TermIterator end = db->termlist_end(did);
     for (Xapian::TermIterator t = db->termlist_begin(did); t != end; ++t) {
 	if (rare(prev.size() > 255))
 	    prev.resize(255);
 	const string & v = *t;
 	size_t reuse = common_prefix_length(prev, v);
-	string reply = encode_length(t.get_wdf());
+	reply += encode_length(t.get_wdf());
 	reply += encode_length(t.get_termfreq());
 	reply.append(1, char(reuse));
+	reply += encode_length(v.size() - reuse);
 	reply.append(v, reuse, string::npos);
-	send_message(REPLY_TERMLIST, reply);
+	if (reply.size() >= LIST_BATCH_SIZE) {
+	    send_message(REPLY_TERMLIST, reply);
+	    reply.resize(0);
+	}
 	prev = v;
     }
+    if (!reply.empty()) send_message(REPLY_TERMLIST, reply);
 
     send_message(REPLY_DONE, string());
 }
@@ -284,14 +304,20 @@ RemoteServer::msg_positionlist(const string &message)
     Xapian::docid did = decode_length(&p, p_end, false);
     string term(p, p_end - p);
 
+    string reply;
     Xapian::termpos lastpos = static_cast<Xapian::termpos>(-1);
     const Xapian::PositionIterator end = db->positionlist_end(did, term);
     for (Xapian::PositionIterator i = db->positionlist_begin(did, term);
 	 i != end; ++i) {
 	Xapian::termpos pos = *i;
-	send_message(REPLY_POSITIONLIST, encode_length(pos - lastpos - 1));
+	reply += encode_length(pos - lastpos - 1);
+	if (reply.size() >= LIST_BATCH_SIZE) {
+	    send_message(REPLY_POSITIONLIST, reply);
+	    reply.resize(0);
+	}
 	lastpos = pos;
     }
+    if (!reply.empty()) send_message(REPLY_POSITIONLIST, reply);
 
     send_message(REPLY_DONE, string());
 }
@@ -305,24 +331,28 @@ RemoteServer::msg_postlist(const string &message)
     Xapian::termcount collfreq = db->get_collection_freq(term);
     send_message(REPLY_POSTLISTSTART, encode_length(termfreq) + encode_length(collfreq));
 
+    string reply;
     Xapian::docid lastdocid = 0;
     const Xapian::PostingIterator end = db->postlist_end(term);
     for (Xapian::PostingIterator i = db->postlist_begin(term);
 	 i != end; ++i) {
 
 	Xapian::docid newdocid = *i;
-	string reply = encode_length(newdocid - lastdocid - 1);
+	reply += encode_length(newdocid - lastdocid - 1);
 	reply += encode_length(i.get_wdf());
-
-	send_message(REPLY_POSTLISTITEM, reply);
+	if (reply.size() >= LIST_BATCH_SIZE) {
+	    send_message(REPLY_POSTLISTITEM, reply);
+	    reply.resize(0);
+	}
 	lastdocid = newdocid;
     }
+    if (!reply.empty()) send_message(REPLY_POSTLISTITEM, reply);
 
     send_message(REPLY_DONE, string());
 }
 
 void
-RemoteServer::msg_writeaccess(const string & msg)
+RemoteServer::msg_writeaccess(const string &)
 {
     if (!writable) 
 	throw_read_only();
@@ -330,21 +360,32 @@ RemoteServer::msg_writeaccess(const string & msg)
     wdb = new Xapian::WritableDatabase(context, Xapian::DB_OPEN);
     delete db;
     db = wdb;
-    msg_update(msg);
+    send_update();
 }
 
 void
-RemoteServer::msg_reopen(const string & msg)
+RemoteServer::msg_reopen(const string &)
 {
     if (!db->reopen()) {
 	send_message(REPLY_DONE, string());
 	return;
     }
-    msg_update(msg);
+    send_update();
 }
 
 void
 RemoteServer::msg_update(const string &)
+{
+    // A client reusing a pooled connection sends this to get the same
+    // statistics as the greeting gives a new connection, so a read-only
+    // database needs to be at the latest revision just as it would be if it
+    // had just been opened.
+    if (!wdb) db->reopen();
+    send_update();
+}
+
+void
+RemoteServer::send_update()
 {
     static const char protocol[2] = {
 	char(XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION),
@@ -424,6 +465,10 @@ RemoteServer::msg_query(const string &message_in)
 
     double time_limit = unserialise_double(&p, p_end);
 
+    len = decode_length(&p, p_end, true);
+    string continuation(p, len);
+    p += len;
+
     int percent_cutoff = *p++;
     if (percent_cutoff < 0 || percent_cutoff > 100) {
 	throw Xapian::NetworkError("bad message (percent_cutoff)");
@@ -477,8 +522,9 @@ RemoteServer::msg_query(const string &message_in)
     Xapian::Weight::Internal local_stats;
     MultiMatch match(*db, query, qlen, &rset, collapse_max, collapse_key,
 		     percent_cutoff, weight_cutoff, order,
-		     sort_key, sort_by, sort_value_forward, time_limit, NULL,
-		     local_stats, wt.get(), matchspies.spies, false, false);
+		     sort_key, sort_by, sort_value_forward, time_limit,
+		     continuation, NULL, local_stats, wt.get(),
+		     matchspies.spies, false, false);
 
     send_message(REPLY_STATS, serialise_stats(local_stats));
 
@@ -557,6 +603,14 @@ RemoteServer::msg_termfreq(const string &term)
     send_message(REPLY_TERMFREQ, encode_length(db->get_termfreq(term)));
 }
 
+void
+RemoteServer::msg_freqs(const string &term)
+{
+    string msg = encode_length(db->get_termfreq(term));
+    msg += encode_length(db->get_collection_freq(term));
+    send_message(REPLY_FREQS, msg);
+}
+
 void
 RemoteServer::msg_valuestats(const string & message)
 {
@@ -694,11 +748,16 @@ RemoteServer::msg_openmetadatakeylist(const string & message)
 	    prev.resize(255);
 	const string & v = *t;
 	size_t reuse = common_prefix_length(prev, v);
-	reply.assign(1, char(reuse));
+	reply.append(1, char(reuse));
+	reply += encode_length(v.size() - reuse);
 	reply.append(v, reuse, string::npos);
-	send_message(REPLY_METADATAKEYLIST, reply);
+	if (reply.size() >= LIST_BATCH_SIZE) {
+	    send_message(REPLY_METADATAKEYLIST, reply);
+	    reply.resize(0);
+	}
 	prev = v;
     }
+    if (!reply.empty()) send_message(REPLY_METADATAKEYLIST, reply);
     send_message(REPLY_DONE, string());
 }
 
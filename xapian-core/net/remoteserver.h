@@ -98,6 +98,9 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     // get termfreq
     void msg_termfreq(const std::string & message);
 
+    // get termfreq and collection freq
+    void msg_freqs(const std::string & message);
+
     // get value statistics
     void msg_valuestats(const std::string & message);
 
@@ -125,9 +128,12 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     // reopen
     void msg_reopen(const std::string & message);
 
-    // get updated doccount and avlength
+    // reopen if read-only, and get updated doccount and avlength
     void msg_update(const std::string &message);
 
+    // send the database statistics in REPLY_UPDATE
+    void send_update();
+
     // commit
     void msg_commit(const std::string & message);
 
@@ -24,15 +24,173 @@
 
 #include <xapian/error.h>
 
+#include "mutex.h"
+#include "realtime.h"
+#include "remoteconnection.h"
+#include "remoteprotocol.h"
+#include "safesysselect.h"
+#include "safeunistd.h"
+#include "socket_utils.h"
 #include "str.h"
 #include "tcpclient.h"
 
+#include <cstdlib>
+#include <map>
+#include <vector>
+
 using namespace std;
 
+namespace {
+
+/// An idle connection to a server.
+struct PooledConnection {
+    int fd;
+
+#ifndef __WIN32__
+    /// The process which added the connection to the pool.
+    pid_t pid;
+#endif
+};
+
+typedef map<string, vector<PooledConnection> > connection_pool;
+
+/// Return the mutex which protects the pool returned by get_pool().
+Mutex &
+get_pool_mutex()
+{
+    static Mutex * mutex = new Mutex;
+    return *mutex;
+}
+
+/** Return the idle connections, keyed by RemoteTcpClient::get_tcpcontext().
+ *
+ *  The caller must hold the mutex returned by get_pool_mutex().
+ */
+connection_pool &
+get_pool()
+{
+    static connection_pool * pool = new connection_pool;
+    return *pool;
+}
+
+/// Create the mutex before main() is called, and so before any threads are.
+struct PoolMutexInitialiser {
+    PoolMutexInitialiser() { (void)get_pool_mutex(); }
+} pool_mutex_initialiser;
+
+/// The maximum number of idle connections to keep to each server.
+size_t
+get_pool_size()
+{
+    const char * p = getenv("XAPIAN_REMOTE_POOL_SIZE");
+    if (p == NULL) return 0;
+    int n = atoi(p);
+    return n > 0 ? size_t(n) : 0;
+}
+
+/** Take an idle connection to the server @a key from the pool.
+ *
+ *  @return	The fd of the connection, or -1 if there isn't one.
+ */
+int
+take_from_pool(const string & key)
+{
+    MutexLock lock(get_pool_mutex());
+    connection_pool & pool = get_pool();
+    connection_pool::iterator i = pool.find(key);
+    if (i == pool.end()) return -1;
+    int fd = -1;
+    vector<PooledConnection> & conns = i->second;
+    while (fd == -1 && !conns.empty()) {
+	// Take the most recently used connection, as it's the least likely to
+	// have been closed by the server.
+	PooledConnection conn = conns.back();
+	conns.pop_back();
+#ifndef __WIN32__
+	if (conn.pid != getpid()) {
+	    // We've forked since this connection was added, and our parent
+	    // may still be using it, so just close our copy of the fd.
+	    close(conn.fd);
+	    continue;
+	}
+#endif
+	fd = conn.fd;
+    }
+    if (conns.empty()) pool.erase(i);
+    return fd;
+}
+
+/// Add the connection @a fd to the server @a key to the pool, or close it.
+void
+add_to_pool(const string & key, int fd)
+{
+    size_t pool_size = get_pool_size();
+    {
+	MutexLock lock(get_pool_mutex());
+	connection_pool & pool = get_pool();
+	vector<PooledConnection> & conns = pool[key];
+	if (conns.size() < pool_size) {
+	    PooledConnection conn;
+	    conn.fd = fd;
+#ifndef __WIN32__
+	    conn.pid = getpid();
+#endif
+	    conns.push_back(conn);
+	    return;
+	}
+	if (conns.empty()) pool.erase(key);
+    }
+    close_fd_or_socket(fd);
+}
+
+/** Check if an idle connection has been closed by the server.
+ *
+ *  The server doesn't send anything unprompted, so if an idle connection is
+ *  ready to read then the server must have closed it (most likely because of
+ *  its idle timeout).
+ */
+bool
+server_closed(int fd)
+{
+    fd_set readfds, exceptfds;
+    FD_ZERO(&readfds);
+    FD_SET(fd, &readfds);
+    FD_ZERO(&exceptfds);
+    FD_SET(fd, &exceptfds);
+
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    return select(fd + 1, &readfds, 0, &exceptfds, &tv) != 0;
+}
+
+}
+
 int
 RemoteTcpClient::open_socket(const string & hostname, int port,
-			     double timeout_connect)
+			     double timeout_, double timeout_connect,
+			     bool writable)
 {
+    if (!writable && get_pool_size()) {
+	string key = get_tcpcontext(hostname, port);
+	int fd;
+	while ((fd = take_from_pool(key)) != -1) {
+	    if (!server_closed(fd)) {
+		// Ask the server to reopen the database and send us its
+		// statistics, which the RemoteDatabase constructor reads just
+		// like the greeting on a new connection.
+		try {
+		    RemoteConnection conn(fd, fd, key);
+		    conn.send_message(MSG_UPDATE, string(),
+				      RealTime::end_time(timeout_));
+		    return fd;
+		} catch (const Xapian::NetworkError &) {
+		}
+	    }
+	    close_fd_or_socket(fd);
+	}
+    }
+
     // If TcpClient::open_socket() throws, fill in the context.
     try {
 	return TcpClient::open_socket(hostname, port, timeout_connect, true);
@@ -58,5 +216,9 @@ RemoteTcpClient::get_tcpcontext(const string & hostname, int port)
 
 RemoteTcpClient::~RemoteTcpClient()
 {
+    if (!pool_key.empty() && get_pool_size()) {
+	int fd = release_connection();
+	if (fd != -1) add_to_pool(pool_key, fd);
+    }
     do_close();
 }
@@ -51,7 +51,8 @@ class RemoteTcpClient : SOCKET_INITIALIZER_MIXIN public RemoteDatabase {
      *  methods which do, this method has been deliberately made "static".
      */
     static int open_socket(const std::string & hostname, int port,
-			   double timeout_connect);
+			   double timeout_, double timeout_connect,
+			   bool writable);
 
     /** Get a context string for use when constructing Xapian::NetworkError.
      *
@@ -61,6 +62,12 @@ class RemoteTcpClient : SOCKET_INITIALIZER_MIXIN public RemoteDatabase {
      */
     static std::string get_tcpcontext(const std::string & hostname, int port);
 
+    /** Key identifying the server in the pool of idle connections.
+     *
+     *  Empty if the connection shouldn't be returned to the pool.
+     */
+    std::string pool_key;
+
   public:
     /** Constructor.
      *
@@ -71,14 +78,26 @@ class RemoteTcpClient : SOCKET_INITIALIZER_MIXIN public RemoteDatabase {
      *  @param timeout		Timeout during communication after successfully
      *				connecting (in seconds).
      *	@param writable		Is this a WritableDatabase?
+     *
+     *  If the environment variable XAPIAN_REMOTE_POOL_SIZE is set to a
+     *  positive integer, a read-only connection is kept open when the
+     *  RemoteTcpClient is destroyed (up to that many per server), and reused by
+     *  the next RemoteTcpClient for the same server, saving the cost of
+     *  connecting and of the server opening the database.
      */
     RemoteTcpClient(const std::string & hostname, int port,
 		    double timeout_, double timeout_connect, bool writable)
-	: RemoteDatabase(open_socket(hostname, port, timeout_connect),
+	: RemoteDatabase(open_socket(hostname, port, timeout_, timeout_connect,
+				     writable),
 			 timeout_, get_tcpcontext(hostname, port),
-			 writable) { }
+			 writable) {
+	if (!writable) pool_key = get_tcpcontext(hostname, port);
+    }
 
-    /** Destructor. */
+    /** Destructor.
+     *
+     *  Returns the connection to the pool if that's enabled and possible.
+     */
     ~RemoteTcpClient();
 };
 
@@ -166,13 +166,17 @@ serialise_mset(const Xapian::MSet &mset)
 
     result += serialise_double(mset.internal->percent_factor);
 
-    result += encode_length(mset.size());
-    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
-	result += serialise_double(i.get_weight());
-	result += encode_length(*i);
-	result += encode_length(i.get_collapse_key().size());
-	result += i.get_collapse_key();
-	result += encode_length(i.get_collapse_count());
+    const vector<Xapian::Internal::MSetItem> & items = mset.internal->items;
+    result += encode_length(items.size());
+    vector<Xapian::Internal::MSetItem>::const_iterator i;
+    for (i = items.begin(); i != items.end(); ++i) {
+	result += serialise_double(i->wt);
+	result += encode_length(i->did);
+	result += encode_length(i->collapse_key.size());
+	result += i->collapse_key;
+	result += encode_length(i->collapse_count);
+	result += encode_length(i->sort_key.size());
+	result += i->sort_key;
     }
 
     const map<string, Xapian::MSet::Internal::TermFreqAndWeight> &termfreqandwts
@@ -214,6 +218,9 @@ unserialise_mset(const char * p, const char * p_end)
 	p += len;
 	Xapian::doccount collapse_cnt = decode_length(&p, p_end, false);
 	items.push_back(Xapian::Internal::MSetItem(wt, did, key, collapse_cnt));
+	len = decode_length(&p, p_end, true);
+	items.back().sort_key.assign(p, len);
+	p += len;
     }
 
     map<string, Xapian::MSet::Internal::TermFreqAndWeight> terminfo;
@@ -30,9 +30,13 @@
 #include "cjk-tokenizer.h"
 
 #include "omassert.h"
+#include "str.h"
+#include "xapian/error.h"
 #include "xapian/unicode.h"
 
+#include <cerrno>
 #include <cstdlib>
+#include <fstream>
 #include <string>
 
 using namespace std;
@@ -97,12 +101,114 @@ CJK::get_cjk(Xapian::Utf8Iterator &it)
     return str;
 }
 
+void
+Xapian::CJKSegmenter::Internal::add_word(const string & word)
+{
+    if (word.empty()) return;
+    string prefix;
+    Xapian::Utf8Iterator i(word);
+    while (true) {
+	Xapian::Unicode::append_utf8(prefix, *i);
+	if (++i == Xapian::Utf8Iterator()) break;
+	// Only adds prefix if it isn't already present as a word.
+	entries.insert(make_pair(prefix, false));
+    }
+    bool & is_word = entries[prefix];
+    if (!is_word) {
+	is_word = true;
+	++word_count;
+    }
+}
+
+unsigned
+Xapian::CJKSegmenter::Internal::next_word(Xapian::Utf8Iterator & it,
+					  string & word) const
+{
+    Assert(it != Xapian::Utf8Iterator());
+    // Fall back to a single character if no word in the lexicon matches.
+    word.resize(0);
+    Xapian::Unicode::append_utf8(word, *it);
+    ++it;
+    unsigned len = 1;
+
+    // Forward maximum matching: extend the candidate one character at a time
+    // while it's still the start of some word, remembering the longest
+    // candidate which is a word.
+    string candidate = word;
+    Xapian::Utf8Iterator p = it;
+    unsigned n = 1;
+    map<string, bool>::const_iterator e = entries.find(candidate);
+    while (e != entries.end() && p != Xapian::Utf8Iterator()) {
+	Xapian::Unicode::append_utf8(candidate, *p);
+	++p;
+	++n;
+	e = entries.find(candidate);
+	if (e != entries.end() && e->second) {
+	    word = candidate;
+	    it = p;
+	    len = n;
+	}
+    }
+    return len;
+}
+
+Xapian::CJKSegmenter::CJKSegmenter(const CJKSegmenter & o)
+    : internal(o.internal) { }
+
+Xapian::CJKSegmenter &
+Xapian::CJKSegmenter::operator=(const CJKSegmenter & o)
+{
+    internal = o.internal;
+    return *this;
+}
+
+Xapian::CJKSegmenter::CJKSegmenter() : internal(new Internal) { }
+
+Xapian::CJKSegmenter::CJKSegmenter(const string & filename)
+    : internal(new Internal)
+{
+    ifstream in(filename.c_str());
+    if (!in) {
+	throw Xapian::InvalidArgumentError("Couldn't open CJK word list",
+					   filename, errno);
+    }
+    string line;
+    while (getline(in, line)) {
+	// Ignore anything after the word, so a list of words with their
+	// frequencies can be used as is.
+	string::size_type end = line.find_first_of(" \t\r");
+	if (end != string::npos) line.resize(end);
+	internal->add_word(line);
+    }
+}
+
+Xapian::CJKSegmenter::~CJKSegmenter() { }
+
+void
+Xapian::CJKSegmenter::add_word(const string & word)
+{
+    internal->add_word(word);
+}
+
+string
+Xapian::CJKSegmenter::get_description() const
+{
+    string desc("Xapian::CJKSegmenter(");
+    desc += str(internal->size());
+    desc += " words)";
+    return desc;
+}
+
 const string &
 CJKTokenIterator::operator*() const
 {
     if (current_token.empty()) {
 	Assert(it != Xapian::Utf8Iterator());
 	p = it;
+	if (words) {
+	    len = words->next_word(p, current_token);
+	    return current_token;
+	}
 	Xapian::Unicode::append_utf8(current_token, *p);
 	++p;
 	len = 1;
@@ -113,6 +219,12 @@ CJKTokenIterator::operator*() const
 CJKTokenIterator &
 CJKTokenIterator::operator++()
 {
+    if (words) {
+	if (current_token.empty()) (void)**this;
+	it = p;
+	current_token.resize(0);
+	return *this;
+    }
     if (len < NGRAM_SIZE && p != Xapian::Utf8Iterator()) {
 	Xapian::Unicode::append_utf8(current_token, *p);
 	++p;
@@ -28,8 +28,11 @@
 #ifndef XAPIAN_INCLUDED_CJK_TOKENIZER_H
 #define XAPIAN_INCLUDED_CJK_TOKENIZER_H
 
+#include "xapian/intrusive_ptr.h"
+#include "xapian/queryparser.h"
 #include "xapian/unicode.h"
 
+#include <map>
 #include <string>
 
 namespace CJK {
@@ -48,9 +51,47 @@ std::string get_cjk(Xapian::Utf8Iterator &it);
 
 }
 
+/// The lexicon used to split CJK text into words.
+class Xapian::CJKSegmenter::Internal : public Xapian::Internal::intrusive_base {
+    /** Each word in the lexicon and each prefix of one.
+     *
+     *  The value is true for words and false for prefixes which aren't
+     *  themselves words, which lets the search for the longest match stop as
+     *  soon as the text read so far can't start any word.
+     */
+    std::map<std::string, bool> entries;
+
+    /// The number of words in the lexicon.
+    size_t word_count;
+
+  public:
+    Internal() : word_count(0) { }
+
+    /// Add @a word to the lexicon.
+    void add_word(const std::string & word);
+
+    /// Return the number of words in the lexicon.
+    size_t size() const { return word_count; }
+
+    /** Read the word starting at @a it.
+     *
+     *  This is the longest word from the lexicon starting at @a it, or the
+     *  next character if no word in the lexicon matches.
+     *
+     *  @param[in,out] it	Where to start.  Set to just after the word.
+     *  @param[out] word	Set to the word.
+     *
+     *  @return The length of the word in Unicode characters.
+     */
+    unsigned next_word(Xapian::Utf8Iterator & it, std::string & word) const;
+};
+
 class CJKTokenIterator {
     Xapian::Utf8Iterator it;
 
+    /// The lexicon to split words with, or NULL to generate n-grams.
+    const Xapian::CJKSegmenter::Internal * words;
+
     mutable Xapian::Utf8Iterator p;
 
     mutable unsigned len;
@@ -58,14 +99,16 @@ class CJKTokenIterator {
     mutable std::string current_token;
 
   public:
-    CJKTokenIterator(const std::string & s)
-	: it(s) { }
+    CJKTokenIterator(const std::string & s,
+		     const Xapian::CJKSegmenter::Internal * words_ = NULL)
+	: it(s), words(words_) { }
 
-    CJKTokenIterator(const Xapian::Utf8Iterator & it_)
-	: it(it_) { }
+    CJKTokenIterator(const Xapian::Utf8Iterator & it_,
+		     const Xapian::CJKSegmenter::Internal * words_ = NULL)
+	: it(it_), words(words_) { }
 
     CJKTokenIterator()
-	: it() { }
+	: it(), words(NULL) { }
 
     const std::string & operator*() const;
 
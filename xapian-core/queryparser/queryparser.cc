@@ -91,6 +91,12 @@ QueryParser::set_stopper(const Stopper * stopper)
     internal->stopper = stopper;
 }
 
+void
+QueryParser::set_cjk_segmenter(const Xapian::CJKSegmenter & segmenter)
+{
+    internal->cjk_words = segmenter.internal;
+}
+
 void
 QueryParser::set_default_op(Query::op default_op)
 {
@@ -29,6 +29,8 @@
 #include <xapian/queryparser.h>
 #include <xapian/stem.h>
 
+#include "cjk-tokenizer.h"
+
 #include <list>
 #include <map>
 
@@ -88,6 +90,9 @@ class QueryParser::Internal : public Xapian::Internal::intrusive_base {
 
     Xapian::termcount max_wildcard_expansion;
 
+    /// The lexicon to split CJK text with, or NULL to use n-grams.
+    Xapian::Internal::intrusive_ptr<CJKSegmenter::Internal> cjk_words;
+
     void add_prefix(const string &field, const string &prefix,
 		    filter_type type);
 
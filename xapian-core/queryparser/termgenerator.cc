@@ -55,6 +55,12 @@ TermGenerator::set_stopper(const Xapian::Stopper * stopper)
     internal->stopper = stopper;
 }
 
+void
+TermGenerator::set_cjk_segmenter(const Xapian::CJKSegmenter & segmenter)
+{
+    internal->cjk_words = segmenter.internal;
+}
+
 void
 TermGenerator::set_document(const Xapian::Document & doc)
 {
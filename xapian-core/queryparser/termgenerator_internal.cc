@@ -47,6 +47,64 @@ inline unsigned check_wordchar(unsigned ch) {
     return 0;
 }
 
+/// Is @a ch an ASCII character for which Unicode::is_wordchar() is true?
+inline bool
+is_ascii_wordchar(char ch) {
+    return C_isalnum(ch) || ch == '_';
+}
+
+/** Advance @a itor to the next word character.
+ *
+ *  @return	The word character converted to lower case, or 0 if the end of
+ *		the text was reached.
+ */
+inline unsigned
+skip_to_wordchar(Utf8Iterator & itor)
+{
+    while (itor != Utf8Iterator()) {
+	// Most text is largely ASCII, so skip runs of ASCII characters which
+	// aren't word characters without decoding each one and looking it up
+	// in the Unicode tables.
+	const char * p = itor.raw();
+	const char * end = p + itor.left();
+	while (static_cast<unsigned char>(*p) < 128 && !is_ascii_wordchar(*p)) {
+	    if (++p == end) return 0;
+	}
+	if (p != itor.raw()) itor.assign(p, end - p);
+
+	unsigned ch = check_wordchar(*itor);
+	if (ch) return ch;
+	++itor;
+    }
+    return 0;
+}
+
+/** Append any run of ASCII word characters at @a itor to @a term.
+ *
+ *  The characters are converted to lower case, and @a itor is advanced past
+ *  them.
+ *
+ *  @return	The last character appended, or 0 if there wasn't a run.
+ */
+inline unsigned
+append_ascii_run(string & term, Utf8Iterator & itor)
+{
+    if (itor == Utf8Iterator()) return 0;
+    const char * start = itor.raw();
+    const char * end = start + itor.left();
+    const char * p = start;
+    while (p != end && is_ascii_wordchar(*p)) ++p;
+    if (p == start) return 0;
+
+    size_t old_size = term.size();
+    term.append(start, p - start);
+    for (string::iterator i = term.begin() + old_size; i != term.end(); ++i) {
+	*i = C_tolower(*i);
+    }
+    itor.assign(p, end - p);
+    return static_cast<unsigned char>(term[term.size() - 1]);
+}
+
 inline bool
 should_stem(const std::string & term)
 {
@@ -121,7 +179,8 @@ void
 TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 				    const string & prefix, bool with_positions)
 {
-    bool cjk_ngram = CJK::is_cjk_enabled();
+    const CJKSegmenter::Internal * words = cjk_words.get();
+    bool cjk_ngram = words || CJK::is_cjk_enabled();
 
     int stop_mode = STOPWORDS_INDEX_UNSTEMMED_ONLY;
 
@@ -129,13 +188,8 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 
     while (true) {
 	// Advance to the start of the next term.
-	unsigned ch;
-	while (true) {
-	    if (itor == Utf8Iterator()) return;
-	    ch = check_wordchar(*itor);
-	    if (ch) break;
-	    ++itor;
-	}
+	unsigned ch = skip_to_wordchar(itor);
+	if (!ch) return;
 
 	string term;
 	// Look for initials separated by '.' (e.g. P.T.O., U.N.C.L.E).
@@ -164,7 +218,8 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 		CJK::codepoint_is_cjk(*itor) &&
 		Unicode::is_wordchar(*itor)) {
 		const string & cjk = CJK::get_cjk(itor);
-		for (CJKTokenIterator tk(cjk); tk != CJKTokenIterator(); ++tk) {
+		CJKTokenIterator tk(cjk, words);
+		for ( ; tk != CJKTokenIterator(); ++tk) {
 		    const string & cjk_token = *tk;
 		    if (cjk_token.size() > max_word_length) continue;
 
@@ -173,7 +228,9 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 
 		    if (strategy == TermGenerator::STEM_SOME ||
 			strategy == TermGenerator::STEM_NONE) {
-			if (with_positions && tk.get_length() == 1) {
+			// With n-grams, only single characters get positions
+			// as phrases are matched character by character.
+			if (with_positions && (words || tk.get_length() == 1)) {
 			    doc.add_posting(prefix + cjk_token, ++termpos, wdf_inc);
 			} else {
 			    doc.add_term(prefix + cjk_token, wdf_inc);
@@ -211,19 +268,18 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 			doc.add_term(stem, wdf_inc);
 		    }
 		}
-		while (true) {
-		    if (itor == Utf8Iterator()) return;
-		    ch = check_wordchar(*itor);
-		    if (ch) break;
-		    ++itor;
-		}
+		ch = skip_to_wordchar(itor);
+		if (!ch) return;
 		continue;
 	    }
 	    unsigned prevch;
 	    do {
 		Unicode::append_utf8(term, ch);
 		prevch = ch;
-		if (++itor == Utf8Iterator() ||
+		++itor;
+		unsigned lastch = append_ascii_run(term, itor);
+		if (lastch) prevch = lastch;
+		if (itor == Utf8Iterator() ||
 		    (cjk_ngram && CJK::codepoint_is_cjk(*itor)))
 		    goto endofterm;
 		ch = check_wordchar(*itor);
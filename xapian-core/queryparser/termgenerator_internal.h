@@ -27,6 +27,8 @@
 #include <xapian/termgenerator.h>
 #include <xapian/stem.h>
 
+#include "cjk-tokenizer.h"
+
 namespace Xapian {
 
 class Stopper;
@@ -42,6 +44,9 @@ class TermGenerator::Internal : public Xapian::Internal::intrusive_base {
     unsigned max_word_length;
     WritableDatabase db;
 
+    /// The lexicon to split CJK text with, or NULL to use n-grams.
+    Xapian::Internal::intrusive_ptr<CJKSegmenter::Internal> cjk_words;
+
   public:
     Internal() : strategy(STEM_SOME), stopper(NULL), termpos(0),
 	flags(TermGenerator::flags(0)), max_word_length(64) { }
@@ -1101,6 +1101,37 @@ DEFINE_TESTCASE(fetchdocs1, backend) {
     return true;
 }
 
+/// Check prefetched documents have the right data and values.
+DEFINE_TESTCASE(fetchdocs2, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query::MatchAll);
+
+    Xapian::MSet mset1 = enquire.get_mset(0, 20);
+    TEST_REL(mset1.size(), >, 2);
+    Xapian::MSet mset2 = enquire.get_mset(0, 20);
+    mset1.fetch();
+    // Fetch from a second MSet before documents from the first have been
+    // collected.
+    mset2.fetch(mset2[1], mset2[mset2.size() - 1]);
+
+    for (Xapian::MSetIterator i = mset1.begin(); i != mset1.end(); ++i) {
+	Xapian::Document doc = i.get_document();
+	Xapian::Document doc_db = db.get_document(*i);
+	TEST_EQUAL(doc.get_data(), doc_db.get_data());
+	TEST_EQUAL(doc.values_count(), doc_db.values_count());
+	TEST_EQUAL(doc.get_value(1), doc_db.get_value(1));
+    }
+    for (Xapian::MSetIterator i = mset2.begin(); i != mset2.end(); ++i) {
+	Xapian::Document doc = i.get_document();
+	Xapian::Document doc_db = db.get_document(*i);
+	TEST_EQUAL(doc.get_data(), doc_db.get_data());
+	TEST_EQUAL(doc.get_value(1), doc_db.get_value(1));
+    }
+
+    return true;
+}
+
 // test that searching for a term not in the database fails nicely
 DEFINE_TESTCASE(absentterm1, backend) {
     Xapian::Enquire enquire(get_database("apitest_simpledata"));
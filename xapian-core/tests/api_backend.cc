@@ -27,6 +27,7 @@
 #define XAPIAN_DEPRECATED(X) X
 #include <xapian.h>
 
+#include "filetests.h"
 #include "str.h"
 #include "testsuite.h"
 #include "testutils.h"
@@ -37,6 +38,8 @@
 #include "safesysstat.h"
 #include "safeunistd.h"
 
+#include <sstream>
+
 using namespace std;
 
 /// Regression test - lockfile should honour umask, was only user-readable.
@@ -316,11 +319,14 @@ DEFINE_TESTCASE(replacedoc8, writable) {
 }
 
 /// Test coverage for DatabaseModifiedError.
-DEFINE_TESTCASE(databasemodified1, writable && !inmemory && !remote) {
+DEFINE_TESTCASE(databasemodified1, writable && !inmemory && !remote && !brass) {
     // The inmemory backend doesn't support revisions.
     //
     // The remote backend doesn't work as expected here, I think due to
     // test harness issues.
+    //
+    // With brass, a reader in the same process as the writer doesn't get
+    // DatabaseModifiedError - see snapshotpin1.
     Xapian::WritableDatabase db(get_writable_database());
     Xapian::Document doc;
     doc.set_data("cargo");
@@ -358,9 +364,157 @@ DEFINE_TESTCASE(databasemodified1, writable && !inmemory && !remote) {
     return true;
 }
 
+/// Test that brass readers aren't affected by a writer in the same process.
+DEFINE_TESTCASE(snapshotpin1, brass) {
+    Xapian::WritableDatabase db(get_writable_database());
+    Xapian::Document doc;
+    doc.set_data("cargo");
+    doc.add_term("abc");
+    doc.add_term("def");
+    doc.add_term("ghi");
+    const int N = 500;
+    for (int i = 0; i < N; ++i) {
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Database rodb(get_writable_database_as_database());
+    TEST(!rodb.reopen());
+
+    // Modify the database over several revisions, so blocks the reader is
+    // using would usually be reused.
+    Xapian::Document doc2;
+    doc2.set_data("freight");
+    doc2.add_term("xyz");
+    for (Xapian::docid did = 1; did <= 5; ++did) {
+	db.replace_document(did, doc2);
+	db.add_document(doc);
+	db.commit();
+    }
+    db.replace_document(N - 1, doc2);
+
+    TEST_EQUAL(rodb.get_doccount(), N);
+    TEST_EQUAL(*rodb.termlist_begin(N - 1), "abc");
+    TEST_EQUAL(rodb.get_document(1).get_data(), "cargo");
+    TEST_EQUAL(rodb.get_termfreq("xyz"), 0);
+    Xapian::Enquire enq(rodb);
+    enq.set_query(Xapian::Query("abc"));
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 10);
+    TEST_EQUAL(mset.get_matches_estimated(), N);
+
+    // reopen() should pick up the latest committed revision.
+    TEST(rodb.reopen());
+    TEST_EQUAL(rodb.get_doccount(), N + 5);
+    TEST_EQUAL(rodb.get_termfreq("xyz"), 5);
+    TEST_EQUAL(rodb.get_document(1).get_data(), "freight");
+
+    // Nothing new has been committed.
+    TEST(!rodb.reopen());
+
+    return true;
+}
+
+/// Test that blocks pinned for a reader are released when it reopens.
+DEFINE_TESTCASE(snapshotpin2, brass) {
+    Xapian::WritableDatabase db = get_named_writable_database("snapshotpin2");
+    const string path = get_named_writable_database_path("snapshotpin2");
+    Xapian::Document doc;
+    doc.set_data(string(200, 'x'));
+    doc.add_term("abc");
+    const Xapian::docid N = 200;
+    for (Xapian::docid did = 1; did <= N; ++did) {
+	db.add_document(doc);
+    }
+    db.commit();
+
+    // A reader which stays at the first revision throughout.
+    Xapian::Database old_db(path);
+    // A reader which keeps up with the writer.
+    Xapian::Database rodb(path);
+    // A reader which opens a later revision and then stays there, so it
+    // needs blocks which the first reader doesn't.
+    Xapian::Database mid_db;
+
+    off_t size = 0;
+    for (int i = 0; i < 40; ++i) {
+	doc.set_data(string(200, 'a' + i % 26));
+	for (Xapian::docid did = 1; did <= N; ++did) {
+	    db.replace_document(did, doc);
+	}
+	db.commit();
+	TEST(rodb.reopen());
+	TEST_EQUAL(rodb.get_document(N).get_data()[0], 'a' + i % 26);
+	if (i == 4) mid_db = Xapian::Database(path);
+	if (i == 9) size = file_size(path + "/record.DB");
+    }
+
+    // Only the blocks of the revisions the readers have open should be kept,
+    // so the table shouldn't keep growing as the second reader reopens.
+    off_t final_size = file_size(path + "/record.DB");
+    tout << "record.DB size after 10 commits " << size << ", after 40 "
+	 << final_size << endl;
+    TEST_REL(final_size, <=, size + size / 10);
+
+    TEST_EQUAL(old_db.get_document(N).get_data(), string(200, 'x'));
+    for (Xapian::docid did = 1; did <= N; ++did) {
+	TEST_EQUAL(mid_db.get_document(did).get_data(), string(200, 'e'));
+    }
+
+    return true;
+}
+
+/// Test that a brass commit which fails partway through is cleanly abandoned.
+DEFINE_TESTCASE(failedcommit1, brass) {
+    Xapian::Document doc;
+    doc.add_term("foo");
+    {
+	Xapian::WritableDatabase db =
+	    get_named_writable_database("failedcommit1");
+	db.add_document(doc);
+	db.commit();
+    }
+    string path = get_named_writable_database_path("failedcommit1");
+
+    // A directory where the termlist table's new base file would be written
+    // makes its commit fail after the postlist and position tables have
+    // started to commit.
+    string blocker = path + "/termlist.tmp";
+    TEST_EQUAL(mkdir(blocker.c_str(), 0755), 0);
+    {
+	Xapian::WritableDatabase db(path, Xapian::DB_OPEN);
+	doc.add_term("bar");
+	db.add_document(doc);
+	TEST_EXCEPTION(Xapian::DatabaseError, db.commit());
+    }
+    TEST_EQUAL(rmdir(blocker.c_str()), 0);
+
+    // The new base files for the tables which had started to commit should
+    // have been removed.
+    TEST(!file_exists(path + "/postlist.tmp"));
+    TEST(!file_exists(path + "/position.tmp"));
+
+    // The database should still be at the last committed revision, and be
+    // usable.
+    {
+	Xapian::WritableDatabase db(path, Xapian::DB_OPEN);
+	TEST_EQUAL(db.get_doccount(), 1);
+	TEST_EQUAL(db.get_termfreq("bar"), 0);
+	db.add_document(doc);
+	db.commit();
+    }
+    Xapian::Database db(path);
+    TEST_EQUAL(db.get_doccount(), 2);
+    TEST_EQUAL(db.get_termfreq("bar"), 1);
+    TEST_EQUAL(Xapian::Database::check(path, 0, tout), 0);
+
+    return true;
+}
+
 /// Regression test for bug#462 fixed in 1.0.19 and 1.1.5.
-DEFINE_TESTCASE(qpmemoryleak1, writable && !inmemory) {
-    // Inmemory never throws DatabaseModifiedError.
+DEFINE_TESTCASE(qpmemoryleak1, writable && !inmemory && !brass) {
+    // Inmemory never throws DatabaseModifiedError, and nor does brass when
+    // the writer is in the same process.
     Xapian::WritableDatabase wdb(get_writable_database());
     Xapian::Document doc;
 
@@ -844,3 +998,523 @@ DEFINE_TESTCASE(msetweights1, backend) {
 
     return true;
 }
+
+/// Check Enquire::get_msets() gives the same results as get_mset().
+DEFINE_TESTCASE(getmsets1, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enq(db);
+
+    vector<Xapian::Query> queries;
+    queries.push_back(Xapian::Query("paragraph"));
+    queries.push_back(Xapian::Query::MatchNothing);
+    queries.push_back(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("paragraph"),
+				    Xapian::Query("word")));
+    queries.push_back(Xapian::Query(Xapian::Query::OP_AND,
+				    Xapian::Query("this"),
+				    Xapian::Query("one")));
+    queries.push_back(Xapian::Query("nosuchterm"));
+
+    enq.set_query(Xapian::Query("word"));
+    vector<Xapian::MSet> msets = enq.get_msets(queries, 0, 10);
+    TEST_EQUAL(msets.size(), queries.size());
+    // The query set with set_query() should be unchanged.
+    TEST_EQUAL(enq.get_query().get_description(),
+	       Xapian::Query("word").get_description());
+
+    for (size_t i = 0; i != queries.size(); ++i) {
+	tout << queries[i] << endl;
+	enq.set_query(queries[i]);
+	Xapian::MSet mset = enq.get_mset(0, 10);
+	TEST_EQUAL(msets[i], mset);
+    }
+
+    // A continuation token only applies to the query it came from.
+    enq.set_continuation(msets[0].get_continuation());
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   enq.get_msets(queries, 0, 10));
+    enq.set_continuation(string());
+
+    // An empty batch gives an empty result.
+    queries.clear();
+    TEST(enq.get_msets(queries, 0, 10).empty());
+
+    return true;
+}
+
+/// Check cached term statistics are refreshed by reopen() and commit().
+DEFINE_TESTCASE(termstatscache1, writable && !inmemory) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Database dbr(get_writable_database_as_database());
+
+    Xapian::Document doc;
+    doc.add_term("foo", 2);
+    db.add_document(doc);
+    db.commit();
+    TEST_EQUAL(dbr.get_termfreq("foo"), 0);
+    TEST_EQUAL(dbr.get_collection_freq("foo"), 0);
+
+    TEST(dbr.reopen());
+    TEST_EQUAL(dbr.get_termfreq("foo"), 1);
+    TEST_EQUAL(dbr.get_collection_freq("foo"), 2);
+    // Check the cached values are returned.
+    TEST_EQUAL(dbr.get_termfreq("foo"), 1);
+    TEST_EQUAL(dbr.get_collection_freq("foo"), 2);
+
+    TEST_EQUAL(db.get_termfreq("foo"), 1);
+    db.add_document(doc);
+    TEST_EQUAL(db.get_termfreq("foo"), 2);
+    db.commit();
+    TEST_EQUAL(db.get_termfreq("foo"), 2);
+    TEST_EQUAL(db.get_collection_freq("foo"), 4);
+    db.add_document(doc);
+    db.commit();
+    TEST_EQUAL(db.get_termfreq("foo"), 3);
+    TEST_EQUAL(db.get_collection_freq("foo"), 6);
+
+    // The reader shouldn't see the changes until reopen().
+    TEST_EQUAL(dbr.get_termfreq("foo"), 1);
+    TEST(dbr.reopen());
+    TEST_EQUAL(dbr.get_termfreq("foo"), 3);
+    TEST_EQUAL(dbr.get_collection_freq("foo"), 6);
+
+    // Changing one term should only refresh the statistics for that term.
+    Xapian::Document doc2;
+    doc2.add_term("bar", 3);
+    db.add_document(doc2);
+    db.commit();
+    TEST_EQUAL(db.get_termfreq("bar"), 1);
+    TEST_EQUAL(db.get_collection_freq("bar"), 3);
+    db.add_document(doc);
+    db.commit();
+    TEST_EQUAL(db.get_termfreq("foo"), 4);
+    TEST_EQUAL(db.get_collection_freq("foo"), 8);
+    TEST_EQUAL(db.get_termfreq("bar"), 1);
+    TEST_EQUAL(db.get_collection_freq("bar"), 3);
+    db.add_document(doc2);
+    db.commit();
+    TEST_EQUAL(db.get_termfreq("foo"), 4);
+    TEST_EQUAL(db.get_termfreq("bar"), 2);
+    TEST_EQUAL(db.get_collection_freq("bar"), 6);
+
+    return true;
+}
+
+/// Check Enquire::prepare_mset() doesn't change the results.
+DEFINE_TESTCASE(preparemset1, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				Xapian::Query("paragraph"),
+				Xapian::Query("word")));
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    Xapian::MSet mset_page = enq.get_mset(2, 3);
+    Xapian::RSet rset;
+    rset.add_document(1);
+    Xapian::MSet mset_rset = enq.get_mset(0, 10, &rset);
+
+    enq.prepare_mset();
+    TEST_EQUAL(enq.get_mset(0, 10), mset);
+    TEST_EQUAL(enq.get_mset(2, 3), mset_page);
+    // A different RSet needs different statistics.
+    TEST_EQUAL(enq.get_mset(0, 10, &rset), mset_rset);
+    TEST_EQUAL(enq.get_mset(0, 10), mset);
+
+    enq.prepare_mset(&rset);
+    TEST_EQUAL(enq.get_mset(0, 10, &rset), mset_rset);
+    TEST_EQUAL(enq.get_mset(0, 10), mset);
+
+    // Setting a new query discards the prepared statistics.
+    enq.prepare_mset();
+    enq.set_query(Xapian::Query("this"));
+    Xapian::MSet mset2 = enq.get_mset(0, 10);
+    enq.prepare_mset();
+    TEST_EQUAL(enq.get_mset(0, 10), mset2);
+
+    return true;
+}
+
+/// Check prepared statistics are discarded when the database changes.
+DEFINE_TESTCASE(preparemset2, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("foo");
+    doc.add_term("bar");
+    db.add_document(doc);
+    db.commit();
+
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("foo"));
+    enq.prepare_mset();
+    TEST_EQUAL(enq.get_mset(0, 10).get_termfreq("foo"), 1);
+
+    doc.add_term("baz");
+    db.add_document(doc);
+    db.commit();
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 2);
+    TEST_EQUAL(mset.get_termfreq("foo"), 2);
+
+    return true;
+}
+
+/// Check changes which don't alter the document count or length are noticed.
+DEFINE_TESTCASE(preparemset3, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("foo");
+    doc.add_term("bar");
+    db.add_document(doc);
+    Xapian::Document doc2;
+    doc2.add_term("baz");
+    doc2.add_term("qux");
+    db.add_document(doc2);
+    db.commit();
+
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("foo"));
+    enq.prepare_mset();
+    TEST_EQUAL(enq.get_mset(0, 10).get_termfreq("foo"), 1);
+
+    // Replace the second document with one of the same length which also
+    // indexes "foo".
+    db.replace_document(2, doc);
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 2);
+    TEST_EQUAL(mset.get_termfreq("foo"), 2);
+
+    return true;
+}
+
+/// Check prepared statistics are discarded when the database is reopened.
+DEFINE_TESTCASE(preparemset4, writable && !inmemory) {
+    Xapian::WritableDatabase wdb = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("foo");
+    doc.add_term("bar");
+    wdb.add_document(doc);
+    wdb.commit();
+
+    Xapian::Database db = get_writable_database_as_database();
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("bar"));
+    enq.prepare_mset();
+    TEST_EQUAL(enq.get_mset(0, 10).get_termfreq("bar"), 1);
+
+    Xapian::Document doc2;
+    doc2.add_term("baz");
+    doc2.add_term("qux");
+    wdb.replace_document(1, doc2);
+    wdb.commit();
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_doccount(), 1);
+    TEST_EQUAL(db.get_avlength(), 2);
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 0);
+    TEST_EQUAL(mset.get_termfreq("bar"), 0);
+
+    return true;
+}
+
+/** Check paging through @a enq with continuations gives the same results as
+ *  fetching them in one go.
+ */
+static void
+check_continuation(Xapian::Enquire & enq, Xapian::doccount pagesize)
+{
+    enq.set_continuation(string());
+    Xapian::MSet all = enq.get_mset(0, 1000);
+    Xapian::doccount matches = all.get_matches_estimated();
+    TEST_EQUAL(all.size(), matches);
+
+    Xapian::MSetIterator i = all.begin();
+    while (true) {
+	Xapian::MSet page = enq.get_mset(0, pagesize);
+	tout << page << endl;
+	TEST_REL(page.get_matches_lower_bound(),<=,matches);
+	TEST_REL(page.get_matches_upper_bound(),>=,matches);
+	for (Xapian::MSetIterator j = page.begin(); j != page.end(); ++j) {
+	    TEST(i != all.end());
+	    TEST_EQUAL(*j, *i);
+	    TEST_EQUAL_DOUBLE(j.get_weight(), i.get_weight());
+	    ++i;
+	}
+	if (page.size() < pagesize) break;
+	enq.set_continuation(page.get_continuation());
+    }
+    TEST(i == all.end());
+    enq.set_continuation(string());
+}
+
+/// Check paging with MSet::get_continuation() by relevance.
+DEFINE_TESTCASE(continuation1, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				Xapian::Query("paragraph"),
+				Xapian::Query("word")));
+    for (Xapian::doccount pagesize = 1; pagesize <= 4; ++pagesize) {
+	check_continuation(enq, pagesize);
+    }
+
+    // A continuation from an empty MSet is empty, which means "start again".
+    Xapian::MSet mset = enq.get_mset(0, 0);
+    TEST(mset.get_continuation().empty());
+
+    mset = enq.get_mset(0, 2);
+    enq.set_continuation(mset.get_continuation());
+    // Paging with first still works, relative to the continuation point.
+    Xapian::MSet mset2 = enq.get_mset(0, 10);
+    Xapian::MSet mset3 = enq.get_mset(1, 10);
+    TEST_EQUAL(mset3.size() + 1, mset2.size());
+    TEST_EQUAL(*mset3.begin(), *mset2[1]);
+
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, enq.set_continuation("x"));
+
+    // Collapsing isn't supported with a continuation.
+    enq.set_collapse_key(1);
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, enq.get_mset(0, 10));
+    enq.set_continuation(string());
+    (void)enq.get_mset(0, 10);
+
+    return true;
+}
+
+/// Check paging with continuations when sorting and with ties.
+DEFINE_TESTCASE(continuation2, generated) {
+    Xapian::Database db = get_database("msize1", make_msize1_db);
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("K1"));
+
+    // Lots of documents have the same value in slot 1, so this checks the
+    // docid tie-breaking.
+    enq.set_sort_by_value(1, false);
+    check_continuation(enq, 3);
+    enq.set_docid_order(enq.DESCENDING);
+    check_continuation(enq, 3);
+    enq.set_sort_by_value_then_relevance(1, true);
+    check_continuation(enq, 4);
+    enq.set_docid_order(enq.ASCENDING);
+    check_continuation(enq, 4);
+
+    // A boolean match in docid order can skip to the continuation point.
+    enq.set_sort_by_relevance();
+    enq.set_query(Xapian::Query(Xapian::Query::OP_SCALE_WEIGHT,
+				Xapian::Query("K1"), 0.0));
+    check_continuation(enq, 5);
+    enq.set_query(Xapian::Query::MatchAll);
+    check_continuation(enq, 7);
+    enq.set_docid_order(enq.DESCENDING);
+    check_continuation(enq, 7);
+
+    return true;
+}
+
+/// Check lists which need more than one batch with the remote backend.
+DEFINE_TESTCASE(longlists1, writable && metadata && positional && !inmemory) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document bigdoc;
+    for (Xapian::termpos i = 1; i <= 5000; ++i) {
+	bigdoc.add_posting("pos", i * 3);
+	bigdoc.add_term("term" + str(i), i);
+    }
+    db.add_document(bigdoc);
+    for (Xapian::docid did = 2; did <= 5000; ++did) {
+	Xapian::Document doc;
+	doc.add_term("all", did % 7 + 1);
+	db.add_document(doc);
+	db.set_metadata("key" + str(did), "x");
+    }
+    db.commit();
+
+    Xapian::doccount count = 0;
+    for (Xapian::PostingIterator p = db.postlist_begin("all");
+	 p != db.postlist_end("all"); ++p) {
+	++count;
+	TEST_EQUAL(*p, count + 1);
+	TEST_EQUAL(p.get_wdf(), (count + 1) % 7 + 1);
+    }
+    TEST_EQUAL(count, 4999);
+
+    count = 0;
+    for (Xapian::TermIterator t = db.termlist_begin(1);
+	 t != db.termlist_end(1); ++t) {
+	if (*t == "pos") continue;
+	++count;
+	TEST_EQUAL(*t, "term" + str(t.get_wdf()));
+    }
+    TEST_EQUAL(count, 5000);
+
+    Xapian::termpos last = 0;
+    for (Xapian::PositionIterator p = db.positionlist_begin(1, "pos");
+	 p != db.positionlist_end(1, "pos"); ++p) {
+	TEST_EQUAL(*p, last + 3);
+	last = *p;
+    }
+    TEST_EQUAL(last, 15000);
+
+    count = 0;
+    string prev;
+    for (Xapian::TermIterator t = db.allterms_begin("term");
+	 t != db.allterms_end("term"); ++t) {
+	++count;
+	TEST_REL(prev,<,*t);
+	TEST_EQUAL(t.get_termfreq(), 1);
+	prev = *t;
+    }
+    TEST_EQUAL(count, 5000);
+
+    count = 0;
+    for (Xapian::TermIterator t = db.metadata_keys_begin("key");
+	 t != db.metadata_keys_end("key"); ++t) {
+	++count;
+	TEST_EQUAL((*t).substr(0, 3), "key");
+    }
+    TEST_EQUAL(count, 4999);
+
+    return true;
+}
+
+/// Check the bounded memory mode of Database::check() gives the same result.
+DEFINE_TESTCASE(dbchecklowmemory1, brass) {
+    {
+	Xapian::WritableDatabase db =
+	    get_named_writable_database("dbchecklowmemory1");
+	Xapian::Document doc;
+	doc.add_term("foo", 2);
+	doc.add_term("bar");
+	for (int i = 0; i < 100; ++i) {
+	    db.add_document(doc);
+	    doc.add_term("t" + str(i), i + 1);
+	}
+	// A document with no terms has no termlist entry.
+	db.add_document(Xapian::Document());
+	db.delete_document(7);
+	db.replace_document(1000, doc);
+	db.commit();
+    }
+    string path = get_named_writable_database_path("dbchecklowmemory1");
+
+    ostringstream out;
+    TEST_EQUAL(Xapian::Database::check(path, 0, out), 0);
+    out.str(string());
+    TEST_EQUAL(Xapian::Database::check(path, Xapian::DBCHECK_LOW_MEMORY, out),
+	       0);
+    tout << out.str();
+    TEST(out.str().find("postlist table structure checked OK") !=
+	 string::npos);
+
+    return true;
+}
+
+/// Add documents @a first to @a last with data which doesn't compress much.
+static void
+add_bitmap_docs(Xapian::WritableDatabase & db,
+		Xapian::docid first, Xapian::docid last)
+{
+    for (Xapian::docid did = first; did <= last; ++did) {
+	string data;
+	unsigned seed = did;
+	for (int i = 0; i < 2000; ++i) {
+	    seed = seed * 1103515245 + 12345;
+	    data += char('a' + (seed >> 16) % 26);
+	}
+	Xapian::Document doc;
+	doc.set_data(data);
+	doc.add_term("Q" + str(did));
+	db.replace_document(did, doc);
+    }
+}
+
+/// Check the database at @a path and return the size of its record table.
+static off_t
+check_bitmap_db(const string & path, Xapian::doccount doccount)
+{
+    ostringstream out;
+    TEST_EQUAL(Xapian::Database::check(path, 0, out), 0);
+    Xapian::Database db(path);
+    TEST_EQUAL(db.get_doccount(), doccount);
+    return file_size(path + "/record.DB");
+}
+
+/** Check the free block bit map stays consistent across commits.
+ *
+ *  Each step changes a different part of the bit map, so the range of it
+ *  which changed and the lowest byte in which a block was freed are
+ *  sometimes within a single byte and sometimes far apart.  Database::check()
+ *  fails if any block in use isn't marked as used, or vice versa.
+ */
+DEFINE_TESTCASE(bitmapcommit1, brass) {
+    Xapian::WritableDatabase db = get_named_writable_database("bitmapcommit1");
+    const string path = get_named_writable_database_path("bitmapcommit1");
+
+    // With 8K blocks, this needs several bytes of bit map.
+    add_bitmap_docs(db, 1, 2000);
+    db.commit();
+    off_t size = check_bitmap_db(path, 2000);
+
+    // Free blocks at the start, and allocate some at the end (the blocks
+    // just freed can't be reused until we commit).
+    for (Xapian::docid did = 1; did <= 200; ++did) {
+	db.delete_document(did);
+    }
+    add_bitmap_docs(db, 2001, 2100);
+    db.commit();
+    off_t new_size = check_bitmap_db(path, 1900);
+    TEST_REL(new_size, >, size);
+    size = new_size;
+
+    // The blocks freed by the previous commit should be reused now.
+    add_bitmap_docs(db, 1, 100);
+    db.commit();
+    new_size = check_bitmap_db(path, 2000);
+    TEST_EQUAL(new_size, size);
+
+    // Free and allocate blocks in the same byte of the bit map.
+    db.delete_document(50);
+    add_bitmap_docs(db, 50, 50);
+    db.commit();
+    check_bitmap_db(path, 2000);
+
+    // Free the blocks at the end of the table, which shrinks the bit map.
+    for (Xapian::docid did = 1001; did <= 2100; ++did) {
+	db.delete_document(did);
+    }
+    db.commit();
+    check_bitmap_db(path, 900);
+
+    // And then grow it again.
+    add_bitmap_docs(db, 3001, 4000);
+    db.commit();
+    check_bitmap_db(path, 1900);
+
+    // Blocks allocated in a cancelled transaction should be free again.
+    db.begin_transaction();
+    add_bitmap_docs(db, 5001, 5500);
+    for (Xapian::docid did = 201; did <= 300; ++did) {
+	db.delete_document(did);
+    }
+    db.cancel_transaction();
+    add_bitmap_docs(db, 4001, 4200);
+    db.commit();
+    check_bitmap_db(path, 2100);
+
+    // Reopen the table, so the bit map is read back from the base file.
+    db.close();
+    db = Xapian::WritableDatabase(path, Xapian::DB_OPEN);
+    for (Xapian::docid did = 500; did <= 1000; ++did) {
+	db.delete_document(did);
+    }
+    for (Xapian::docid did = 3001; did <= 3500; ++did) {
+	db.delete_document(did);
+    }
+    // Replace some documents too.
+    add_bitmap_docs(db, 1, 10);
+    db.commit();
+    check_bitmap_db(path, 1099);
+    add_bitmap_docs(db, 500, 600);
+    db.commit();
+    check_bitmap_db(path, 1200);
+
+    return true;
+}
@@ -37,6 +37,7 @@
 
 #include "backendmanager.h"
 #include "backendmanager_local.h"
+#include "stringutils.h"
 #include "testsuite.h"
 #include "testutils.h"
 #include "unixcmds.h"
@@ -901,6 +902,87 @@ DEFINE_TESTCASE(keepalive1, remote) {
     return true;
 }
 
+#ifdef __WIN32__
+# define set_remote_pool_size(N) _putenv_s("XAPIAN_REMOTE_POOL_SIZE", N)
+#elif defined HAVE_SETENV
+# define set_remote_pool_size(N) setenv("XAPIAN_REMOTE_POOL_SIZE", N, 1)
+#else
+# define set_remote_pool_size(N) \
+    putenv(const_cast<char*>("XAPIAN_REMOTE_POOL_SIZE="N))
+#endif
+
+struct unset_remote_pool_size_helper_ {
+    unset_remote_pool_size_helper_() { }
+    ~unset_remote_pool_size_helper_() { set_remote_pool_size(""); }
+};
+
+/// Return the lowest numbered file descriptor which isn't in use.
+static int
+lowest_free_fd()
+{
+    int fd = dup(0);
+    if (fd != -1) close(fd);
+    return fd;
+}
+
+/// Check an idle pooled connection is reused.
+DEFINE_TESTCASE(remotepool1, remote) {
+    if (!startswith(get_dbtype(), "remotetcp"))
+	SKIP_TEST("Only TCP connections are pooled");
+
+    unset_remote_pool_size_helper_ unset_remote_pool_size_helper;
+    set_remote_pool_size("1");
+    {
+	Xapian::Database db(get_remote_database("apitest_simpledata", 300000));
+	TEST_EQUAL(db.get_doccount(), 6);
+    }
+    // The connection is now in the pool, so reconnecting shouldn't need a
+    // new socket.  The server is --one-shot so it wouldn't accept another
+    // connection anyway.
+    int fd = lowest_free_fd();
+    Xapian::Database db(reconnect_remote_database());
+    TEST_EQUAL(lowest_free_fd(), fd);
+    TEST_EQUAL(db.get_doccount(), 6);
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("word"));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 2);
+
+    // Don't pool this connection, or the testsuite will report it as a
+    // leaked fd.
+    set_remote_pool_size("");
+
+    return true;
+}
+
+/// Check a reused connection sees changes committed while it was pooled.
+DEFINE_TESTCASE(remotepool2, remote && writable) {
+    if (!startswith(get_dbtype(), "remotetcp"))
+	SKIP_TEST("Only TCP connections are pooled");
+
+    unset_remote_pool_size_helper_ unset_remote_pool_size_helper;
+    set_remote_pool_size("1");
+    Xapian::WritableDatabase wdb = get_writable_database();
+    {
+	Xapian::Database db(get_writable_database_as_database());
+	TEST_EQUAL(db.get_doccount(), 0);
+    }
+    wdb.add_document(Xapian::Document());
+    wdb.commit();
+
+    // Reusing the pooled connection should update it to the new revision.
+    int fd = lowest_free_fd();
+    Xapian::Database db(reconnect_remote_database());
+    TEST_EQUAL(lowest_free_fd(), fd);
+    TEST_EQUAL(db.get_doccount(), 1);
+
+    // Don't pool this connection, or the testsuite will report it as a
+    // leaked fd.
+    set_remote_pool_size("");
+
+    return true;
+}
+
 // test that iterating through all terms in a database works.
 DEFINE_TESTCASE(allterms1, backend) {
     Xapian::Database db(get_database("apitest_allterms"));
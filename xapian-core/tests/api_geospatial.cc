@@ -26,6 +26,7 @@
 #include <xapian.h>
 
 #include "apitest.h"
+#include "str.h"
 #include "testsuite.h"
 #include "testutils.h"
 
@@ -169,6 +170,98 @@ DEFINE_TESTCASE(latlongpostingsource1, backend && writable && !remote && !inmemo
     return true;
 }
 
+static void
+builddb_coords2(Xapian::WritableDatabase &db, const string &)
+{
+    // A grid of points around London, and some either side of the
+    // antimeridian.
+    for (int i = -20; i <= 20; ++i) {
+	for (int j = -20; j <= 20; ++j) {
+	    Xapian::LatLongCoords coords;
+	    coords.append(Xapian::LatLongCoord(51.5 + i * 0.013, j * 0.021));
+	    if (i == j) {
+		coords.append(Xapian::LatLongCoord(i * 0.013, 180 + j * 0.021));
+	    }
+	    Xapian::Document doc;
+	    doc.add_value(0, coords.serialise());
+	    Xapian::index_latlong_cells(doc, coords, "XG");
+	    db.add_document(doc);
+	}
+    }
+}
+
+static string
+latlong_ps_results(Xapian::LatLongDistancePostingSource & ps,
+		   const Xapian::Database & db)
+{
+    string result;
+    ps.init(db);
+    for (ps.next(0.0); !ps.at_end(); ps.next(0.0)) {
+	result += str(ps.get_docid());
+	result += ':';
+	result += str(ps.get_weight());
+	result += ' ';
+    }
+    return result;
+}
+
+/// Test LatLongDistancePostingSource with geohash cell terms.
+DEFINE_TESTCASE(latlongpostingsource2, backend && writable && !remote && !inmemory) {
+    Xapian::Database db = get_database("coords2", builddb_coords2, "");
+    Xapian::GreatCircleMetric metric;
+
+    const double centres[][2] = {
+	{ 51.5, 0.0 }, { 51.6, 0.2 }, { 0.0, 180.0 }, { 0.1, -179.9 }
+    };
+    const double ranges[] = { 10, 500, 2000, 5000, 20000, 1e6, 1e8 };
+    for (size_t c = 0; c != sizeof(centres) / sizeof(centres[0]); ++c) {
+	Xapian::LatLongCoord centre(centres[c][0], centres[c][1]);
+	for (size_t r = 0; r != sizeof(ranges) / sizeof(ranges[0]); ++r) {
+	    tout << centre.get_description() << " range " << ranges[r] << endl;
+	    Xapian::LatLongDistancePostingSource ps(0, centre, metric,
+						    ranges[r]);
+	    string expect = latlong_ps_results(ps, db);
+
+	    ps.set_cell_prefix("XG");
+	    TEST_STRINGS_EQUAL(latlong_ps_results(ps, db), expect);
+	    if (ranges[r] <= 5000) {
+		// Check that the cells actually narrowed down the candidates.
+		TEST_REL(ps.get_termfreq_max(),<,db.get_value_freq(0) / 4);
+	    } else {
+		TEST_REL(ps.get_termfreq_max(),<=,db.get_value_freq(0));
+	    }
+
+	    // Check that check() gives the same results.
+	    ps.init(db);
+	    string result;
+	    for (Xapian::docid did = 1; did <= db.get_lastdocid(); ++did) {
+		if (!ps.check(did, 0.0)) continue;
+		if (ps.at_end()) break;
+		did = ps.get_docid();
+		result += str(did);
+		result += ':';
+		result += str(ps.get_weight());
+		result += ' ';
+	    }
+	    TEST_STRINGS_EQUAL(result, expect);
+
+	    // Check the cell prefix survives serialisation.
+	    Xapian::Registry registry;
+	    Xapian::LatLongDistancePostingSource * ps2 =
+		ps.unserialise_with_registry(ps.serialise(), registry);
+	    TEST_STRINGS_EQUAL(ps2->serialise(), ps.serialise());
+	    // Serialising the centre loses a little precision, so the weights
+	    // may differ slightly from those we got with the original centre.
+	    string result2 = latlong_ps_results(*ps2, db);
+	    ps2->set_cell_prefix(string());
+	    TEST_STRINGS_EQUAL(result2, latlong_ps_results(*ps2, db));
+	    delete ps2;
+	}
+    }
+
+    return true;
+}
+
 // Test various methods of LatLongCoord and LatLongCoords
 DEFINE_TESTCASE(latlongcoords1, !backend) {
     LatLongCoord c1(0, 0);
@@ -296,6 +389,19 @@ DEFINE_TESTCASE(latlongmetric2, !backend) {
 }
 
 // Test a LatLongDistanceKeyMaker directly.
+/// A subclass of GreatCircleMetric which measures distances differently.
+class DoubledGreatCircleMetric : public Xapian::GreatCircleMetric {
+  public:
+    double pointwise_distance(const LatLongCoord & a,
+			      const LatLongCoord & b) const {
+	return 2 * Xapian::GreatCircleMetric::pointwise_distance(a, b);
+    }
+
+    Xapian::LatLongMetric * clone() const {
+	return new DoubledGreatCircleMetric;
+    }
+};
+
 DEFINE_TESTCASE(latlongkeymaker1, !backend) {
     Xapian::GreatCircleMetric m1(3310000);
     LatLongCoord c1(0, 0);
@@ -329,5 +435,11 @@ DEFINE_TESTCASE(latlongkeymaker1, !backend) {
     TEST_EQUAL(k3, k3b);
     TEST_REL(k3b, >, k4b);
 
+    // Check a subclass of GreatCircleMetric gets its distances used.
+    LatLongDistanceKeyMaker keymaker3(0, c1, DoubledGreatCircleMetric());
+    Xapian::GreatCircleMetric m2;
+    TEST_EQUAL(keymaker3(doc2),
+	       Xapian::sortable_serialise(2 * m2.pointwise_distance(c1, c3)));
+
     return true;
 }
@@ -1993,3 +1993,282 @@ DEFINE_TESTCASE(modifyvalues1, writable) {
 
     return true;
 }
+
+#ifdef __WIN32__
+# define set_flush_memory(N) _putenv_s("XAPIAN_FLUSH_MEMORY", N)
+#elif defined HAVE_SETENV
+# define set_flush_memory(N) setenv("XAPIAN_FLUSH_MEMORY", N, 1)
+#else
+# define set_flush_memory(N) putenv(const_cast<char*>("XAPIAN_FLUSH_MEMORY="N))
+#endif
+
+struct unset_flush_memory_helper_ {
+    unset_flush_memory_helper_() { }
+    ~unset_flush_memory_helper_() { set_flush_memory(""); }
+};
+
+/// Check XAPIAN_FLUSH_MEMORY triggers an automatic commit.
+DEFINE_TESTCASE(flushmemory1, brass) {
+    unset_flush_memory_helper_ unset_flush_memory_helper;
+    set_flush_memory("400K");
+    Xapian::WritableDatabase db = get_writable_database();
+    set_flush_memory("");
+
+    Xapian::Document doc;
+    for (Xapian::termcount i = 0; i < 1000; ++i) {
+	doc.add_term("term" + str(i));
+    }
+    // The document count threshold isn't used if only XAPIAN_FLUSH_MEMORY
+    // is set, so only the memory limit can cause a commit here.
+    for (int i = 0; i < 100; ++i) {
+	db.add_document(doc);
+    }
+
+    Xapian::Database db_r = get_writable_database_as_database();
+    TEST_REL(db_r.get_doccount(), >, 0);
+    TEST_REL(db_r.get_doccount(), <, 100);
+
+    // Replace documents in descending docid order so the buffered changes
+    // for each postlist aren't appended in ascending order.
+    Xapian::Document doc2;
+    doc2.add_term("term1", 2);
+    doc2.add_term("new");
+    for (Xapian::docid did = 100; did > 0; did -= 2) {
+	db.replace_document(did, doc2);
+    }
+    // And then change some of them back, so there are several changes
+    // buffered for the same documents.
+    for (Xapian::docid did = 10; did > 0; did -= 2) {
+	db.replace_document(did, doc);
+    }
+    db.commit();
+
+    db_r.reopen();
+    TEST_EQUAL(db_r.get_doccount(), 100);
+    TEST_EQUAL(db_r.get_termfreq("new"), 45);
+    TEST_EQUAL(db_r.get_termfreq("term0"), 55);
+    TEST_EQUAL(db_r.get_termfreq("term1"), 100);
+    TEST_EQUAL(db_r.get_collection_freq("term1"), 145);
+    Xapian::PostingIterator p = db_r.postlist_begin("new");
+    for (Xapian::docid did = 12; did <= 100; did += 2) {
+	TEST(p != db_r.postlist_end("new"));
+	TEST_EQUAL(*p, did);
+	++p;
+    }
+    TEST(p == db_r.postlist_end("new"));
+
+    return true;
+}
+
+/// Check buffered value changes count towards XAPIAN_FLUSH_MEMORY.
+DEFINE_TESTCASE(flushmemory2, brass) {
+    unset_flush_memory_helper_ unset_flush_memory_helper;
+    set_flush_memory("200K");
+    Xapian::WritableDatabase db = get_writable_database();
+    set_flush_memory("");
+
+    // The documents have a single term, so almost all the memory used by
+    // the buffered changes is for the values.
+    Xapian::Document doc;
+    doc.add_term("foo");
+    doc.add_value(0, string(10000, 'x'));
+    doc.add_value(1, string(10000, 'y'));
+    for (int i = 0; i < 100; ++i) {
+	db.add_document(doc);
+    }
+
+    Xapian::Database db_r = get_writable_database_as_database();
+    TEST_REL(db_r.get_doccount(), >, 0);
+    TEST_REL(db_r.get_doccount(), <, 100);
+    TEST_EQUAL(db_r.get_document(1).get_value(1), string(10000, 'y'));
+
+    db.commit();
+    db_r.reopen();
+    TEST_EQUAL(db_r.get_doccount(), 100);
+    TEST_EQUAL(db_r.get_value_freq(0), 100);
+
+    return true;
+}
+
+/// Check a XAPIAN_FLUSH_MEMORY value which is too large is ignored.
+DEFINE_TESTCASE(flushmemory3, brass) {
+    unset_flush_memory_helper_ unset_flush_memory_helper;
+    // (2**54 + 1) * 1024 wraps to 1024 in 64 bits, which would make us flush
+    // after every document if we didn't notice the overflow.
+    set_flush_memory("18014398509481985K");
+    Xapian::WritableDatabase db = get_writable_database();
+    set_flush_memory("");
+
+    Xapian::Document doc;
+    for (Xapian::termcount i = 0; i < 200; ++i) {
+	doc.add_term("term" + str(i));
+    }
+    for (int i = 0; i < 10; ++i) {
+	db.add_document(doc);
+    }
+
+    Xapian::Database db_r = get_writable_database_as_database();
+    TEST_EQUAL(db_r.get_doccount(), 0);
+
+    return true;
+}
+
+/// Check tags which expand a lot when decompressed are read correctly.
+DEFINE_TESTCASE(compresstag1, brass || chert) {
+    Xapian::WritableDatabase db = get_writable_database();
+    string data(200000, 'x');
+    for (size_t i = 0; i < data.size(); i += 1000) {
+	data[i] = char('a' + i % 26);
+    }
+    Xapian::Document doc;
+    doc.set_data(data);
+    doc.add_term("foo");
+    db.add_document(doc);
+    doc.set_data(data.substr(0, 5000));
+    db.add_document(doc);
+    // Less compressible data, so the compressed tag is split over several
+    // items.
+    string data3;
+    unsigned seed = 1;
+    for (int i = 0; i < 100000; ++i) {
+	seed = seed * 1103515245 + 12345;
+	data3 += char('a' + (seed >> 16) % 16);
+    }
+    doc.set_data(data3);
+    db.add_document(doc);
+    db.commit();
+
+    Xapian::Database db_r = get_writable_database_as_database();
+    TEST(db_r.get_document(1).get_data() == data);
+    TEST(db_r.get_document(2).get_data() == data.substr(0, 5000));
+    TEST(db_r.get_document(3).get_data() == data3);
+
+    return true;
+}
+
+#ifdef __WIN32__
+# define set_brass_compression(N) _putenv_s("XAPIAN_BRASS_COMPRESSION", N)
+#elif defined HAVE_SETENV
+# define set_brass_compression(N) setenv("XAPIAN_BRASS_COMPRESSION", N, 1)
+#else
+# define set_brass_compression(N) \
+    putenv(const_cast<char*>("XAPIAN_BRASS_COMPRESSION="N))
+#endif
+
+struct unset_brass_compression_helper_ {
+    unset_brass_compression_helper_() { }
+    ~unset_brass_compression_helper_() { set_brass_compression(""); }
+};
+
+static void
+check_codec_db(const string & path, const string & data)
+{
+    Xapian::Database db(path);
+    TEST_EQUAL(db.get_doccount(), 20);
+    for (Xapian::docid did = 1; did <= 20; ++did) {
+	TEST_EQUAL(db.get_document(did).get_data(), data + str(did));
+    }
+    TEST_EQUAL(db.get_termfreq("foo"), 20);
+    TEST_EQUAL(db.get_termfreq("bar10"), 1);
+    Xapian::termcount spellings = 0;
+    for (Xapian::TermIterator s = db.spellings_begin();
+	 s != db.spellings_end(); ++s) {
+	++spellings;
+    }
+    TEST_EQUAL(spellings, 20);
+    Xapian::TermIterator t = db.termlist_begin(10);
+    TEST_EQUAL(*t, "bar10");
+    ++t;
+    TEST_EQUAL(*t, "foo");
+}
+
+/// Check XAPIAN_BRASS_COMPRESSION selects the codec for new tables.
+DEFINE_TESTCASE(compresscodec1, brass) {
+    unset_brass_compression_helper_ unset_brass_compression_helper;
+    set_brass_compression("snappy");
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   get_named_writable_database("compresscodec1bad"));
+
+    string data;
+    for (int i = 0; i < 1000; ++i) {
+	data += "compressible data ";
+    }
+
+    static const char * const codecs[] = {
+	"zlib", "lz4", "zstd", "zlib,record=lz4", "lz4,termlist=zstd"
+    };
+    size_t tested = 0;
+    for (size_t i = 0; i != sizeof(codecs) / sizeof(codecs[0]); ++i) {
+	tout << codecs[i] << endl;
+	set_brass_compression(codecs[i]);
+	string name = "compresscodec1_" + str(i);
+	Xapian::WritableDatabase db;
+	try {
+	    db = get_named_writable_database(name);
+	} catch (const Xapian::FeatureUnavailableError &) {
+	    // Support for this codec wasn't compiled in.
+	    set_brass_compression("");
+	    continue;
+	}
+	set_brass_compression("");
+	++tested;
+
+	for (Xapian::docid did = 1; did <= 20; ++did) {
+	    Xapian::Document doc;
+	    doc.set_data(data + str(did));
+	    doc.add_term("foo");
+	    doc.add_posting("bar" + str(did), 1);
+	    db.add_document(doc);
+	    db.add_spelling("word" + str(did));
+	}
+	db.commit();
+	// The codec is recorded in the table, so it's still used once the
+	// environment variable is unset.
+	for (Xapian::docid did = 1; did <= 20; did += 2) {
+	    Xapian::Document doc = db.get_document(did);
+	    doc.set_data(data + str(did));
+	    db.replace_document(did, doc);
+	}
+	db.commit();
+	db.close();
+
+	string path = get_named_writable_database_path(name);
+	check_codec_db(path, data);
+
+	// Compact to zlib and back to the original codec, which exercises
+	// both recompressing tags and copying them compressed.
+	string out = path + "out";
+	rm_rf(out);
+	{
+	    Xapian::Compactor compact;
+	    compact.set_destdir(out);
+	    compact.add_source(path);
+	    compact.compact();
+	}
+	check_codec_db(out, data);
+
+	string out2 = path + "out2";
+	rm_rf(out2);
+	set_brass_compression(codecs[i]);
+	{
+	    Xapian::Compactor compact;
+	    compact.set_destdir(out2);
+	    compact.add_source(out);
+	    compact.add_source(path);
+	    compact.compact();
+	}
+	set_brass_compression("");
+	{
+	    Xapian::Database db2(out2);
+	    TEST_EQUAL(db2.get_doccount(), 40);
+	    TEST_EQUAL(db2.get_document(1).get_data(), data + "1");
+	    TEST_EQUAL(db2.get_document(40).get_data(), data + "20");
+	}
+	rm_rf(out);
+	rm_rf(out2);
+    }
+    // zlib is always available.
+    TEST_REL(tested, >=, 1);
+
+    return true;
+}
@@ -120,6 +120,12 @@ get_writable_database_again()
     return backendmanager->get_writable_database_again();
 }
 
+Xapian::Database
+reconnect_remote_database()
+{
+    return backendmanager->reconnect_remote_database();
+}
+
 void
 skip_test_unless_backend(const std::string & backend_prefix)
 {
@@ -55,6 +55,8 @@ Xapian::Database get_writable_database_as_database();
 
 Xapian::WritableDatabase get_writable_database_again();
 
+Xapian::Database reconnect_remote_database();
+
 // Skip the test for any backend not of the specified type.
 //
 // More precisely, this skips the test for any backend for which the
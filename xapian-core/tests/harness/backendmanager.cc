@@ -333,6 +333,15 @@ BackendManager::get_writable_database_again()
     throw Xapian::InvalidOperationError(msg);
 }
 
+Xapian::Database
+BackendManager::reconnect_remote_database()
+{
+    string msg = "Backend ";
+    msg += get_dbtype();
+    msg += " doesn't support reconnect_remote_database()";
+    throw Xapian::InvalidOperationError(msg);
+}
+
 void
 BackendManager::clean_up()
 {
@@ -190,6 +190,9 @@ class BackendManager {
     /// Create a WritableDatabase object for the last opened WritableDatabase.
     virtual Xapian::WritableDatabase get_writable_database_again();
 
+    /// Connect again to the last remote server launched.
+    virtual Xapian::Database reconnect_remote_database();
+
     /** Called after each test, to perform any necessary cleanup.
      *
      *  May be called more than once for a given test in some cases.
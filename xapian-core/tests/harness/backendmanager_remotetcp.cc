@@ -336,8 +336,8 @@ BackendManagerRemoteTcp::get_writable_database(const string & name,
 					       const string & file)
 {
     string args = get_writable_database_args(name, file);
-    int port = launch_xapian_tcpsrv(args);
-    return Xapian::Remote::open_writable(LOCALHOST, port);
+    last_port = launch_xapian_tcpsrv(args);
+    return Xapian::Remote::open_writable(LOCALHOST, last_port);
 }
 
 Xapian::Database
@@ -345,24 +345,30 @@ BackendManagerRemoteTcp::get_remote_database(const vector<string> & files,
 					     unsigned int timeout)
 {
     string args = get_remote_database_args(files, timeout);
-    int port = launch_xapian_tcpsrv(args);
-    return Xapian::Remote::open(LOCALHOST, port);
+    last_port = launch_xapian_tcpsrv(args);
+    return Xapian::Remote::open(LOCALHOST, last_port);
 }
 
 Xapian::Database
 BackendManagerRemoteTcp::get_writable_database_as_database()
 {
     string args = get_writable_database_as_database_args();
-    int port = launch_xapian_tcpsrv(args);
-    return Xapian::Remote::open(LOCALHOST, port);
+    last_port = launch_xapian_tcpsrv(args);
+    return Xapian::Remote::open(LOCALHOST, last_port);
 }
 
 Xapian::WritableDatabase
 BackendManagerRemoteTcp::get_writable_database_again()
 {
     string args = get_writable_database_again_args();
-    int port = launch_xapian_tcpsrv(args);
-    return Xapian::Remote::open_writable(LOCALHOST, port);
+    last_port = launch_xapian_tcpsrv(args);
+    return Xapian::Remote::open_writable(LOCALHOST, last_port);
+}
+
+Xapian::Database
+BackendManagerRemoteTcp::reconnect_remote_database()
+{
+    return Xapian::Remote::open(LOCALHOST, last_port);
 }
 
 void
@@ -38,12 +38,15 @@ class BackendManagerRemoteTcp : public BackendManagerRemote {
     /// The path of the last writable database used.
     std::string last_wdb_name;
 
+    /// The port of the last server launched.
+    int last_port;
+
     /// Create a Xapian::Database object indexing multiple files.
     Xapian::Database do_get_database(const std::vector<std::string> & files);
 
   public:
     BackendManagerRemoteTcp(const std::string & remote_type_)
-	: BackendManagerRemote(remote_type_) { }
+	: BackendManagerRemote(remote_type_), last_port(0) { }
 
     ~BackendManagerRemoteTcp();
 
@@ -64,6 +67,9 @@ class BackendManagerRemoteTcp : public BackendManagerRemote {
     /// Create a WritableDatabase object for the last opened WritableDatabase.
     Xapian::WritableDatabase get_writable_database_again();
 
+    /// Connect again to the last server launched, without launching another.
+    Xapian::Database reconnect_remote_database();
+
     /// Called after each test, to perform any necessary cleanup.
     void clean_up();
 };
@@ -2755,6 +2755,25 @@ static bool test_qp_defaultstrategysome1()
     return true;
 }
 
+/// Test splitting CJK text into words with a lexicon.
+static bool test_qp_cjk_segmenter1()
+{
+    Xapian::CJKSegmenter segmenter;
+    segmenter.add_word("久有");
+    segmenter.add_word("归天");
+    segmenter.add_word("归天愿");
+
+    Xapian::QueryParser qp;
+    qp.set_cjk_segmenter(segmenter);
+    TEST_STRINGS_EQUAL(qp.parse_query("久有归天愿").get_description(),
+		       "Query((久有@1 AND 归天愿@1))");
+    TEST_STRINGS_EQUAL(qp.parse_query("久有 天").get_description(),
+		       "Query((久有@1 OR 天@2))");
+    TEST_STRINGS_EQUAL(qp.parse_query("\"久有归天\"").get_description(),
+		       "Query((久有@1 PHRASE 2 归天@1))");
+    return true;
+}
+
 /// Test cases for the QueryParser.
 static const test_desc tests[] = {
     TESTCASE(queryparser1),
@@ -2798,6 +2817,7 @@ static const test_desc tests[] = {
     TESTCASE(qp_default_op2),
     TESTCASE(qp_default_op3),
     TESTCASE(qp_defaultstrategysome1),
+    TESTCASE(qp_cjk_segmenter1),
     END_OF_TESTCASES
 };
 
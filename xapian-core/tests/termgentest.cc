@@ -73,6 +73,12 @@ static const test test_simple[] = {
     { "cont,weight=2",
 	  "simple-example", "example:3[2,104] simple:3[1,103]" },
 
+    // Mixed ASCII and non-ASCII text (runs of ASCII are handled specially).
+    { "", "Hello_World, CAF\xc3\x89 au-lait;na\xc3\xafve\tTEXT123 x",
+	  "au[3] caf\xc3\xa9[2] hello_world[1] lait[4] na\xc3\xafve[5] text123[6] x[7]" },
+    // Invalid UTF-8 is treated as ISO-8859-1.
+    { "", "caf\xe9 ABC\xc3\x89XYZ", "abc\xc3\xa9xyz[2] caf\xc3\xa9[1]" },
+
     // Test parsing of initials
     { "", "I.B.M.", "ibm[1]" },
     { "", "I.B.M", "ibm[1]" },
@@ -832,12 +838,46 @@ static bool test_tg_max_word_length1()
     return true;
 }
 
+/// Test splitting CJK text into words with a lexicon.
+static bool test_tg_cjk_segmenter1()
+{
+    Xapian::CJKSegmenter segmenter;
+    segmenter.add_word("久有");
+    segmenter.add_word("有归");
+    segmenter.add_word("归天");
+    segmenter.add_word("归天愿");
+
+    Xapian::TermGenerator termgen;
+    termgen.set_cjk_segmenter(segmenter);
+
+    Xapian::Document doc;
+    termgen.set_document(doc);
+    // The longest word at each point is used, and characters which don't
+    // start a word are indexed on their own.
+    termgen.index_text("久有归天愿 天久有归天");
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc),
+		       "久有[1,4] 天[3] 归天[5] 归天愿[2]");
+
+    doc = Xapian::Document();
+    termgen.set_document(doc);
+    termgen.set_termpos(0);
+    termgen.index_text("配this is久有a个 test!");
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc),
+		       "a[5] is[3] test[7] this[2] 个[6] 久有[4] 配[1]");
+
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   Xapian::CJKSegmenter("/nonexistent/cjk-words"));
+
+    return true;
+}
+
 /// Test cases for the TermGenerator.
 static const test_desc tests[] = {
     TESTCASE(termgen1),
     TESTCASE(tg_spell1),
     TESTCASE(tg_spell2),
     TESTCASE(tg_max_word_length1),
+    TESTCASE(tg_cjk_segmenter1),
     END_OF_TESTCASES
 };
 
@@ -110,6 +110,8 @@ BM25Weight::init(double factor)
 	termweight *= (param_k3 + 1) * wqf_double / (param_k3 + wqf_double);
     }
 #endif
+    // Fold in the (k1 + 1) factor from the wdf part of the formula.
+    termweight *= (param_k1 + 1);
 
     LOGVALUE(WTCALC, termweight);
 
@@ -168,7 +170,7 @@ BM25Weight::get_sumpart(Xapian::termcount wdf, Xapian::termcount len) const
     double wdf_double(wdf);
     double denom = param_k1 * (normlen * param_b + (1 - param_b)) + wdf_double;
     AssertRel(denom,>,0);
-    RETURN(termweight * (param_k1 + 1) * (wdf_double / denom));
+    RETURN(termweight * (wdf_double / denom));
 }
 
 double
@@ -187,7 +189,7 @@ BM25Weight::get_maxpart() const
 	}
     }
     AssertRel(denom,>,0);
-    RETURN(termweight * (param_k1 + 1) * (wdf_max / denom));
+    RETURN(termweight * (wdf_max / denom));
 }
 
 /* The BM25 formula gives:
@@ -1,4 +1,5 @@
 xapianincludedir = $(incdir)/xapian
 
 xapianinclude_HEADERS =\
-	include/xapian/letor.h
+	include/xapian/letor.h\
+	include/xapian/ranker.h
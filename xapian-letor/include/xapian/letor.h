@@ -31,6 +31,8 @@
 
 namespace Xapian {
 
+class Ranker;
+
 class XAPIAN_VISIBILITY_DEFAULT Letor {
   public:
     /// @private @internal Class representing the Letor internals.
@@ -56,6 +58,17 @@ class XAPIAN_VISIBILITY_DEFAULT Letor {
     /// Specify the query. This will be used by the internal class.
     void set_query(const Xapian::Query & query);
 
+    /** Specify a native ranker to score documents with in letor_score().
+     *
+     *  By default letor_score() uses the libsvm model in 'model.txt', but
+     *  once a ranker has been set it is used instead, and all the documents
+     *  in the MSet are scored in a single batch.  The ranker is passed the
+     *  19 normalised feature values for each document.
+     *
+     *  @param  ranker  The ranker to use.
+     */
+    void set_ranker(const Xapian::Ranker & ranker);
+
     /** This method finds the frequency of the query terms in the specified documents. This method is a helping method and statistics gathered through
      *  this method are used in feature value calculation. It return the frequency of the terms of query in std::map<string, long int> form.
      *
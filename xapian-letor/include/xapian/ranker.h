@@ -0,0 +1,170 @@
+/** @file ranker.h
+ *  @brief Score feature vectors with a learned ranking model.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_RANKER_H
+#define XAPIAN_INCLUDED_RANKER_H
+
+#include <xapian.h>
+#include <xapian/intrusive_ptr.h>
+#include <xapian/types.h>
+#include <xapian/visibility.h>
+
+#include <string>
+#include <vector>
+
+namespace Xapian {
+
+/** A learned ranking model which is evaluated natively.
+ *
+ *  The model is the sum of a linear model and an ensemble of regression
+ *  trees (as produced by gradient boosting), either of which may be empty.
+ *  So a linear model, a tree ensemble, or a combination can be represented.
+ *
+ *  Features are numbered from 1, as in the Letor training file format, and
+ *  a feature vector is passed as an array of doubles with feature 1 first.
+ *
+ *  The trees are stored flattened into a single array of nodes which is
+ *  walked without recursion, and scoring a batch of documents evaluates
+ *  each tree for every document in turn so that the tree stays in cache.
+ */
+class XAPIAN_VISIBILITY_DEFAULT Ranker {
+  public:
+    /// @private @internal Class representing the Ranker internals.
+    class Internal;
+    /// @private @internal Reference counted internals.
+    Xapian::Internal::intrusive_ptr<Internal> internal;
+
+    /// Copy constructor.
+    Ranker(const Ranker & o);
+
+    /// Assignment.
+    Ranker & operator=(const Ranker & o);
+
+    /** Default constructor.
+     *
+     *  The model is initially empty, so gives every document a score of 0.
+     */
+    Ranker();
+
+    /** Construct a Ranker from a model saved by save().
+     *
+     *  @param filename	The file to read the model from.
+     *
+     *  @exception Xapian::InvalidArgumentError if the file can't be opened.
+     *  @exception Xapian::SerialisationError if the file isn't a valid model.
+     */
+    explicit Ranker(const std::string & filename);
+
+    /// Destructor.
+    ~Ranker();
+
+    /** Set the linear part of the model.
+     *
+     *  The linear part of the score is:
+     *
+     *  bias + weights[0] * feature 1 + weights[1] * feature 2 + ...
+     *
+     *  @param weights	The weight for each feature.
+     *  @param bias	The constant term (default 0).
+     */
+    void set_linear_model(const std::vector<double> & weights,
+			  double bias = 0);
+
+    /** Add a regression tree to the ensemble.
+     *
+     *  The tree is given as parallel arrays with one entry per node, with
+     *  node 0 as the root.  A node with feature 0 is a leaf, and contributes
+     *  value[i] to the score.  Otherwise the node is a split, and evaluation
+     *  continues with node left[i] if the feature numbered feature[i] is
+     *  less than or equal to value[i], and with node right[i] if not (which
+     *  includes the case where the feature value is NaN).
+     *
+     *  Children must come after their parent in the arrays, and each node
+     *  can only be the child of one other node.  Any scaling (such as a
+     *  learning rate for gradient boosting) should already have been applied
+     *  to the leaf values.
+     *
+     *  @param feature	The feature number to split on, or 0 for a leaf.
+     *  @param value	The split threshold, or the leaf value.
+     *  @param left	The index of the left child (ignored for a leaf).
+     *  @param right	The index of the right child (ignored for a leaf).
+     *
+     *  @exception Xapian::InvalidArgumentError if the arrays aren't all the
+     *		   same non-zero length, or if the nodes don't form a tree.
+     */
+    void add_tree(const std::vector<unsigned> & feature,
+		  const std::vector<double> & value,
+		  const std::vector<unsigned> & left,
+		  const std::vector<unsigned> & right);
+
+    /// Return the number of trees in the ensemble.
+    Xapian::termcount get_num_trees() const;
+
+    /** Return the number of features the model needs.
+     *
+     *  This is the highest feature number used by the model, so feature
+     *  vectors passed to score() must be at least this long.
+     */
+    unsigned get_num_features() const;
+
+    /** Score a single feature vector.
+     *
+     *  @param features	The feature values (feature 1 first).
+     *
+     *  @exception Xapian::InvalidArgumentError if @a features is shorter
+     *		   than get_num_features().
+     */
+    double score(const std::vector<double> & features) const;
+
+    /** Score a batch of feature vectors.
+     *
+     *  @param features	The feature vectors for all the documents, one after
+     *			another (so the features for document d start at
+     *			index d * num_features).
+     *  @param num_features	The length of each feature vector.
+     *  @param scores	The scores are returned here, one per document.
+     *
+     *  @exception Xapian::InvalidArgumentError if @a num_features is less
+     *		   than get_num_features(), or the size of @a features isn't
+     *		   a multiple of @a num_features.
+     */
+    void score(const std::vector<double> & features,
+	       unsigned num_features,
+	       std::vector<double> & scores) const;
+
+    /** Save the model to a file.
+     *
+     *  The file uses a compact binary format which can be loaded with
+     *  Ranker(const std::string &) without any parsing of text.
+     *
+     *  @param filename	The file to write the model to.
+     *
+     *  @exception Xapian::InvalidArgumentError if the file can't be
+     *		   written.
+     */
+    void save(const std::string & filename) const;
+
+    /// Return a string describing this object.
+    std::string get_description() const;
+};
+
+}
+
+#endif /* XAPIAN_INCLUDED_RANKER_H */
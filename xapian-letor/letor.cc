@@ -24,6 +24,8 @@
 #include <xapian/letor.h>
 #include "letor_internal.h"
 
+#include <xapian/ranker.h>
+
 #include <map>
 #include <string>
 
@@ -54,6 +56,12 @@ Letor::set_query(const Xapian::Query & query) {
     internal->letor_query = query;
 }
 
+void
+Letor::set_ranker(const Xapian::Ranker & ranker) {
+    internal->ranker = ranker;
+    internal->use_ranker = true;
+}
+
 map<string, long int>
 Letor::termfreq(const Xapian::Document & doc, const Xapian::Query & query) {
     return internal->termfreq(doc, query);
@@ -36,12 +36,12 @@
 #include "safeunistd.h"
 
 #include <algorithm>
-#include <list>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <map>
+#include <vector>
 #include <math.h>
 
 #include <libsvm/svm.h>
@@ -58,11 +58,6 @@ struct svm_node *x_space;
 int cross_validation;
 int nr_fold;
 
-struct svm_node *x;
-int max_nr_attr = 64;
-
-int predict_probability = 0;
-
 static char *line = NULL;
 static int max_line_len;
 
@@ -362,238 +357,290 @@ static void exit_input_error(int line_num) {
     exit(1);
 }
 
-static string convertDouble(double value) {
-    std::ostringstream o;
-    if (!(o << value))
-	return string();
-    return o.str();
-}
-
 static string get_cwd() {
     char temp[MAXPATHLEN];
     return (getcwd(temp, MAXPATHLEN) ? std::string(temp) : std::string());
 }
 
+/// The number of features calculated for each document.
+static const int NUM_FEATURES = 19;
 
-/* This method will calculate the score assigned by the Letor function.
- * It will take MSet as input then convert the documents in feature vectors
- * then normalize them according to QueryLevelNorm
- * and after that use the machine learned model file
- * to assign a score to the document
- */
-map<Xapian::docid, double>
-Letor::Internal::letor_score(const Xapian::MSet & mset) {
-
-    map<Xapian::docid, double> letor_mset;
-
-    map<string, long int> coll_len;
-    coll_len = collection_length(letor_db);
-
-    map<string, long int> coll_tf;
-    coll_tf = collection_termfreq(letor_db, letor_query);
-
-    map<string, double> idf;
-    idf = inverse_doc_freq(letor_db, letor_query);
+/// Which part of the document a feature is calculated for.
+enum { TITLE, BODY, WHOLE };
 
-    int first = 1;                //used as a flag in QueryLevelNorm module
+/** Calculates the feature values for documents matching a query.
+ *
+ *  This computes the same features as calculate_f1() to calculate_f6() plus
+ *  the document weight, but the statistics which only depend on the query are
+ *  gathered once up front into arrays indexed by query term, and the
+ *  features which don't depend on the document are only calculated once.
+ *  The features for a document then just need a single pass over its
+ *  termlist.
+ *
+ *  The features for a document are stored in NUM_FEATURES consecutive
+ *  doubles, in order of feature number (so feature 1 is at index 0).
+ */
+class FeatureCalculator {
+    Xapian::Database db;
 
-    typedef list<double> List1;     //the values of a particular feature for MSet documents will be stored in the list
-    typedef map<int, List1> Map3;    //the above list will be mapped to an integer with its feature id.
+    /// The distinct query terms, in ascending order.
+    vector<string> unique_terms;
 
-    /* So the whole structure will look like below if there are 5 documents in  MSet and 3 features to be calculated
+    /** The index in unique_terms of each query term.
      *
-     * 1  -> 32.12 - 23.12 - 43.23 - 12.12 - 65.23
-     * 2  -> 31.23 - 21.43 - 33.99 - 65.23 - 22.22
-     * 3  -> 1.21 - 3.12 - 2.23 - 6.32 - 4.23
-     *
-     * And after that we divide the whole list by the maximum value for that feature in all the 5 documents
-     * So we divide the values of Feature 1 in above case by 65.23 and hence all the values of that features for that query
-     * will belongs to [0,1] and is known as Query level Norm
+     *  This is in query order and may contain repeated terms, which
+     *  contribute to the features once for each occurrence.
      */
+    vector<size_t> term_index;
 
-    Map3 norm;
-
-    map<int, list<double> >::iterator norm_outer;
-    list<double>::iterator norm_inner;
-
-    typedef list<string> List2;
-    List2 doc_ids;
+    /// Whether each query term is a title term (TITLE) or not (BODY).
+    vector<int> term_field;
 
-    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
-	Xapian::Document doc = i.get_document();
+    /// The inverse document frequency of each query term.
+    vector<double> idf;
 
-	map<string, long int> tf;
-	tf = termfreq(doc, letor_query);
+    /// The collection frequency of each query term.
+    vector<double> coll_tf;
 
-	map<string, long int> doclen;
-	doclen = doc_length(letor_db, doc);
+    /// The total length of the title, body, and whole collection.
+    double coll_len[3];
 
-	double f[20];
+    /// The features which only depend on the query (7 to 12), or 0.
+    double query_features[NUM_FEATURES];
 
-	f[1] = calculate_f1(letor_query, tf, 't');          //storing the feature values from array index 1 to sync it with feature number.
-	f[2] = calculate_f1(letor_query, tf, 'b');
-	f[3] = calculate_f1(letor_query, tf, 'w');
+    /// The wdf of each of unique_terms in the current document.
+    mutable vector<double> wdf;
 
-	f[4] = calculate_f2(letor_query, tf, doclen, 't');
-	f[5] = calculate_f2(letor_query, tf, doclen, 'b');
-	f[6] = calculate_f2(letor_query, tf, doclen, 'w');
+  public:
+    FeatureCalculator(const Xapian::Database & db_,
+		      const Xapian::Query & query,
+		      map<string, long int> & coll_length);
 
-	f[7] = calculate_f3(letor_query, idf, 't');
-	f[8] = calculate_f3(letor_query, idf, 'b');
-	f[9] = calculate_f3(letor_query, idf, 'w');
-
-	f[10] = calculate_f4(letor_query, coll_tf, coll_len, 't');
-	f[11] = calculate_f4(letor_query, coll_tf, coll_len, 'b');
-	f[12] = calculate_f4(letor_query, coll_tf, coll_len, 'w');
-
-	f[13] = calculate_f5(letor_query, tf, idf, doclen, 't');
-	f[14] = calculate_f5(letor_query, tf, idf, doclen, 'b');
-	f[15] = calculate_f5(letor_query, tf, idf, doclen, 'w');
-
-	f[16] = calculate_f6(letor_query, tf, doclen, coll_tf, coll_len, 't');
-	f[17] = calculate_f6(letor_query, tf, doclen, coll_tf, coll_len, 'b');
-	f[18] = calculate_f6(letor_query, tf, doclen, coll_tf, coll_len, 'w');
-
-	f[19] = i.get_weight();
-
-	/* This module will make the data structure to store the whole features values for
-	 * all the documents for a particular query along with its relevance judgements
-	 */
+    /// Calculate the features for document @a did with weight @a weight.
+    void get_features(Xapian::docid did, double weight, double * f) const;
+};
 
-	if (first == 1) {
-	    for (int j = 1; j < 20; ++j) {
-		List1 l;
-		l.push_back(f[j]);
-		norm.insert(pair<int, list<double> >(j, l));
-	    }
-	    first = 0;
+FeatureCalculator::FeatureCalculator(const Xapian::Database & db_,
+				     const Xapian::Query & query,
+				     map<string, long int> & coll_length)
+    : db(db_)
+{
+    coll_len[TITLE] = coll_length["title"];
+    coll_len[BODY] = coll_length["body"];
+    coll_len[WHOLE] = coll_length["whole"];
+
+    vector<string> terms(query.get_terms_begin(), query.get_terms_end());
+    unique_terms = terms;
+    sort(unique_terms.begin(), unique_terms.end());
+    unique_terms.erase(unique(unique_terms.begin(), unique_terms.end()),
+		       unique_terms.end());
+    wdf.resize(unique_terms.size());
+
+    long int totaldocs = db.get_doccount();
+    vector<double> unique_idf, unique_coll_tf;
+    unique_idf.reserve(unique_terms.size());
+    unique_coll_tf.reserve(unique_terms.size());
+    vector<string>::const_iterator t;
+    for (t = unique_terms.begin(); t != unique_terms.end(); ++t) {
+	long int df = db.get_termfreq(*t);
+	if (df) {
+	    // Use integer division to match inverse_doc_freq().
+	    unique_idf.push_back(log10(totaldocs / (1 + df)));
+	    unique_coll_tf.push_back(db.get_collection_freq(*t));
 	} else {
-	    norm_outer = norm.begin();
-	    int k = 1;
-	    for (; norm_outer != norm.end(); ++norm_outer) {
-		norm_outer->second.push_back(f[k]);
-		++k;
-	    }
+	    unique_idf.push_back(0);
+	    unique_coll_tf.push_back(0);
 	}
-    }//for closed
+    }
 
-    /* this is the place where we have to normalize the norm and after that store it in the file. */
+    for (int j = 0; j != NUM_FEATURES; ++j) query_features[j] = 0;
+
+    term_index.reserve(terms.size());
+    term_field.reserve(terms.size());
+    idf.reserve(terms.size());
+    coll_tf.reserve(terms.size());
+    for (t = terms.begin(); t != terms.end(); ++t) {
+	size_t u = lower_bound(unique_terms.begin(), unique_terms.end(), *t) -
+		   unique_terms.begin();
+	term_index.push_back(u);
+	// Title terms have an "S" prefix, possibly after a "Z" for a stemmed
+	// term.
+	const string & term = *t;
+	bool title = (!term.empty() && term[0] == 'S') ||
+		     (term.size() > 1 && term[1] == 'S');
+	int field = title ? TITLE : BODY;
+	term_field.push_back(field);
+	idf.push_back(unique_idf[u]);
+	coll_tf.push_back(unique_coll_tf[u]);
+
+	// Features 7 to 9 and 10 to 12.
+	double f3 = log10(1 + unique_idf[u]);
+	query_features[6 + field] += f3;
+	query_features[6 + WHOLE] += f3;
+	query_features[9 + field] +=
+	    log10(1 + coll_len[field] / (1 + unique_coll_tf[u]));
+	query_features[9 + WHOLE] +=
+	    log10(1 + coll_len[WHOLE] / (1 + unique_coll_tf[u]));
+    }
+}
 
-    if (!norm.empty()) {
-	norm_outer = norm.begin();
-	++norm_outer;
-	int k = 0;
-	for (; norm_outer != norm.end(); ++norm_outer) {
-	    k = 0;
-	    double max = norm_outer->second.front();
-	    for (norm_inner = norm_outer->second.begin(); norm_inner != norm_outer->second.end(); ++norm_inner) {
-		if (*norm_inner > max)
-		    max = *norm_inner;
-	    }
-	    for (norm_inner = norm_outer->second.begin(); norm_inner != norm_outer->second.end(); ++norm_inner) {
-		if (max != 0)      // sometimes value for whole feature is 0 and hence it may cause 'divide-by-zero'
-		    *norm_inner /= max;
-		++k;
+void
+FeatureCalculator::get_features(Xapian::docid did, double weight,
+				double * f) const
+{
+    // Find the wdf of each query term and the length of the title in one
+    // pass over the termlist.  The title terms all have prefix "S", and
+    // unique_terms is sorted, so we can skip to the query terms which sort
+    // before the title terms, then step through the title terms, then skip
+    // to the remaining query terms.
+    const size_t n = unique_terms.size();
+    size_t u = 0;
+    double title_len = 0;
+    Xapian::TermIterator dt = db.termlist_begin(did);
+    Xapian::TermIterator dt_end = db.termlist_end(did);
+    for ( ; u != n && unique_terms[u] < "S"; ++u) {
+	wdf[u] = 0;
+	if (dt == dt_end) continue;
+	dt.skip_to(unique_terms[u]);
+	if (dt != dt_end && *dt == unique_terms[u]) wdf[u] = dt.get_wdf();
+    }
+    if (dt != dt_end) {
+	dt.skip_to("S");
+	for ( ; dt != dt_end; ++dt) {
+	    const string & term = *dt;
+	    if (term[0] != 'S') {
+		// We've reached the end of the S-prefixed terms.
+		break;
 	    }
+	    Xapian::termcount term_wdf = dt.get_wdf();
+	    title_len += term_wdf;
+	    while (u != n && unique_terms[u] < term) wdf[u++] = 0;
+	    if (u != n && unique_terms[u] == term) wdf[u++] = term_wdf;
 	}
+    }
+    for ( ; u != n; ++u) {
+	wdf[u] = 0;
+	if (dt == dt_end) continue;
+	dt.skip_to(unique_terms[u]);
+	if (dt != dt_end && *dt == unique_terms[u]) wdf[u] = dt.get_wdf();
+    }
 
-	int xx = 0, j = 0;
-	Xapian::MSetIterator mset_iter = mset.begin();
-	Xapian::Document doc;
-	while (xx<k) {
-	    doc = mset_iter.get_document();
-
-	    string test_case = "0 ";
-	    j = 0;
-	    norm_outer = norm.begin();
-	    ++j;
-	    for (; norm_outer != norm.end(); ++norm_outer) {
-		test_case.append(str(j));
-		test_case.append(":");
-		test_case.append(convertDouble(norm_outer->second.front()));
-		test_case.append(" ");
-		norm_outer->second.pop_front();
-		++j;
-	    }
-	    ++xx;
-
-	    string model_file;
-	    model_file = get_cwd();
-	    model_file = model_file.append("/model.txt");       // will create "model.txt" in currect working directory
-
-	    model = svm_load_model(model_file.c_str());
-	    x = (struct svm_node *)malloc(max_nr_attr * sizeof(struct svm_node));
-
-	    int total = 0;
-
-	    int svm_type = svm_get_svm_type(model);
-	    int nr_class = svm_get_nr_class(model);
-
-	    if (predict_probability) {
-		if (svm_type == NU_SVR || svm_type == EPSILON_SVR) {
-		    printf("Prob. model for test data: target value = predicted value + z,\nz: Laplace distribution e^(-|z|/sigma)/(2sigma),sigma=%g\n" , svm_get_svr_probability(model));
-		} else {
-		    int *labels = (int *) malloc(nr_class * sizeof(int));
-		    svm_get_labels(model, labels);
-		    free(labels);
-		}
-	    }
-
-	    max_line_len = 1024;
-	    line = (char *)malloc(max_line_len*sizeof(char));
+    double doc_len[3];
+    doc_len[TITLE] = title_len;
+    doc_len[WHOLE] = db.get_doclength(did);
+    doc_len[BODY] = doc_len[WHOLE] - doc_len[TITLE];
+
+    for (int j = 0; j != NUM_FEATURES; ++j) f[j] = query_features[j];
+
+    // Features 1 to 6 (f1 and f2) and 13 to 18 (f5 and f6), which each have
+    // a title or body variant plus a whole document variant.
+    for (size_t k = 0; k != term_index.size(); ++k) {
+	double tf = wdf[term_index[k]];
+	int field = term_field[k];
+	double f1 = log10(1 + tf);
+	f[field] += f1;
+	f[WHOLE] += f1;
+	f[3 + field] += log10(1 + tf / (1 + doc_len[field]));
+	f[3 + WHOLE] += log10(1 + tf / (1 + doc_len[WHOLE]));
+	f[12 + field] += log10(1 + tf * idf[k] / (1 + doc_len[field]));
+	f[12 + WHOLE] += log10(1 + tf * idf[k] / (1 + doc_len[WHOLE]));
+	f[15 + field] += log10(1 + tf * coll_len[field] /
+				   (1 + doc_len[field] * coll_tf[k]));
+	f[15 + WHOLE] += log10(1 + tf * coll_len[WHOLE] /
+				   (1 + doc_len[WHOLE] * coll_tf[k]));
+    }
 
-	    line = const_cast<char *>(test_case.c_str());
+    f[18] = weight;
+}
 
-	    int i = 0;
-	    double predict_label;
-	    char *idx, *val, *label, *endptr;
-	    int inst_max_index = -1; // strtol gives 0 if wrong format, and precomputed kernel has <index> start from 0
+/** Normalise the features using QueryLevelNorm.
+ *
+ *  Each feature is divided by its maximum value over all the documents for
+ *  the query, so the values for that query lie in [0,1] (unless the maximum
+ *  is 0, in which case the values are left alone to avoid dividing by zero).
+ */
+static void
+normalise_features(vector<double> & features)
+{
+    if (features.empty()) return;
+    double max[NUM_FEATURES];
+    const double * row = &features[0];
+    const double * end = row + features.size();
+    for (int j = 0; j != NUM_FEATURES; ++j) max[j] = row[j];
+    for (row += NUM_FEATURES; row != end; row += NUM_FEATURES) {
+	for (int j = 0; j != NUM_FEATURES; ++j) {
+	    if (row[j] > max[j]) max[j] = row[j];
+	}
+    }
+    for (int j = 0; j != NUM_FEATURES; ++j) {
+	// Multiply by the reciprocal, leaving features with maximum 0 alone.
+	max[j] = (max[j] != 0) ? 1.0 / max[j] : 1.0;
+    }
+    for (double * r = &features[0]; r != end; r += NUM_FEATURES) {
+	for (int j = 0; j != NUM_FEATURES; ++j) r[j] *= max[j];
+    }
+}
 
-	    label = strtok(line, " \t\n");
-	    if (label == NULL) // empty line
-		exit_input_error(total + 1);
+/* This method will calculate the score assigned by the Letor function.
+ * It will take MSet as input then convert the documents in feature vectors
+ * then normalize them according to QueryLevelNorm
+ * and after that use the machine learned model file
+ * to assign a score to the document
+ */
+map<Xapian::docid, double>
+Letor::Internal::letor_score(const Xapian::MSet & mset) {
 
-	    if (strtod(label, &endptr)) {
-		// Ignore the result (I guess we're just syntax checking the file?)
-	    }
-	    if (endptr == label || *endptr != '\0')
-		exit_input_error(total + 1);
+    map<Xapian::docid, double> letor_mset;
+    if (mset.empty())
+	return letor_mset;
 
-	    while (1) {
-		if (i >= max_nr_attr - 1) {	// need one more for index = -1
-		    max_nr_attr *= 2;
-		    x = (struct svm_node *)realloc(x, max_nr_attr * sizeof(struct svm_node));
-		}
+    map<string, long int> coll_len;
+    coll_len = collection_length(letor_db);
 
-		idx = strtok(NULL, ":");
-		val = strtok(NULL, " \t");
+    FeatureCalculator calculator(letor_db, letor_query, coll_len);
 
-		if (val == NULL)
-		    break;
-		errno = 0;
-		x[i].index = (int)strtol(idx, &endptr, 10);
+    // The feature values for all the documents, one after another.
+    vector<double> features(mset.size() * NUM_FEATURES);
+    double * row = &features[0];
+    Xapian::MSetIterator i;
+    for (i = mset.begin(); i != mset.end(); ++i) {
+	calculator.get_features(*i, i.get_weight(), row);
+	row += NUM_FEATURES;
+    }
 
-		if (endptr == idx || errno != 0 || *endptr != '\0' || x[i].index <= inst_max_index)
-		    exit_input_error(total + 1);
-		else
-		    inst_max_index = x[i].index;
+    normalise_features(features);
 
-		errno = 0;
-		x[i].value = strtod(val, &endptr);
-		if (endptr == val || errno != 0 || (*endptr != '\0' && !isspace(*endptr)))
-		    exit_input_error(total+1);
-		++i;
-	    }
+    if (use_ranker) {
+	vector<double> scores;
+	ranker.score(features, NUM_FEATURES, scores);
+	vector<double>::const_iterator s = scores.begin();
+	for (i = mset.begin(); i != mset.end(); ++i) {
+	    letor_mset[*i] = *s++;
+	}
+	return letor_mset;
+    }
 
-	    x[i].index = -1;
+    string model_file;
+    model_file = get_cwd();
+    model_file = model_file.append("/model.txt");       // will create "model.txt" in currect working directory
 
-	    predict_label = svm_predict(model, x);	//this is the score for a particular document
+    struct svm_model * letor_model = svm_load_model(model_file.c_str());
+    if (letor_model == NULL)
+	throw Xapian::InvalidOperationError("Couldn't load letor model", model_file);
 
-	    letor_mset[doc.get_docid()] = predict_label;
+    struct svm_node nodes[NUM_FEATURES + 1];
+    nodes[NUM_FEATURES].index = -1;
+    row = &features[0];
+    for (i = mset.begin(); i != mset.end(); ++i) {
+	for (int j = 0; j != NUM_FEATURES; ++j) {
+	    nodes[j].index = j + 1;
+	    nodes[j].value = row[j];
+	}
+	row += NUM_FEATURES;
+	letor_mset[*i] = svm_predict(letor_model, nodes);	//this is the score for a particular document
+    }
 
-	    ++mset_iter;
-	}//while closed
-    }//if closed
+    svm_free_and_destroy_model(&letor_model);
 
     return letor_mset;
 }
@@ -822,26 +869,11 @@ Letor::Internal::prepare_training_file(const string & queryfile, const string &
     myfile1.open(queryfile.c_str(), ios::in);
 
     while (!myfile1.eof()) {           //reading all the queries line by line from the query file
-	typedef list<double> List1;		//the values of a particular feature for MSet documents will be stored in the list
-	typedef map<int, List1> Map3;	//the above list will be mapped to an integer with its feature id.
-
-	/* So the whole structure will look like below if there are 5 documents in  MSet and 3 features to be calculated
-	 *
-	 * 1  -> 32.12 - 23.12 - 43.23 - 12.12 - 65.23
-	 * 2  -> 31.23 - 21.43 - 33.99 - 65.23 - 22.22
-	 * 3  -> 1.21 - 3.12 - 2.23 - 6.32 - 4.23
-	 *
-	 * And after that we divide the whole list by the maximum value for that feature in all the 5 documents
-	 * So we divide the values of Feature 1 in above case by 65.23 and hence all the values of that features for that query
-	 * will belongs to [0,1] and is known as Query level Norm
-	 */
-	Map3 norm;
-
-	map< int, list<double> >::iterator norm_outer;
-	list<double>::iterator norm_inner;
-
-	typedef list<string> List2;
-	List2 doc_ids;
+	// The relevance judgements and feature values (NUM_FEATURES for each
+	// document) for the judged documents matching the query.
+	vector<int> labels;
+	vector<double> features;
+	vector<string> doc_ids;
 
 	getline(myfile1, str1);
 	if (str1.empty()) {
@@ -878,53 +910,11 @@ Letor::Internal::prepare_training_file(const string & queryfile, const string &
 
 	Xapian::MSet mset = enquire.get_mset(0, msetsize);
 
-	Xapian::Letor ltr;
-
-	map<string, long int> coll_tf;
-	coll_tf = collection_termfreq(letor_db, query);
-
-	map<string, double> idf;
-	idf = inverse_doc_freq(letor_db, query);
-
-	int first = 1;    //used as a flag in QueryLevelNorm and module
+	FeatureCalculator calculator(letor_db, query, coll_len);
 
 	for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
 	    Xapian::Document doc = i.get_document();
 
-	    map<string, long int> tf;
-	    tf = termfreq(doc, query);
-
-	    map<string, long int> doclen;
-	    doclen = doc_length(letor_db, doc);
-
-	    double f[20];
-
-	    f[1] = calculate_f1(query, tf, 't');
-	    f[2] = calculate_f1(query, tf, 'b');
-	    f[3] = calculate_f1(query, tf, 'w');
-
-	    f[4] = calculate_f2(query, tf, doclen, 't');
-	    f[5] = calculate_f2(query, tf, doclen, 'b');
-	    f[6] = calculate_f2(query, tf, doclen, 'w');
-
-	    f[7] = calculate_f3(query, idf, 't');
-	    f[8] = calculate_f3(query, idf, 'b');
-	    f[9] = calculate_f3(query, idf, 'w');
-
-	    f[10] = calculate_f4(query, coll_tf, coll_len, 't');
-	    f[11] = calculate_f4(query, coll_tf, coll_len, 'b');
-	    f[12] = calculate_f4(query, coll_tf, coll_len, 'w');
-
-	    f[13] = calculate_f5(query, tf, idf, doclen, 't');
-	    f[14] = calculate_f5(query, tf, idf, doclen, 'b');
-	    f[15] = calculate_f5(query, tf, idf, doclen, 'w');
-
-	    f[16] = calculate_f6(query, tf, doclen, coll_tf, coll_len, 't');
-	    f[17] = calculate_f6(query, tf, doclen, coll_tf, coll_len, 'b');
-	    f[18] = calculate_f6(query, tf, doclen, coll_tf, coll_len, 'w');
-
-	    f[19] = i.get_weight();
-
 	    string data = doc.get_data();
 
 	    string temp_id = data.substr(data.find("url=", 0), (data.find("sample=", 0) - data.find("url=", 0)));
@@ -939,76 +929,38 @@ Letor::Internal::prepare_training_file(const string & queryfile, const string &
 		    int q1 = innerit->second;
 		    cout << q1 << " Qid:" << qid << " #docid:" << id << "\n";
 
-		    /* This module will make the data structure to store the whole features values for
-		     * all the documents for a particular query along with its relevance judgements
+		    /* Store the feature values for all the judged documents
+		     * for this query along with their relevance judgements.
 		     */
-		    if (first == 1) {
-			List1 l;
-			l.push_back((double)q1);
-			norm.insert(pair<int, list<double> >(0, l));
-			doc_ids.push_back(id);
-			for (int j = 1; j < 20; ++j) {
-			    List1 l1;
-			    l1.push_back(f[j]);
-			    norm.insert(pair<int, list<double> >(j, l1));
-			}
-			first = 0;
-		    } else {
-			norm_outer = norm.begin();
-			norm_outer->second.push_back(q1);
-			++norm_outer;
-			doc_ids.push_back(id);
-			int k = 1;
-			for (; norm_outer != norm.end(); ++norm_outer) {
-			    norm_outer->second.push_back(f[k]);
-			    ++k;
-			}
-		    }
+		    labels.push_back(q1);
+		    doc_ids.push_back(id);
+		    features.resize(features.size() + NUM_FEATURES);
+		    calculator.get_features(*i, i.get_weight(),
+					    &features[features.size() - NUM_FEATURES]);
 		}
 	    }
 
 	}//for closed
 
-	/* this is the place where we have to normalize the norm and after that store it in the file. */
+	/* this is the place where we have to normalize the features and after that store them in the file. */
 
-	if (norm.empty())
+	if (labels.empty())
 	    continue;
 
-	norm_outer = norm.begin();
-	++norm_outer;
-	int k = 0;
-	for (; norm_outer != norm.end(); ++norm_outer) {
-	    k = 0;
-	    double max = norm_outer->second.front();
-	    for (norm_inner = norm_outer->second.begin(); norm_inner != norm_outer->second.end(); ++norm_inner) {
-		if (*norm_inner > max)
-		    max = *norm_inner;
-	    }
-	    for (norm_inner = norm_outer->second.begin(); norm_inner != norm_outer->second.end(); ++norm_inner) {
-		if (max != 0)
-		    *norm_inner /= max;
-		++k;
-	    }
-	}
+	normalise_features(features);
 
-	for (int i = 0; i < k; ++i) {
-	    int j = 0;
-	    norm_outer = norm.begin();
-	    train_file << norm_outer->second.front();
-	    norm_outer->second.pop_front();
-	    ++norm_outer;
-	    ++j;
+	const double * row = &features[0];
+	for (size_t d = 0; d != labels.size(); ++d) {
+	    train_file << labels[d];
 //Uncomment the line below if you want 'Qid' in the training file
 //          train_file << " qid:" << qid;
-	    for (; norm_outer != norm.end(); ++norm_outer) {
-		train_file << " " << j << ":" << norm_outer->second.front();
-		norm_outer->second.pop_front();
-		++j;
+	    for (int j = 0; j != NUM_FEATURES; ++j) {
+		train_file << " " << j + 1 << ":" << row[j];
 	    }
+	    row += NUM_FEATURES;
 //Uncomment the line below if you want 'DocID' in the training file
-//          train_file << " #docid:" << doc_ids.front();
+//          train_file << " #docid:" << doc_ids[d];
 	    train_file << "\n";
-	    doc_ids.pop_front();
 	}
 
     }//while closed
@@ -23,6 +23,7 @@
 #define XAPIAN_INCLUDED_LETOR_INTERNAL_H
 
 #include <xapian/letor.h>
+#include <xapian/ranker.h>
 
 #include <map>
 
@@ -35,7 +36,14 @@ class Letor::Internal : public Xapian::Internal::intrusive_base {
     Database letor_db;
     Query letor_query;
 
+    /// The native ranker to score documents with, if use_ranker is true.
+    Ranker ranker;
+
+    /// Score with ranker rather than the libsvm model in model.txt?
+    bool use_ranker;
+
   public:
+    Internal() : use_ranker(false) { }
 
     map<string, long int> termfreq(const Xapian::Document & doc, const Xapian::Query & query);
 
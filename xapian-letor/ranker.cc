@@ -0,0 +1,499 @@
+/** @file ranker.cc
+ * @brief Score feature vectors with a learned ranking model.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include <xapian/ranker.h>
+
+#include <xapian/error.h>
+
+#include "pack.h"
+#include "str.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "safeerrno.h"
+
+using namespace std;
+
+/// Magic string at the start of a saved model.
+static const char RANKER_MAGIC[] = "XapianRanker";
+
+/// The version of the saved model format.
+static const unsigned RANKER_FORMAT_VERSION = 1;
+
+/** Append a double to a saved model.
+ *
+ *  We use the public sortable_serialise() for this as it's exact, which
+ *  avoids needing the library's internal double serialisation code.
+ */
+static void
+pack_double(string & s, double value)
+{
+    pack_string(s, Xapian::sortable_serialise(value));
+}
+
+/// Decode a double appended by pack_double().
+static double
+unpack_double(const char ** p, const char * end)
+{
+    string value;
+    if (!unpack_string(p, end, value)) {
+	throw Xapian::SerialisationError("Bad ranker model: value");
+    }
+    return Xapian::sortable_unserialise(value);
+}
+
+namespace Xapian {
+
+class Ranker::Internal : public Xapian::Internal::intrusive_base {
+  public:
+    /** A node in a regression tree.
+     *
+     *  The nodes of each tree are stored in preorder, so a tree occupies a
+     *  contiguous range of nodes starting with its root, and the left child
+     *  of a split always immediately follows it.
+     *
+     *  A leaf has both children set to itself, so walking a tree for a fixed
+     *  number of steps (its depth) ends at the right leaf wherever it is.
+     *  That means the walk doesn't need to test for leaves, and the child to
+     *  move to can be selected by indexing rather than an unpredictable
+     *  branch.
+     */
+    struct Node {
+	/// The split threshold, or the value for a leaf.
+	double value;
+
+	/// The index in the feature vector to split on (0 for a leaf).
+	unsigned index;
+
+	/** The indices in nodes of the children.
+	 *
+	 *  child[0] is followed if the feature is <= value, and child[1] if
+	 *  not.
+	 */
+	unsigned child[2];
+
+	bool is_leaf(unsigned self) const { return child[0] == self; }
+    };
+
+    /// The constant term of the linear part of the model.
+    double bias;
+
+    /// The weight of each feature in the linear part of the model.
+    vector<double> weights;
+
+    /// The nodes of all the trees.
+    vector<Node> nodes;
+
+    /// The index in nodes of the root of each tree.
+    vector<unsigned> roots;
+
+    /// The depth of each tree (0 for a tree which is just a leaf).
+    vector<unsigned> depths;
+
+    /// The highest feature number used by the model.
+    unsigned num_features;
+
+    Internal() : bias(0), num_features(0) { }
+
+    /** Append the subtree at @a i of a tree passed to add_tree() to nodes.
+     *
+     *  @param start	The index in nodes of the root of the tree.
+     *
+     *  @return	The depth of the subtree.
+     */
+    unsigned flatten(const vector<unsigned> & feature,
+		     const vector<double> & value,
+		     const vector<unsigned> & left,
+		     const vector<unsigned> & right,
+		     unsigned i, size_t start);
+
+    /// Return the value of tree @a t for feature vector @a f.
+    double evaluate(size_t t, const double * f) const {
+	const Node * base = &nodes[0];
+	unsigned pos = roots[t];
+	for (unsigned step = depths[t]; step; --step) {
+	    const Node & node = base[pos];
+	    pos = node.child[f[node.index] > node.value];
+	}
+	return base[pos].value;
+    }
+
+    /// Score @a n feature vectors of length @a stride into @a scores.
+    void score(const double * features, size_t n, unsigned stride,
+	       double * scores) const;
+
+    /// Serialise the model.
+    string serialise() const;
+
+    /// Unserialise a model serialised by serialise().
+    void unserialise(const string & s);
+};
+
+unsigned
+Ranker::Internal::flatten(const vector<unsigned> & feature,
+			  const vector<double> & value,
+			  const vector<unsigned> & left,
+			  const vector<unsigned> & right,
+			  unsigned i, size_t start)
+{
+    unsigned n = nodes.size();
+    if (n - start >= feature.size()) {
+	// More nodes than we were passed, so some must be shared.
+	throw Xapian::InvalidArgumentError("Tree nodes can't be shared");
+    }
+    nodes.push_back(Node());
+    nodes[n].value = value[i];
+    nodes[n].index = 0;
+    nodes[n].child[0] = nodes[n].child[1] = n;
+    if (feature[i] == 0) return 0;
+
+    // Requiring children to come after their parent means the recursion
+    // terminates.
+    if (left[i] <= i || left[i] >= feature.size() ||
+	right[i] <= i || right[i] >= feature.size()) {
+	throw Xapian::InvalidArgumentError("Tree node " + str(i) +
+					   " has an invalid child index");
+    }
+    if (feature[i] > num_features) num_features = feature[i];
+    nodes[n].index = feature[i] - 1;
+    nodes[n].child[0] = n + 1;
+    unsigned depth = flatten(feature, value, left, right, left[i], start);
+    nodes[n].child[1] = nodes.size();
+    depth = max(depth,
+		flatten(feature, value, left, right, right[i], start));
+    return depth + 1;
+}
+
+void
+Ranker::Internal::score(const double * features, size_t n, unsigned stride,
+			double * scores) const
+{
+    const double * end = features + n * stride;
+    const double * f;
+    double * s = scores;
+    for (f = features; f != end; f += stride) {
+	double w = bias;
+	for (size_t j = 0; j != weights.size(); ++j) {
+	    w += weights[j] * f[j];
+	}
+	*s++ = w;
+    }
+
+    if (roots.empty()) return;
+
+    // Evaluate each tree for all the documents before moving on to the next
+    // tree, so the nodes of the tree stay in cache.  We walk the tree for a
+    // block of documents in lockstep, so the CPU can overlap the walks rather
+    // than waiting for each node to be loaded in turn.
+    const size_t BLOCK = 16;
+    const Node * base = &nodes[0];
+    for (size_t t = 0; t != roots.size(); ++t) {
+	const unsigned root = roots[t];
+	const unsigned depth = depths[t];
+	for (size_t d = 0; d < n; d += BLOCK) {
+	    size_t m = min(BLOCK, n - d);
+	    const double * block_f = features + d * stride;
+	    unsigned pos[BLOCK];
+	    for (size_t k = 0; k != m; ++k) pos[k] = root;
+	    for (unsigned step = depth; step; --step) {
+		const double * doc_f = block_f;
+		for (size_t k = 0; k != m; ++k) {
+		    const Node & node = base[pos[k]];
+		    pos[k] = node.child[doc_f[node.index] > node.value];
+		    doc_f += stride;
+		}
+	    }
+	    for (size_t k = 0; k != m; ++k) scores[d + k] += base[pos[k]].value;
+	}
+    }
+}
+
+string
+Ranker::Internal::serialise() const
+{
+    string result(RANKER_MAGIC);
+    pack_uint(result, RANKER_FORMAT_VERSION);
+    pack_double(result, bias);
+    pack_uint(result, weights.size());
+    vector<double>::const_iterator w;
+    for (w = weights.begin(); w != weights.end(); ++w) {
+	pack_double(result, *w);
+    }
+    pack_uint(result, roots.size());
+    vector<unsigned>::const_iterator r;
+    for (r = roots.begin(); r != roots.end(); ++r) {
+	pack_uint(result, *r);
+    }
+    // Each node is stored as the feature number (or 0 for a leaf), then the
+    // index of the right child for a split, then the value.
+    pack_uint(result, nodes.size());
+    for (unsigned j = 0; j != nodes.size(); ++j) {
+	const Node & node = nodes[j];
+	if (node.is_leaf(j)) {
+	    pack_uint(result, 0u);
+	} else {
+	    pack_uint(result, node.index + 1);
+	    pack_uint(result, node.child[1]);
+	}
+	pack_double(result, node.value);
+    }
+    return result;
+}
+
+void
+Ranker::Internal::unserialise(const string & s)
+{
+    const char * p = s.data();
+    const char * end = p + s.size();
+    size_t magic_len = sizeof(RANKER_MAGIC) - 1;
+    if (s.compare(0, magic_len, RANKER_MAGIC) != 0) {
+	throw Xapian::SerialisationError("Not a Xapian ranker model");
+    }
+    p += magic_len;
+
+    unsigned version;
+    if (!unpack_uint(&p, end, &version)) {
+	throw Xapian::SerialisationError("Bad ranker model: no version");
+    }
+    if (version != RANKER_FORMAT_VERSION) {
+	throw Xapian::SerialisationError("Unsupported ranker model version " +
+					 str(version));
+    }
+
+    bias = unpack_double(&p, end);
+
+    size_t n;
+    if (!unpack_uint(&p, end, &n) || n > size_t(end - p)) {
+	throw Xapian::SerialisationError("Bad ranker model: weights");
+    }
+    weights.clear();
+    weights.reserve(n);
+    while (n--) weights.push_back(unpack_double(&p, end));
+    num_features = weights.size();
+
+    if (!unpack_uint(&p, end, &n) || n > size_t(end - p)) {
+	throw Xapian::SerialisationError("Bad ranker model: roots");
+    }
+    roots.resize(n);
+    for (size_t t = 0; t != n; ++t) {
+	if (!unpack_uint(&p, end, &roots[t]) ||
+	    (t == 0 ? roots[t] != 0 : roots[t] <= roots[t - 1])) {
+	    throw Xapian::SerialisationError("Bad ranker model: roots");
+	}
+    }
+
+    if (!unpack_uint(&p, end, &n) || n > size_t(end - p) ||
+	(roots.empty() ? n != 0 : roots.back() >= n)) {
+	throw Xapian::SerialisationError("Bad ranker model: nodes");
+    }
+    nodes.resize(n);
+    size_t t = 0;
+    for (unsigned j = 0; j != n; ++j) {
+	// The end of the tree this node is in.
+	while (t + 1 < roots.size() && roots[t + 1] <= j) ++t;
+	unsigned tree_end = (t + 1 < roots.size()) ? roots[t + 1] : n;
+
+	Node & node = nodes[j];
+	unsigned feature;
+	if (!unpack_uint(&p, end, &feature)) {
+	    throw Xapian::SerialisationError("Bad ranker model: nodes");
+	}
+	if (feature == 0) {
+	    node.index = 0;
+	    node.child[0] = node.child[1] = j;
+	} else {
+	    unsigned right;
+	    if (!unpack_uint(&p, end, &right) ||
+		right <= j + 1 || right >= tree_end) {
+		throw Xapian::SerialisationError("Bad ranker model: node " +
+						 str(j));
+	    }
+	    node.index = feature - 1;
+	    node.child[0] = j + 1;
+	    node.child[1] = right;
+	    if (feature > num_features) num_features = feature;
+	}
+	node.value = unpack_double(&p, end);
+    }
+    if (p != end) {
+	throw Xapian::SerialisationError("Junk at end of ranker model");
+    }
+
+    // Find the depth of each tree.  Children come after their parents, so
+    // working backwards we've always found the depth of a node's children
+    // before we need it.
+    vector<unsigned> node_depth(n);
+    for (unsigned j = n; j-- != 0; ) {
+	const Node & node = nodes[j];
+	if (!node.is_leaf(j)) {
+	    node_depth[j] = max(node_depth[node.child[0]],
+				node_depth[node.child[1]]) + 1;
+	}
+    }
+    depths.clear();
+    depths.reserve(roots.size());
+    for (t = 0; t != roots.size(); ++t) {
+	depths.push_back(node_depth[roots[t]]);
+    }
+}
+
+Ranker::Ranker(const Ranker & o) : internal(o.internal) { }
+
+Ranker &
+Ranker::operator=(const Ranker & o)
+{
+    internal = o.internal;
+    return *this;
+}
+
+Ranker::Ranker() : internal(new Ranker::Internal) { }
+
+Ranker::Ranker(const string & filename) : internal(new Ranker::Internal)
+{
+    ifstream in(filename.c_str(), ios::in | ios::binary);
+    if (!in) {
+	throw Xapian::InvalidArgumentError("Couldn't open ranker model",
+					   filename, errno);
+    }
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    internal->unserialise(data);
+}
+
+Ranker::~Ranker() { }
+
+void
+Ranker::set_linear_model(const vector<double> & weights, double bias)
+{
+    internal->weights = weights;
+    internal->bias = bias;
+    if (weights.size() > internal->num_features)
+	internal->num_features = weights.size();
+}
+
+void
+Ranker::add_tree(const vector<unsigned> & feature,
+		 const vector<double> & value,
+		 const vector<unsigned> & left,
+		 const vector<unsigned> & right)
+{
+    if (feature.empty() || value.size() != feature.size() ||
+	left.size() != feature.size() || right.size() != feature.size()) {
+	throw Xapian::InvalidArgumentError("Tree arrays must all have the "
+					   "same non-zero length");
+    }
+    size_t old_size = internal->nodes.size();
+    unsigned old_num_features = internal->num_features;
+    try {
+	unsigned depth = internal->flatten(feature, value, left, right, 0,
+					   old_size);
+	internal->roots.push_back(old_size);
+	internal->depths.push_back(depth);
+    } catch (...) {
+	internal->nodes.resize(old_size);
+	internal->roots.resize(internal->depths.size());
+	internal->num_features = old_num_features;
+	throw;
+    }
+}
+
+Xapian::termcount
+Ranker::get_num_trees() const
+{
+    return internal->roots.size();
+}
+
+unsigned
+Ranker::get_num_features() const
+{
+    return internal->num_features;
+}
+
+double
+Ranker::score(const vector<double> & features) const
+{
+    if (features.size() < internal->num_features) {
+	throw Xapian::InvalidArgumentError("Ranker needs " +
+					   str(internal->num_features) +
+					   " features");
+    }
+    const double * f = features.empty() ? NULL : &features[0];
+    double result = internal->bias;
+    for (size_t j = 0; j != internal->weights.size(); ++j) {
+	result += internal->weights[j] * f[j];
+    }
+    for (size_t t = 0; t != internal->roots.size(); ++t) {
+	result += internal->evaluate(t, f);
+    }
+    return result;
+}
+
+void
+Ranker::score(const vector<double> & features, unsigned num_features,
+	      vector<double> & scores) const
+{
+    if (num_features == 0) {
+	throw Xapian::InvalidArgumentError("num_features must be non-zero");
+    }
+    if (num_features < internal->num_features) {
+	throw Xapian::InvalidArgumentError("Ranker needs " +
+					   str(internal->num_features) +
+					   " features");
+    }
+    if (features.size() % num_features != 0) {
+	throw Xapian::InvalidArgumentError("Size of features isn't a "
+					   "multiple of num_features");
+    }
+    size_t n = features.size() / num_features;
+    scores.resize(n);
+    if (n == 0) return;
+    internal->score(&features[0], n, num_features, &scores[0]);
+}
+
+void
+Ranker::save(const string & filename) const
+{
+    ofstream out(filename.c_str(), ios::out | ios::binary | ios::trunc);
+    if (out) out << internal->serialise();
+    if (out) out.close();
+    if (!out) {
+	throw Xapian::InvalidArgumentError("Couldn't write ranker model",
+					   filename, errno);
+    }
+}
+
+string
+Ranker::get_description() const
+{
+    string desc = "Ranker(";
+    desc += str(internal->weights.size());
+    desc += " weights, ";
+    desc += str(internal->roots.size());
+    desc += " trees)";
+    return desc;
+}
+
+}
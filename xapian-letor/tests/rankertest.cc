@@ -0,0 +1,237 @@
+/** @file rankertest.cc
+ * @brief Test Xapian::Ranker
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include <xapian.h>
+#include <xapian/ranker.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define LINEAR_MODEL "rankertest-linear.model"
+#define TREES_MODEL "rankertest-trees.model"
+#define BAD_MODEL "rankertest-bad.model"
+
+static const unsigned NUM_FEATURES = 3;
+
+struct testcase {
+    double features[NUM_FEATURES];
+    double linear_score;
+    double trees_score;
+};
+
+// The linear model is 0.25 + 0.5 * f1 - f2 + 2 * f3, and the expected scores
+// for the tree ensemble built by make_trees() were worked out by hand.
+static const testcase testcases[] = {
+    { { 0.5, 0.25, 0.0 },	0.25,	-2.5 },
+    { { 2.0, 0.25, 1.0 },	3.0,	7.5 },
+    { { 0.0, 0.75, -1.0 },	-2.5,	8.5 },
+    { { 4.0, 1.0, 1.0 },	3.25,	14.5 }
+};
+
+static const size_t NUM_TESTCASES = sizeof(testcases) / sizeof(testcases[0]);
+
+static bool failed = false;
+
+static void
+check_score(const char * model, size_t i, double got, double expected)
+{
+    if (fabs(got - expected) > 1e-9) {
+	cerr << model << " model: testcase " << i << " should score "
+	     << expected << ", got " << got << endl;
+	failed = true;
+    }
+}
+
+static void
+make_linear(Xapian::Ranker & ranker)
+{
+    vector<double> weights(NUM_FEATURES);
+    weights[0] = 0.5;
+    weights[1] = -1.0;
+    weights[2] = 2.0;
+    ranker.set_linear_model(weights, 0.25);
+}
+
+static void
+make_trees(Xapian::Ranker & ranker)
+{
+    // Tree 1 splits on f2 then f1.  The right child of the root is listed
+    // before the left subtree to check that the nodes are reordered
+    // correctly when the tree is flattened.
+    //
+    //   f2 <= 0.5 ? (f1 <= 1.0 ? -1 : 3) : 10
+    {
+	unsigned feature[] = { 2, 0, 1, 0, 0 };
+	double value[] = { 0.5, 10.0, 1.0, -1.0, 3.0 };
+	unsigned left[] = { 2, 0, 3, 0, 0 };
+	unsigned right[] = { 1, 0, 4, 0, 0 };
+	ranker.add_tree(vector<unsigned>(feature, feature + 5),
+			vector<double>(value, value + 5),
+			vector<unsigned>(left, left + 5),
+			vector<unsigned>(right, right + 5));
+    }
+
+    // Tree 2 is a single leaf, which adds a constant 0.5.
+    ranker.add_tree(vector<unsigned>(1, 0), vector<double>(1, 0.5),
+		    vector<unsigned>(1, 0), vector<unsigned>(1, 0));
+
+    // Tree 3 is a stump on f3.
+    //
+    //   f3 <= 0 ? -2 : 4
+    {
+	unsigned feature[] = { 3, 0, 0 };
+	double value[] = { 0.0, -2.0, 4.0 };
+	unsigned left[] = { 1, 0, 0 };
+	unsigned right[] = { 2, 0, 0 };
+	ranker.add_tree(vector<unsigned>(feature, feature + 3),
+			vector<double>(value, value + 3),
+			vector<unsigned>(left, left + 3),
+			vector<unsigned>(right, right + 3));
+    }
+}
+
+// Check the scores from @a ranker, both one at a time and as a batch.
+static void
+check_model(const char * model, const Xapian::Ranker & ranker,
+	    double testcase::* expected)
+{
+    if (ranker.get_num_features() != NUM_FEATURES) {
+	cerr << model << " model: get_num_features() should be "
+	     << NUM_FEATURES << ", got " << ranker.get_num_features() << endl;
+	failed = true;
+	return;
+    }
+
+    // Pad each vector in the batch with an unused feature to check that the
+    // stride is honoured.
+    const unsigned stride = NUM_FEATURES + 1;
+    vector<double> batch;
+    for (size_t i = 0; i != NUM_TESTCASES; ++i) {
+	const testcase & t = testcases[i];
+	vector<double> features(t.features, t.features + NUM_FEATURES);
+	check_score(model, i, ranker.score(features), t.*expected);
+	batch.insert(batch.end(), features.begin(), features.end());
+	batch.push_back(1e9);
+    }
+
+    vector<double> scores;
+    ranker.score(batch, stride, scores);
+    if (scores.size() != NUM_TESTCASES) {
+	cerr << model << " model: batch should give " << NUM_TESTCASES
+	     << " scores, got " << scores.size() << endl;
+	failed = true;
+	return;
+    }
+    for (size_t i = 0; i != NUM_TESTCASES; ++i) {
+	check_score(model, i, scores[i], testcases[i].*expected);
+    }
+}
+
+int main()
+try {
+    Xapian::Ranker empty;
+    if (empty.score(vector<double>()) != 0) {
+	cerr << "An empty model should score 0" << endl;
+	failed = true;
+    }
+
+    {
+	Xapian::Ranker linear;
+	make_linear(linear);
+	check_model("linear", linear, &testcase::linear_score);
+	linear.save(LINEAR_MODEL);
+    }
+    check_model("loaded linear", Xapian::Ranker(LINEAR_MODEL),
+		&testcase::linear_score);
+
+    {
+	Xapian::Ranker trees;
+	make_trees(trees);
+	if (trees.get_num_trees() != 3) {
+	    cerr << "Tree model should have 3 trees, got "
+		 << trees.get_num_trees() << endl;
+	    failed = true;
+	}
+	check_model("trees", trees, &testcase::trees_score);
+	trees.save(TREES_MODEL);
+    }
+    {
+	Xapian::Ranker trees(TREES_MODEL);
+	if (trees.get_num_trees() != 3) {
+	    cerr << "Loaded tree model should have 3 trees, got "
+		 << trees.get_num_trees() << endl;
+	    failed = true;
+	}
+	check_model("loaded trees", trees, &testcase::trees_score);
+    }
+
+    // A feature vector which is too short should be rejected.
+    try {
+	Xapian::Ranker linear(LINEAR_MODEL);
+	(void)linear.score(vector<double>(NUM_FEATURES - 1));
+	cerr << "Short feature vector not rejected" << endl;
+	failed = true;
+    } catch (const Xapian::InvalidArgumentError &) {
+    }
+
+    // A file which isn't a model should be rejected.
+    {
+	ofstream out(BAD_MODEL);
+	out << "This is not a model\n";
+    }
+    try {
+	Xapian::Ranker bad(BAD_MODEL);
+	cerr << "Invalid model file not rejected" << endl;
+	failed = true;
+    } catch (const Xapian::SerialisationError &) {
+    }
+
+    // As should a truncated model.
+    {
+	ifstream in(TREES_MODEL, ios::binary);
+	string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	ofstream out(BAD_MODEL, ios::binary);
+	out << data.substr(0, data.size() / 2);
+    }
+    try {
+	Xapian::Ranker bad(BAD_MODEL);
+	cerr << "Truncated model file not rejected" << endl;
+	failed = true;
+    } catch (const Xapian::SerialisationError &) {
+    }
+
+    remove(LINEAR_MODEL);
+    remove(TREES_MODEL);
+    remove(BAD_MODEL);
+
+    return failed ? 1 : 0;
+} catch (const Xapian::Error & e) {
+    cerr << "Exception: " << e.get_description() << endl;
+    return 1;
+}